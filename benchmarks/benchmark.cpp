@@ -0,0 +1,78 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using promclient::benchmarks::Benchmark;
+using promclient::benchmarks::State;
+
+
+//! Registered benchmarks, sorted by name.
+static std::map<std::string, Benchmark::Function>& Registry() {
+  static std::map<std::string, Benchmark::Function> registry;
+  return registry;
+}
+
+//! Minimum run time for a benchmark result to be reported.
+static const std::chrono::milliseconds MIN_TIME(200);
+
+
+State::State(std::uint64_t iterations) {
+  this->iterations_ = iterations;
+}
+
+std::uint64_t State::iterations() const {
+  return this->iterations_;
+}
+
+void State::counter(std::string name, double value) {
+  this->counters_[name] = value;
+}
+
+const std::map<std::string, double>& State::counters() const {
+  return this->counters_;
+}
+
+
+Benchmark::Benchmark(std::string name, Benchmark::Function function) {
+  Registry()[name] = function;
+}
+
+int Benchmark::RunAll(std::string filter) {
+  std::printf("%-48s %12s %12s\n", "Benchmark", "Iterations", "ns/op");
+  for (auto pair : Registry()) {
+    if (pair.first.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    std::uint64_t iterations = 1;
+    while (true) {
+      State state(iterations);
+      auto start = std::chrono::steady_clock::now();
+      pair.second(state);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+
+      if (elapsed < MIN_TIME && iterations < (1ull << 40)) {
+        iterations *= 10;
+        continue;
+      }
+
+      double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+      std::printf(
+          "%-48s %12llu %12.2f", pair.first.c_str(),
+          static_cast<unsigned long long>(iterations), ns / iterations
+      );
+      for (auto counter : state.counters()) {
+        std::printf("  %s=%g", counter.first.c_str(), counter.second);
+      }
+      std::printf("\n");
+      break;
+    }
+  }
+  return 0;
+}
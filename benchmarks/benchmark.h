@@ -0,0 +1,66 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_BENCHMARKS_BENCHMARK_H_
+#define PROMCLIENT_BENCHMARKS_BENCHMARK_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+
+namespace promclient {
+namespace benchmarks {
+
+  //! State passed to a benchmark function.
+  class State {
+   public:
+    explicit State(std::uint64_t iterations);
+
+    //! Number of operations the benchmark should perform.
+    std::uint64_t iterations() const;
+
+    //! Report an extra benchmark-specific value (i.e, retries).
+    void counter(std::string name, double value);
+
+    const std::map<std::string, double>& counters() const;
+
+   protected:
+    std::uint64_t iterations_;
+    std::map<std::string, double> counters_;
+  };
+
+
+  //! Self registering benchmark.
+  /*!
+   * Benchmarks are run with an increasing number of iterations until
+   * they take long enough to give a stable time per operation.
+   */
+  class Benchmark {
+   public:
+    typedef std::function<void(State&)> Function;
+
+    //! Runs all benchmarks with a name containing filter.
+    static int RunAll(std::string filter = "");
+
+   public:
+    Benchmark(std::string name, Function function);
+  };
+
+
+  //! Prevent the compiler from optimising away a value.
+  template<typename Value>
+  inline void DoNotOptimize(const Value& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+}  // namespace benchmarks
+}  // namespace promclient
+
+
+//! Define and register a benchmark function.
+#define PROMCLIENT_BENCHMARK(name)                                      \
+  static void name(promclient::benchmarks::State& state);              \
+  static promclient::benchmarks::Benchmark name##_benchmark(#name, name); \
+  static void name(promclient::benchmarks::State& state)
+
+#endif  // PROMCLIENT_BENCHMARKS_BENCHMARK_H_
@@ -0,0 +1,128 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "./benchmark.h"
+#include "promclient/cached.h"
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+
+using promclient::CachedCollector;
+using promclient::CollectorRegistry;
+using promclient::LabelledCounter;
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+
+//! Registry with `metrics` labelled counters of `children` series each.
+static std::shared_ptr<CollectorRegistry> MakeRegistry(
+    std::size_t metrics, std::size_t children, bool cached = false
+) {
+  std::shared_ptr<CollectorRegistry> registry(new CollectorRegistry());
+  for (std::size_t metric = 0; metric < metrics; metric++) {
+    std::shared_ptr<LabelledCounter> counter(new LabelledCounter(
+        "bench_metric_" + std::to_string(metric) + "_total", "Benchmark",
+        {"handler", "status_code"}
+    ));
+    for (std::size_t child = 0; child < children; child++) {
+      counter->labels({
+          {"handler", "/api/v1/handler/" + std::to_string(child)},
+          {"status_code", std::to_string(200 + child % 5)}
+      })->inc();
+    }
+    if (cached) {
+      registry->registr(std::make_shared<CachedCollector>(
+          counter, std::chrono::hours(1)
+      ));
+    } else {
+      registry->registr(counter);
+    }
+  }
+  return registry;
+}
+
+
+static void BenchSortedCollect(
+    State& state, std::size_t children, bool instrument = false
+) {
+  std::shared_ptr<CollectorRegistry> registry = MakeRegistry(20, children);
+  if (instrument) {
+    registry->instrument();
+  }
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    DoNotOptimize(registry->collect());
+  }
+}
+
+PROMCLIENT_BENCHMARK(SortedCollect_00020_Series) {
+  BenchSortedCollect(state, 1);
+}
+
+PROMCLIENT_BENCHMARK(SortedCollect_02000_Series) {
+  BenchSortedCollect(state, 100);
+}
+
+PROMCLIENT_BENCHMARK(SortedCollect_02000_Series_Instrumented) {
+  BenchSortedCollect(state, 100, true);
+}
+
+PROMCLIENT_BENCHMARK(SortedCollect_20000_Series) {
+  BenchSortedCollect(state, 1000);
+}
+
+
+//! Collect one of 20 metrics with 100 series each.
+PROMCLIENT_BENCHMARK(FilteredCollect_00100_Of_02000_Series) {
+  std::shared_ptr<CollectorRegistry> registry = MakeRegistry(20, 100);
+  std::set<std::string> names = {"bench_metric_7_total"};
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    DoNotOptimize(registry->collect(names));
+  }
+}
+
+
+//! Collect 20 metrics with 100 series each from a warm cache.
+PROMCLIENT_BENCHMARK(CachedCollect_02000_Series) {
+  std::shared_ptr<CollectorRegistry> registry = MakeRegistry(20, 100, true);
+  registry->collect();
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    DoNotOptimize(registry->collect());
+  }
+}
+
+
+PROMCLIENT_BENCHMARK(Register_LabelledCounter) {
+  CollectorRegistry registry;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    std::shared_ptr<LabelledCounter> counter(new LabelledCounter(
+        "bench_register_" + std::to_string(idx) + "_total", "Benchmark",
+        {"handler", "status_code"}
+    ));
+    registry.registr(counter);
+  }
+}
+
+
+//! Register and unregister a collector next to `collectors` others.
+static void BenchChurn(State& state, std::size_t collectors) {
+  std::shared_ptr<CollectorRegistry> registry = MakeRegistry(collectors, 1);
+  registry->collect();
+  std::shared_ptr<LabelledCounter> counter(new LabelledCounter(
+      "bench_churn_total", "Benchmark", {"handler", "status_code"}
+  ));
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    registry->registr(counter);
+    registry->unregister(counter);
+  }
+}
+
+PROMCLIENT_BENCHMARK(Churn_00010_Collectors) {
+  BenchChurn(state, 10);
+}
+
+PROMCLIENT_BENCHMARK(Churn_01000_Collectors) {
+  BenchChurn(state, 1000);
+}
@@ -0,0 +1,44 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "./benchmark.h"
+#include "promclient/counter.h"
+
+using promclient::Counter;
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+
+//! Increment recording a trace exemplar each time.
+PROMCLIENT_BENCHMARK(Increment_Counter_Exemplar) {
+  Counter counter("bench_total", "Benchmark");
+  std::map<std::string, std::string> labels = {
+    {"trace_id", "0af7651916cd43dd8448eb211c80319c"}
+  };
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    counter.inc(1, labels);
+  }
+  DoNotOptimize(counter.collect());
+}
+
+//! Guard a scope that does not throw.
+PROMCLIENT_BENCHMARK(CountExceptions_Counter_Guard) {
+  Counter counter("bench_errors_total", "Benchmark");
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    auto guard = counter.countExceptions();
+  }
+  DoNotOptimize(counter.collect());
+}
+
+//! Wrap a call that does not throw.
+PROMCLIENT_BENCHMARK(CountExceptions_Counter_Call) {
+  Counter counter("bench_errors_total", "Benchmark");
+  std::uint64_t total = 0;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    total += counter.countExceptions([idx]() { return idx; });
+  }
+  DoNotOptimize(total);
+}
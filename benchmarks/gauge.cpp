@@ -0,0 +1,47 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+
+#include "./benchmark.h"
+#include "promclient/gauge.h"
+#include "promclient/internal/clock.h"
+
+using promclient::Gauge;
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+using promclient::internal::Clock;
+
+
+//! Times an empty scope with the given clock source.
+static void TimeScope(State& state, Clock::Source source) {
+  Gauge gauge("bench_seconds", "Benchmark");
+  Clock::Configure(source);
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    auto timer = gauge.time();
+  }
+  Clock::Configure(Clock::Source::STEADY);
+  DoNotOptimize(gauge.collect());
+}
+
+
+PROMCLIENT_BENCHMARK(Time_Gauge_Coarse) {
+  TimeScope(state, Clock::Source::COARSE);
+}
+
+PROMCLIENT_BENCHMARK(Time_Gauge_Steady) {
+  TimeScope(state, Clock::Source::STEADY);
+}
+
+PROMCLIENT_BENCHMARK(Time_Gauge_Tsc) {
+  TimeScope(state, Clock::Source::TSC);
+}
+
+//! Tracks an empty scope as in progress.
+PROMCLIENT_BENCHMARK(TrackInProgress_Gauge) {
+  Gauge gauge("bench_in_progress", "Benchmark");
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    auto guard = gauge.trackInProgress();
+  }
+  DoNotOptimize(gauge.collect());
+}
@@ -0,0 +1,90 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../benchmark.h"
+#include "promclient/internal/atomic_double.h"
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+using promclient::internal::AtomicDouble;
+
+
+//! Run body on `threads` threads splitting the iterations between them.
+template<typename Body>
+static void Contend(State& state, int threads, Body body) {
+  std::vector<std::thread> workers;
+  std::uint64_t iterations = state.iterations() / threads + 1;
+  for (int thread = 0; thread < threads; thread++) {
+    workers.push_back(std::thread([iterations, &body]() {
+      for (std::uint64_t idx = 0; idx < iterations; idx++) {
+        body();
+      }
+    }));
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+//! Compare-and-swap loop previously used by Gauge, counting retries.
+static void BenchCasLoop(State& state, int threads, double increment) {
+  std::atomic<double> value(0);
+  std::atomic<std::uint64_t> retries(0);
+  Contend(state, threads, [&value, &retries, increment]() {
+    std::uint64_t local = 0;
+    double stored = value.load();
+    while (!value.compare_exchange_weak(stored, stored + increment)) {
+      local += 1;
+    }
+    if (local) {
+      retries.fetch_add(local, std::memory_order_relaxed);
+    }
+  });
+  DoNotOptimize(value.load());
+  state.counter(
+      "retries/op",
+      static_cast<double>(retries.load()) / state.iterations()
+  );
+}
+
+//! Mutex previously used by Counter.
+static void BenchMutex(State& state, int threads, double increment) {
+  std::mutex mutex;
+  double value = 0;
+  Contend(state, threads, [&mutex, &value, increment]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    value += increment;
+  });
+  DoNotOptimize(value);
+}
+
+static void BenchAtomicDouble(State& state, int threads, double increment) {
+  AtomicDouble value;
+  Contend(state, threads, [&value, increment]() {
+    value.add(increment);
+  });
+  DoNotOptimize(value.load());
+}
+
+#define ATOMIC_DOUBLE_BENCHMARKS(threads)                         \
+  PROMCLIENT_BENCHMARK(AtomicDouble_CasLoop_Threads##threads) {   \
+    BenchCasLoop(state, threads, 1);                              \
+  }                                                               \
+  PROMCLIENT_BENCHMARK(AtomicDouble_Mutex_Threads##threads) {     \
+    BenchMutex(state, threads, 1);                                \
+  }                                                               \
+  PROMCLIENT_BENCHMARK(AtomicDouble_Whole_Threads##threads) {     \
+    BenchAtomicDouble(state, threads, 1);                         \
+  }                                                               \
+  PROMCLIENT_BENCHMARK(AtomicDouble_Fraction_Threads##threads) {  \
+    BenchAtomicDouble(state, threads, 0.5);                       \
+  }
+
+ATOMIC_DOUBLE_BENCHMARKS(1)
+ATOMIC_DOUBLE_BENCHMARKS(2)
+ATOMIC_DOUBLE_BENCHMARKS(4)
+ATOMIC_DOUBLE_BENCHMARKS(8)
@@ -0,0 +1,33 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+
+#include "../benchmark.h"
+#include "promclient/internal/clock.h"
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+using promclient::internal::Clock;
+
+
+//! Reads the clock with the given source.
+static void ClockNow(State& state, Clock::Source source) {
+  Clock::Configure(source);
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    DoNotOptimize(Clock::Now());
+  }
+  Clock::Configure(Clock::Source::STEADY);
+}
+
+
+PROMCLIENT_BENCHMARK(Clock_Now_Coarse) {
+  ClockNow(state, Clock::Source::COARSE);
+}
+
+PROMCLIENT_BENCHMARK(Clock_Now_Steady) {
+  ClockNow(state, Clock::Source::STEADY);
+}
+
+PROMCLIENT_BENCHMARK(Clock_Now_Tsc) {
+  ClockNow(state, Clock::Source::TSC);
+}
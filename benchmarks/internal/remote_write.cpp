@@ -0,0 +1,56 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+#include <string>
+
+#include "../benchmark.h"
+#include "promclient/internal/protobuf_writer.h"
+#include "promclient/internal/remote_write.h"
+#include "promclient/internal/snappy.h"
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+using promclient::internal::ProtobufWriter;
+using promclient::internal::RemoteSeries;
+using promclient::internal::RemoteSeriesList;
+
+using promclient::internal::EncodeWriteRequest;
+using promclient::internal::SnappyCompress;
+
+
+//! A WriteRequest batch of 2000 series (the default batch size).
+static RemoteSeriesList MakeBatch() {
+  RemoteSeriesList batch;
+  for (int idx = 0; idx < 2000; idx++) {
+    RemoteSeries series;
+    series.labels = {
+      {"__name__", "bench_metric_" + std::to_string(idx % 20) + "_total"},
+      {"handler", "/api/v1/handler/" + std::to_string(idx / 20)},
+      {"status_code", std::to_string(200 + idx % 5)}
+    };
+    series.value = idx;
+    series.timestamp = 1500000000000 + idx;
+    batch.push_back(series);
+  }
+  return batch;
+}
+
+
+PROMCLIENT_BENCHMARK(RemoteWrite_Encode_2000_Series) {
+  RemoteSeriesList batch = MakeBatch();
+  ProtobufWriter request;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    EncodeWriteRequest(batch, &request);
+    DoNotOptimize(request.buffer());
+  }
+}
+
+PROMCLIENT_BENCHMARK(RemoteWrite_Snappy_2000_Series) {
+  ProtobufWriter request;
+  EncodeWriteRequest(MakeBatch(), &request);
+  std::string body;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    SnappyCompress(request.buffer(), &body);
+    DoNotOptimize(body);
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../benchmark.h"
+#include "promclient/internal/utils.h"
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+using promclient::internal::CombineHashes;
+using promclient::internal::HashBytes;
+using promclient::internal::HashLabels;
+
+
+//! Label sets of 1 to 10 labels with realistic names and values.
+static std::map<std::string, std::string> MakeLabels(std::size_t count) {
+  static const char* NAMES[][2] = {
+    {"method", "GET"},
+    {"handler", "/api/v1/users/:id/profile"},
+    {"status_code", "200"},
+    {"instance", "backend-7f9c6d8b5-x2kzq"},
+    {"region", "eu-west-1"},
+    {"tenant", "b3f1c2e4-5a6d-4e7f-8a9b-0c1d2e3f4a5b"},
+    {"protocol", "HTTP/1.1"},
+    {"content_type", "application/json"},
+    {"cache", "miss"},
+    {"version", "v2.14.3"}
+  };
+  std::map<std::string, std::string> labels;
+  for (std::size_t idx = 0; idx < count; idx++) {
+    labels[NAMES[idx][0]] = NAMES[idx][1];
+  }
+  return labels;
+}
+
+
+//! Original implementation: pair copies and an heap allocated vector.
+static std::size_t HashLabelsCombine(
+    const std::map<std::string, std::string>& labels
+) {
+  std::vector<std::size_t> hashes;
+  for (auto pair : labels) {
+    hashes.push_back(std::hash<std::string>()(pair.first));
+    hashes.push_back(std::hash<std::string>()(pair.second));
+  }
+  return CombineHashes(hashes);
+}
+
+//! Hash of a flat key packed in an heap allocated buffer.
+static std::size_t HashLabelsPacked(
+    const std::map<std::string, std::string>& labels
+) {
+  std::string key;
+  for (const auto& pair : labels) {
+    key.append(pair.first);
+    key.push_back('\0');
+    key.append(pair.second);
+    key.push_back('\0');
+  }
+  return HashBytes(key.data(), key.size());
+}
+
+
+template<std::size_t (*Hash)(const std::map<std::string, std::string>&)>
+static void BenchHash(State& state, std::size_t count) {
+  std::map<std::string, std::string> labels = MakeLabels(count);
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    DoNotOptimize(Hash(labels));
+  }
+}
+
+#define HASH_LABELS_BENCHMARKS(count)                             \
+  PROMCLIENT_BENCHMARK(HashLabels_Combine_##count) {              \
+    BenchHash<HashLabelsCombine>(state, count);                   \
+  }                                                               \
+  PROMCLIENT_BENCHMARK(HashLabels_Packed_##count) {               \
+    BenchHash<HashLabelsPacked>(state, count);                    \
+  }                                                               \
+  PROMCLIENT_BENCHMARK(HashLabels_Streaming_##count) {            \
+    BenchHash<HashLabels>(state, count);                          \
+  }
+
+HASH_LABELS_BENCHMARKS(01)
+HASH_LABELS_BENCHMARKS(02)
+HASH_LABELS_BENCHMARKS(05)
+HASH_LABELS_BENCHMARKS(10)
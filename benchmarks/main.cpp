@@ -0,0 +1,12 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <string>
+
+#include "benchmark.h"
+
+using promclient::benchmarks::Benchmark;
+
+
+int main(int argc, char** argv) {
+  std::string filter = argc > 1 ? argv[1] : "";
+  return Benchmark::RunAll(filter);
+}
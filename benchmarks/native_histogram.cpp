@@ -0,0 +1,40 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+
+#include "./benchmark.h"
+#include "promclient/metric.h"
+#include "promclient/native_histogram.h"
+#include "promclient/internal/protobuf_formatter.h"
+
+using promclient::MetricsList;
+using promclient::NativeHistogram;
+using promclient::internal::ProtobufFormatter;
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+
+//! Observations spread over about 100 buckets (latencies, 1us to 10s).
+PROMCLIENT_BENCHMARK(Observe_NativeHistogram) {
+  NativeHistogram histogram("bench_seconds", "Benchmark");
+  double value = 0.000001;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    histogram.observe(value);
+    value = value < 10 ? value * 1.37 : 0.000001;
+  }
+  DoNotOptimize(histogram.collect());
+}
+
+//! Collect and encode a populated histogram.
+PROMCLIENT_BENCHMARK(Collect_NativeHistogram_Protobuf) {
+  NativeHistogram histogram("bench_seconds", "Benchmark");
+  for (double value = 0.000001; value < 10; value *= 1.1) {
+    histogram.observe(value);
+  }
+
+  ProtobufFormatter formatter;
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    MetricsList metrics = histogram.collect();
+    DoNotOptimize(formatter.family(metrics[0]));
+  }
+}
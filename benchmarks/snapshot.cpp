@@ -0,0 +1,47 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <cstdint>
+
+#include "./benchmark.h"
+#include "promclient/counter.h"
+#include "promclient/snapshot.h"
+
+using promclient::Counter;
+using promclient::SnapshotCounterRef;
+using promclient::SnapshotGroup;
+using promclient::SnapshotUpdate;
+
+using promclient::benchmarks::DoNotOptimize;
+using promclient::benchmarks::State;
+
+
+//! Baseline: counter read independently of other metrics.
+PROMCLIENT_BENCHMARK(Increment_Counter) {
+  Counter counter("bench_total", "Benchmark");
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    counter.inc();
+  }
+  DoNotOptimize(counter.collect());
+}
+
+//! Snapshot counter entering the phaser for each increment.
+PROMCLIENT_BENCHMARK(Increment_SnapshotCounter) {
+  SnapshotGroup group;
+  SnapshotCounterRef counter = group.counter("bench_total", "Benchmark");
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    counter->inc();
+  }
+  DoNotOptimize(group.collect());
+}
+
+//! Two snapshot counters updated in one critical section.
+PROMCLIENT_BENCHMARK(Increment_SnapshotUpdate_2) {
+  SnapshotGroup group;
+  SnapshotCounterRef requests = group.counter("bench_total", "Benchmark");
+  SnapshotCounterRef errors = group.counter("bench_errors", "Benchmark");
+  for (std::uint64_t idx = 0; idx < state.iterations(); idx++) {
+    SnapshotUpdate update(group);
+    requests->inc(update);
+    errors->inc(update);
+  }
+  DoNotOptimize(group.collect());
+}
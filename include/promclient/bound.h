@@ -0,0 +1,152 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_BOUND_H_
+#define PROMCLIENT_BOUND_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "promclient/collector.h"
+#include "promclient/collector_registry.h"
+
+
+namespace promclient {
+
+  //! Collector that reads values owned by the application.
+  /*!
+   * Bound collectors keep a pointer to values that the application
+   * already maintains (usually std::atomic statistics) and read them
+   * when collected, so updates cost no more then they already do.
+   *
+   * The values must outlive the binding: call unbind() (or use a
+   * ScopedBinding) before the values are destroyed.
+   * Unbound collectors return no metrics.
+   *
+   * Plain (non-atomic) values are read without synchronisation
+   * and should only be bound if the application guarantees reads
+   * concurrent with updates are safe.
+   */
+  class BoundCollector : public Collector {
+   public:
+    explicit BoundCollector(DescriptorRef descriptor);
+
+    MetricsList collect();
+    DescriptorsList describe();
+
+    //! Stops reading the bound values.
+    /*!
+     * Waits for a concurrent collect() to complete so the
+     * values can be destroyed as soon as this method returns.
+     */
+    void unbind();
+
+   protected:
+    bool bound_;
+    DescriptorRef descriptor_;
+    std::mutex lock_;
+
+    //! Returns the samples of the bound values, called with lock_ held.
+    virtual std::vector<Sample> samples() = 0;
+  };
+  typedef std::shared_ptr<BoundCollector> BoundCollectorRef;
+
+
+  //! Registers a bound collector for the lifetime of the binding.
+  /*!
+   * The collector is unregistered and unbound when the binding
+   * is destroyed, making it safe to destroy the bound values next.
+   */
+  class ScopedBinding {
+   public:
+    //! Registers the collector (with the default registry if none given).
+    explicit ScopedBinding(
+        BoundCollectorRef collector, CollectorRegistry* registry = nullptr
+    );
+    ScopedBinding(ScopedBinding&& other);
+    ~ScopedBinding();
+
+    ScopedBinding(const ScopedBinding&) = delete;
+    ScopedBinding& operator=(const ScopedBinding&) = delete;
+
+   protected:
+    BoundCollectorRef collector_;
+    CollectorRegistry* registry_;
+  };
+
+
+  //! Collector bound to a single value.
+  template<typename Value>
+  class BoundValue : public BoundCollector {
+   public:
+    BoundValue(DescriptorRef descriptor, const Value* value);
+
+   protected:
+    const Value* value_;
+
+    std::vector<Sample> samples();
+  };
+
+  //! Counter bound to a value, the value must never decrease.
+  template<typename Value>
+  class BoundCounter : public BoundValue<Value> {
+   public:
+    BoundCounter(std::string name, std::string help, const Value* value);
+  };
+
+  //! Gauge bound to a value.
+  template<typename Value>
+  class BoundGauge : public BoundValue<Value> {
+   public:
+    BoundGauge(std::string name, std::string help, const Value* value);
+  };
+
+
+  //! Collector bound to an array of values, one series each.
+  /*!
+   * The series for the value at index `i` has the label `label`
+   * set to `names[i]`, so an array of statistics can be exposed
+   * as a single labelled metric.
+   * The array must have (at least) as many values as names.
+   */
+  template<typename Value>
+  class BoundArray : public BoundCollector {
+   public:
+    BoundArray(
+        DescriptorRef descriptor, std::string label,
+        std::vector<std::string> names, const Value* values
+    );
+
+   protected:
+    std::string label_;
+    std::vector<std::string> names_;
+    const Value* values_;
+
+    std::vector<Sample> samples();
+  };
+
+  //! Labelled counter bound to an array of values.
+  template<typename Value>
+  class BoundCounterArray : public BoundArray<Value> {
+   public:
+    BoundCounterArray(
+        std::string name, std::string help, std::string label,
+        std::vector<std::string> names, const Value* values
+    );
+  };
+
+  //! Labelled gauge bound to an array of values.
+  template<typename Value>
+  class BoundGaugeArray : public BoundArray<Value> {
+   public:
+    BoundGaugeArray(
+        std::string name, std::string help, std::string label,
+        std::vector<std::string> names, const Value* values
+    );
+  };
+
+}  // namespace promclient
+
+#include "promclient/bound.inc.h"
+
+#endif  // PROMCLIENT_BOUND_H_
@@ -0,0 +1,108 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_BOUND_INC_H_
+#define PROMCLIENT_BOUND_INC_H_
+
+#include <atomic>
+#include <utility>
+
+#include "promclient/metric.h"
+
+namespace promclient {
+namespace internal {
+
+  //! Reads a plain bound value.
+  template<typename Value>
+  double LoadBound(const Value* value) {
+    return static_cast<double>(*value);
+  }
+
+  //! Reads an atomic bound value.
+  template<typename Value>
+  double LoadBound(const std::atomic<Value>* value) {
+    return static_cast<double>(value->load(std::memory_order_relaxed));
+  }
+
+}  // namespace internal
+
+
+  template<typename Value>
+  BoundValue<Value>::BoundValue(DescriptorRef descriptor, const Value* value)
+    : BoundCollector(std::move(descriptor)) {
+    this->value_ = value;
+  }
+
+  template<typename Value>
+  std::vector<Sample> BoundValue<Value>::samples() {
+    double value = internal::LoadBound(this->value_);
+    return std::vector<Sample>({Sample("", value, {})});
+  }
+
+  template<typename Value>
+  BoundCounter<Value>::BoundCounter(
+      std::string name, std::string help, const Value* value
+  ) : BoundValue<Value>(
+        DescriptorRef(new Descriptor(name, "counter", help, {})), value
+      ) {
+    // Noop.
+  }
+
+  template<typename Value>
+  BoundGauge<Value>::BoundGauge(
+      std::string name, std::string help, const Value* value
+  ) : BoundValue<Value>(
+        DescriptorRef(new Descriptor(name, "gauge", help, {})), value
+      ) {
+    // Noop.
+  }
+
+
+  template<typename Value>
+  BoundArray<Value>::BoundArray(
+      DescriptorRef descriptor, std::string label,
+      std::vector<std::string> names, const Value* values
+  ) : BoundCollector(std::move(descriptor)) {
+    this->label_ = std::move(label);
+    this->names_ = std::move(names);
+    this->values_ = values;
+  }
+
+  template<typename Value>
+  std::vector<Sample> BoundArray<Value>::samples() {
+    std::vector<Sample> samples;
+    samples.reserve(this->names_.size());
+    for (std::size_t idx = 0; idx < this->names_.size(); idx++) {
+      double value = internal::LoadBound(&this->values_[idx]);
+      samples.emplace_back(
+          "", value, std::map<std::string, std::string>({
+            {this->label_, this->names_[idx]}
+          })
+      );
+    }
+    return samples;
+  }
+
+  template<typename Value>
+  BoundCounterArray<Value>::BoundCounterArray(
+      std::string name, std::string help, std::string label,
+      std::vector<std::string> names, const Value* values
+  ) : BoundArray<Value>(
+        DescriptorRef(new Descriptor(name, "counter", help, {label})),
+        label, std::move(names), values
+      ) {
+    // Noop.
+  }
+
+  template<typename Value>
+  BoundGaugeArray<Value>::BoundGaugeArray(
+      std::string name, std::string help, std::string label,
+      std::vector<std::string> names, const Value* values
+  ) : BoundArray<Value>(
+        DescriptorRef(new Descriptor(name, "gauge", help, {label})),
+        label, std::move(names), values
+      ) {
+    // Noop.
+  }
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_BOUND_INC_H_
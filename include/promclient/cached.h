@@ -0,0 +1,111 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_CACHED_H_
+#define PROMCLIENT_CACHED_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "promclient/collector.h"
+#include "promclient/metric.h"
+
+
+namespace promclient {
+
+  //! Statistics of a CachedCollector.
+  struct CachedCollectorStats {
+    //! Collections served from metrics younger then the TTL.
+    std::uint64_t hits;
+
+    //! Collections served from stale metrics while refreshing.
+    std::uint64_t stale;
+
+    //! Collections that waited for the wrapped collector (cold cache).
+    std::uint64_t misses;
+
+    //! Calls to the wrapped collector that returned metrics.
+    std::uint64_t refreshes;
+
+    //! Calls to the wrapped collector that threw.
+    std::uint64_t failures;
+  };
+
+
+  //! Decorator reusing the metrics of an expensive collector.
+  /*!
+   * Collectors that are expensive but change slowly (disk usage
+   * walkers, connection pool stats, ...) can share a registry with
+   * cheap collectors without slowing down every scrape.
+   *
+   * Metrics returned by the wrapped collector are reused for `ttl`.
+   * Once they are older then that, collect() returns the stale
+   * metrics immediately and a background thread refreshes them
+   * (stale-while-revalidate), so scrapes never wait on the wrapped
+   * collector once the cache is warm.
+   *
+   * The first collect() (or a call to refresh()) waits for the
+   * wrapped collector; concurrent scrapes of a cold cache share
+   * a single call.
+   * If a background refresh throws the stale metrics are kept and
+   * the refresh is retried by the next collect().
+   */
+  class CachedCollector : public Collector {
+   public:
+    CachedCollector(CollectorRef collector, std::chrono::milliseconds ttl);
+    ~CachedCollector();
+
+    MetricsList collect();
+    DescriptorsList describe();
+    bool dynamic();
+
+    //! Collects the wrapped collector now and caches the result.
+    /*!
+     * Useful to warm the cache at start up.
+     * Exceptions thrown by the wrapped collector are propagated.
+     */
+    MetricsList refresh();
+
+    //! Returns the statistics of the cache.
+    CachedCollectorStats stats();
+
+   protected:
+    CollectorRef collector_;
+    std::chrono::milliseconds ttl_;
+
+    //! Last metrics returned by the wrapped collector.
+    MetricsList metrics_;
+    std::chrono::steady_clock::time_point collected_;
+    bool warm_;
+
+    //! Background refresh thread, started on the first stale collect.
+    bool refreshing_;
+    bool stopping_;
+    std::condition_variable wake_;
+    std::thread worker_;
+
+    CachedCollectorStats stats_;
+
+    //! Guards all the state above.
+    std::mutex lock_;
+
+    //! Serialises calls to the wrapped collector.
+    /*!
+     * Always acquired before lock_, which is never held while
+     * the wrapped collector is running.
+     */
+    std::mutex lock_refresh_;
+
+    //! Same as refresh but expects lock_refresh_ to be held.
+    MetricsList refreshLocked();
+
+    //! Body of the background refresh thread.
+    void work();
+  };
+  typedef std::shared_ptr<CachedCollector> CachedCollectorRef;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_CACHED_H_
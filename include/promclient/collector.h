@@ -2,8 +2,14 @@
 #ifndef PROMCLIENT_COLLECTOR_H_
 #define PROMCLIENT_COLLECTOR_H_
 
+#include <chrono>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "promclient/metric.h"
@@ -20,12 +26,49 @@ namespace promclient {
 
     //! Returns zero or more metric descriptors.
     virtual DescriptorsList describe() = 0;
+
+    //! Returns true if collect() can return metrics describe() omits.
+    /*!
+     * Registries can't tell which metrics dynamic collectors export
+     * so they call them on every scrape filtered by metric name
+     * and drop the metrics that were not requested.
+     */
+    virtual bool dynamic();
   };
 
   //! Skip dealing with memory allocation directly.
   typedef std::shared_ptr<Collector> CollectorRef;
 
 
+  //! Statistics of the children cache of a labelled collector.
+  struct LabelledCacheStats {
+    //! Name of the first metric of the collector.
+    std::string name;
+
+    //! Number of cached children (including the overflow child).
+    std::size_t children;
+
+    //! Calls to labels() that found a cached child.
+    std::uint64_t hits;
+
+    //! Calls to labels() that created (or overflowed) a child.
+    std::uint64_t misses;
+  };
+
+  //! Interface for collectors that cache children by labels.
+  /*!
+   * Used by the registry self-instrumentation to find labelled
+   * collectors without knowing their child collector type.
+   */
+  class LabelledCache {
+   public:
+    virtual ~LabelledCache() = default;
+
+    //! Returns the statistics of the children cache.
+    virtual LabelledCacheStats cacheStats() = 0;
+  };
+
+
   //! Template class to support labels.
   /*!
    * Collectors can either support labels directly (usually custom collectors)
@@ -43,40 +86,137 @@ namespace promclient {
    *
    * The value of the child collector should be accessed through the
    * labeled collector only.
+   *
+   * The number of children can be capped with a cardinality limit.
+   * Once the limit is reached, requests for unseen label values are
+   * routed to a single overflow child (all labels set to OVERFLOW_VALUE)
+   * and counted in the `promclient_dropped_label_sets_total` metric.
+   *
+   * Children can also expire if they are idle for longer then a TTL.
+   * A child is idle if it was not returned by labels() within the TTL
+   * and no references to it are held outside the labelled collector
+   * (so updates through a stored reference are never lost).
+   * Idle children are removed on collect() or by calling expire().
    */
   template<typename ChildCollector>
-  class LabelledCollector : public Collector {
+  class LabelledCollector : public Collector, public LabelledCache {
    public:
     //! Alias shared_prt to child collector for ease.
     typedef std::shared_ptr<ChildCollector> Ref;
 
+    //! Label value assigned to all labels of the overflow child.
+    static const std::string OVERFLOW_VALUE;
+
    public:
+    //! Labelled collector that learns its descriptors from a child.
+    /*!
+     * A child is created with makeChild() the first time the collector
+     * is described.
+     */
     LabelledCollector(std::set<std::string> labels);
 
+    //! Labelled collector with known child descriptors.
+    /*!
+     * Descriptors are merged with the labels once, at construction.
+     * Subclasses can share child_descriptors_ with their children.
+     */
+    LabelledCollector(
+        std::set<std::string> labels, DescriptorsList child_descriptors
+    );
+
     MetricsList collect();
     DescriptorsList describe();
+    LabelledCacheStats cacheStats();
+
+    //! Limits the number of children to at most `limit` (0 for no limit).
+    /*!
+     * Children created before the limit is set are not removed.
+     */
+    void cardinality(std::size_t limit);
 
     //! Removes all cached collectors.
     void clear();
 
+    //! Removes idle children (see ttl).
+    /*!
+     * Called during collect() but can also be called periodically
+     * (for example from a background thread) to reclaim memory sooner.
+     */
+    void expire();
+
     //! Returns a collector with the given labels.
     Ref labels(std::map<std::string, std::string> labels);
 
     //! Removes a cached collector.
     void remove(std::map<std::string, std::string> labels);
 
+    //! Removes children idle for longer then `ttl` (0 to never expire).
+    void ttl(std::chrono::milliseconds ttl);
+
    protected:
+    //! Cached child collector with its labels.
+    struct Child {
+      std::map<std::string, std::string> labels;
+      Ref collector;
+      std::chrono::steady_clock::time_point touched;
+    };
+    typedef std::unordered_multimap<std::size_t, Child> ChildrenMap;
+
     //! Keep track of children by label values hash.
-    std::map<std::size_t, Ref> children_;
-    std::map<std::size_t, std::map<std::string, std::string>> labels_by_hash_;
+    /*!
+     * Label sets with colliding hashes share a bucket and are
+     * told apart by comparing the full labels.
+     */
+    ChildrenMap children_;
 
+    DescriptorsList child_descriptors_;
     DescriptorsList descriptors_;
     std::set<std::string> labels_;
 
+    //! Cardinality limit and overflow tracking.
+    std::size_t cardinality_;
+    std::uint64_t dropped_;
+    Ref overflow_;
+    DescriptorRef dropped_descriptor_;
+
+    //! Expiry of idle children.
+    std::chrono::milliseconds ttl_;
+
+    //! Lookups by labels() (see LabelledCacheStats).
+    std::uint64_t hits_;
+    std::uint64_t misses_;
+
     std::mutex lock_labels_;
 
     //! Create a new instance of a child collector.
     virtual Ref makeChild() = 0;
+
+    //! Create the child collector for a labels set.
+    /*!
+     * Calls makeChild by default, override for children that
+     * need to know their labels.
+     */
+    virtual Ref makeChildFor(const std::map<std::string, std::string>& labels);
+
+    //! Same as describe but expects lock_labels_ to be held.
+    const DescriptorsList& describeLocked();
+
+    //! Set descriptors_ to the child descriptors with our labels added.
+    void mergeDescriptors(const DescriptorsList& child_descriptors);
+
+    //! Same as expire but expects lock_labels_ to be held.
+    void expireLocked();
+
+    //! Returns the child with the given labels or children_.end().
+    typename ChildrenMap::iterator findChild(
+        std::size_t hash, const std::map<std::string, std::string>& labels
+    );
+
+    //! Returns the overflow child, creating it if needed.
+    Ref overflowChild();
+
+    //! Returns the labels of the overflow child.
+    std::map<std::string, std::string> overflowLabels() const;
   };
 
 }  // namespace promclient
@@ -2,39 +2,77 @@
 #ifndef PROMCLIENT_COLLECTOR_INC_H_
 #define PROMCLIENT_COLLECTOR_INC_H_
 
+#include <utility>
+
 #include "promclient/exceptions.h"
 #include "promclient/internal/utils.h"
 
 namespace promclient {
 
+  template<typename ChildCollector>
+  const std::string LabelledCollector<ChildCollector>::OVERFLOW_VALUE =
+    "__overflow__";
+
   template<typename ChildCollector>
   LabelledCollector<ChildCollector>::LabelledCollector(
       std::set<std::string> labels
   ) {
-    this->labels_ = labels;
+    this->labels_ = std::move(labels);
+    this->cardinality_ = 0;
+    this->dropped_ = 0;
+    this->hits_ = 0;
+    this->misses_ = 0;
+    this->ttl_ = std::chrono::milliseconds::zero();
+  }
+
+  template<typename ChildCollector>
+  LabelledCollector<ChildCollector>::LabelledCollector(
+      std::set<std::string> labels, DescriptorsList child_descriptors
+  ) : LabelledCollector(std::move(labels)) {
+    this->child_descriptors_ = std::move(child_descriptors);
+    this->mergeDescriptors(this->child_descriptors_);
   }
 
   template<typename ChildCollector>
   MetricsList LabelledCollector<ChildCollector>::collect() {
     std::lock_guard<std::mutex> lock(this->lock_labels_);
     MetricsList my_metrics;
+    this->expireLocked();
 
-    for (auto pair : this->children_) {
-      std::size_t child_id = pair.first;
-      std::map<std::string, std::string> child_labels;
-      MetricsList child_metrics = pair.second->collect();
-      child_labels = this->labels_by_hash_[child_id];
-
-      for (auto metric : child_metrics) {
+    // Decorate the samples of a child with the child's labels.
+    auto decorate = [&my_metrics](
+        Ref child, const std::map<std::string, std::string>& child_labels
+    ) {
+      MetricsList child_metrics = child->collect();
+      for (auto& metric : child_metrics) {
         std::vector<Sample> my_samples;
-        for (auto sample : metric.samples()) {
+        my_samples.reserve(metric.samples().size());
+        for (const auto& sample : metric.samples()) {
           std::map<std::string, std::string> labels = sample.labels();
           labels.insert(child_labels.begin(), child_labels.end());
-          Sample new_sample(sample.role(), sample.value(), labels);
-          my_samples.push_back(new_sample);
+          my_samples.emplace_back(
+              sample.role(), sample.value(), std::move(labels),
+              sample.exemplar(), sample.native()
+          );
         }
-        my_metrics.push_back(Metric(metric.descriptor(), my_samples));
+        my_metrics.emplace_back(metric.descriptor(), std::move(my_samples));
       }
+    };
+
+    for (const auto& pair : this->children_) {
+      decorate(pair.second.collector, pair.second.labels);
+    }
+
+    if (this->overflow_) {
+      decorate(this->overflow_, this->overflowLabels());
+    }
+
+    // Report dropped label sets for capped collectors.
+    if (this->cardinality_ != 0) {
+      const DescriptorsList& descriptors = this->describeLocked();
+      std::string name = descriptors.size() ? descriptors[0]->name() : "";
+      Sample dropped("", this->dropped_, {{"metric", name}});
+      my_metrics.push_back(Metric(this->dropped_descriptor_, {dropped}));
     }
     return my_metrics;
   }
@@ -42,26 +80,92 @@ namespace promclient {
   template<typename ChildCollector>
   DescriptorsList LabelledCollector<ChildCollector>::describe() {
     std::lock_guard<std::mutex> lock(this->lock_labels_);
+    DescriptorsList descriptors = this->describeLocked();
+    if (this->cardinality_ != 0) {
+      descriptors.push_back(this->dropped_descriptor_);
+    }
+    return descriptors;
+  }
+
+  template<typename ChildCollector>
+  const DescriptorsList& LabelledCollector<ChildCollector>::describeLocked() {
     if (this->descriptors_.size() == 0) {
       LabelledCollector<ChildCollector>::Ref child = this->makeChild();
-      DescriptorsList descs = child->describe();
-
-      for (auto desc : descs) {
-        std::set<std::string> labels = desc->labels();
-        labels.insert(this->labels_.begin(), this->labels_.end());
-        this->descriptors_.push_back(DescriptorRef(new Descriptor(
-            desc->name(), desc->type(), desc->help(), labels
-        )));
-      }
+      this->mergeDescriptors(child->describe());
     }
     return this->descriptors_;
   }
 
+  template<typename ChildCollector>
+  void LabelledCollector<ChildCollector>::mergeDescriptors(
+      const DescriptorsList& child_descriptors
+  ) {
+    this->descriptors_.clear();
+    this->descriptors_.reserve(child_descriptors.size());
+    for (const auto& desc : child_descriptors) {
+      std::set<std::string> labels = desc->labels();
+      labels.insert(this->labels_.begin(), this->labels_.end());
+      this->descriptors_.push_back(DescriptorRef(new Descriptor(
+          desc->name(), desc->type(), desc->help(), std::move(labels)
+      )));
+    }
+  }
+
+  template<typename ChildCollector>
+  void LabelledCollector<ChildCollector>::cardinality(std::size_t limit) {
+    std::lock_guard<std::mutex> lock(this->lock_labels_);
+    this->cardinality_ = limit;
+    if (limit != 0 && !this->dropped_descriptor_) {
+      this->dropped_descriptor_ = DescriptorRef(new Descriptor(
+          "promclient_dropped_label_sets_total", "counter",
+          "Label sets routed to the overflow series of capped metrics",
+          {"metric"}
+      ));
+    }
+  }
+
+  template<typename ChildCollector>
+  LabelledCacheStats LabelledCollector<ChildCollector>::cacheStats() {
+    std::lock_guard<std::mutex> lock(this->lock_labels_);
+    const DescriptorsList& descriptors = this->describeLocked();
+    LabelledCacheStats stats;
+    stats.name = descriptors.size() ? descriptors[0]->name() : "";
+    stats.children = this->children_.size() + (this->overflow_ ? 1 : 0);
+    stats.hits = this->hits_;
+    stats.misses = this->misses_;
+    return stats;
+  }
+
   template<typename ChildCollector>
   void LabelledCollector<ChildCollector>::clear() {
     std::lock_guard<std::mutex> lock(this->lock_labels_);
-    this->labels_by_hash_.clear();
     this->children_.clear();
+    this->overflow_.reset();
+  }
+
+  template<typename ChildCollector>
+  void LabelledCollector<ChildCollector>::expire() {
+    std::lock_guard<std::mutex> lock(this->lock_labels_);
+    this->expireLocked();
+  }
+
+  template<typename ChildCollector>
+  void LabelledCollector<ChildCollector>::expireLocked() {
+    if (this->ttl_ == std::chrono::milliseconds::zero()) {
+      return;
+    }
+
+    // Children referenced outside of the collector are never idle.
+    auto deadline = std::chrono::steady_clock::now() - this->ttl_;
+    auto it = this->children_.begin();
+    while (it != this->children_.end()) {
+      bool idle = it->second.touched < deadline;
+      if (idle && it->second.collector.use_count() == 1) {
+        it = this->children_.erase(it);
+      } else {
+        it++;
+      }
+    }
   }
 
   template<typename ChildCollector>
@@ -72,28 +176,88 @@ namespace promclient {
     std::lock_guard<std::mutex> lock(this->lock_labels_);
 
     // Attempt to find cached collector.
-    if (this->children_.find(hash) != this->children_.end()) {
-      return this->children_.at(hash);
+    bool expires = this->ttl_ != std::chrono::milliseconds::zero();
+    auto cached = this->findChild(hash, labels);
+    if (cached != this->children_.end()) {
+      if (expires) {
+        cached->second.touched = std::chrono::steady_clock::now();
+      }
+      this->hits_ += 1;
+      return cached->second.collector;
     }
 
     // This is a new labels set.
     // Check labels are all set an no unkown labels are passed.
-    for (std::string label : this->labels_) {
+    for (const std::string& label : this->labels_) {
       if (labels.find(label) == labels.end()) {
         throw promclient::UndefinedLabel(label);
       }
     }
-    for (auto pair : labels) {
+    for (const auto& pair : labels) {
       if (this->labels_.find(pair.first) == this->labels_.end()) {
         throw promclient::UnexpectedLabel(pair.first);
       }
     }
 
+    this->misses_ += 1;
+
+    // Route the new labels set to the overflow child if we are at capacity.
+    bool capped = this->cardinality_ != 0;
+    if (capped && this->children_.size() >= this->cardinality_) {
+      this->dropped_ += 1;
+      return this->overflowChild();
+    }
+
     // Create a new child and cache it.
-    std::shared_ptr<ChildCollector> child = this->makeChild();
+    Child child;
+    child.collector = this->makeChildFor(labels);
+    child.labels = std::move(labels);
+    if (expires) {
+      child.touched = std::chrono::steady_clock::now();
+    }
     this->children_.insert(std::make_pair(hash, child));
-    this->labels_by_hash_.insert(std::make_pair(hash, labels));
-    return child;
+    return child.collector;
+  }
+
+  template<typename ChildCollector>
+  typename LabelledCollector<ChildCollector>::ChildrenMap::iterator
+  LabelledCollector<ChildCollector>::findChild(
+      std::size_t hash, const std::map<std::string, std::string>& labels
+  ) {
+    auto range = this->children_.equal_range(hash);
+    for (auto it = range.first; it != range.second; it++) {
+      if (it->second.labels == labels) {
+        return it;
+      }
+    }
+    return this->children_.end();
+  }
+
+  template<typename ChildCollector>
+  std::shared_ptr<ChildCollector>
+  LabelledCollector<ChildCollector>::makeChildFor(
+      const std::map<std::string, std::string>& labels
+  ) {
+    return this->makeChild();
+  }
+
+  template<typename ChildCollector>
+  std::shared_ptr<ChildCollector>
+  LabelledCollector<ChildCollector>::overflowChild() {
+    if (!this->overflow_) {
+      this->overflow_ = this->makeChildFor(this->overflowLabels());
+    }
+    return this->overflow_;
+  }
+
+  template<typename ChildCollector>
+  std::map<std::string, std::string>
+  LabelledCollector<ChildCollector>::overflowLabels() const {
+    std::map<std::string, std::string> labels;
+    for (const std::string& label : this->labels_) {
+      labels[label] = LabelledCollector::OVERFLOW_VALUE;
+    }
+    return labels;
   }
 
   template<typename ChildCollector>
@@ -102,8 +266,20 @@ namespace promclient {
   ) {
     std::size_t hash = promclient::internal::HashLabels(labels);
     std::lock_guard<std::mutex> lock(this->lock_labels_);
-    this->labels_by_hash_.erase(this->labels_by_hash_.find(hash));
-    this->children_.erase(this->children_.find(hash));
+    auto child = this->findChild(hash, labels);
+    if (child != this->children_.end()) {
+      this->children_.erase(child);
+    }
+  }
+
+  template<typename ChildCollector>
+  void LabelledCollector<ChildCollector>::ttl(std::chrono::milliseconds ttl) {
+    std::lock_guard<std::mutex> lock(this->lock_labels_);
+    auto now = std::chrono::steady_clock::now();
+    this->ttl_ = ttl;
+    for (auto& pair : this->children_) {
+      pair.second.touched = now;
+    }
   }
 
 }  // namespace promclient
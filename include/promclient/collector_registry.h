@@ -2,14 +2,24 @@
 #ifndef PROMCLIENT_COLLECTOR_REGISTRY_H_
 #define PROMCLIENT_COLLECTOR_REGISTRY_H_
 
+#include <atomic>
+#include <cstdint>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "promclient/collector.h"
 
 namespace promclient {
+namespace internal {
+  class RegistryMetrics;
+}  // namespace internal
 
   //! Registry of collectors to pull metrics from.
   class CollectorRegistry {
@@ -22,6 +32,8 @@ namespace promclient {
     };
 
    public:
+    CollectorRegistry();
+
     //! Returns a list of metrics form all registered collectors.
     /*!
      * This methods supports collection strategies.
@@ -45,6 +57,19 @@ namespace promclient {
           CollectorRegistry::CollectStrategy::SORTED
     );
 
+    //! Returns the metrics with the given names.
+    /*!
+     * Only collectors that described at least one of the names when
+     * they were registered (and dynamic collectors) are called and
+     * metrics with other names are dropped, so targeted scrapes don't
+     * pay for a full collection.
+     */
+    MetricsList collect(
+        const std::set<std::string>& names,
+        CollectorRegistry::CollectStrategy strategy =
+          CollectorRegistry::CollectStrategy::SORTED
+    );
+
     //! Add a Collector to the regisrty.
     /*!
      * The missing `e` in `registr` is to avoid clashes
@@ -55,18 +80,83 @@ namespace promclient {
     //! Remove an existing collector from the registry.
     bool unregister(CollectorRef collector);
 
+    //! Exports metrics about the registry and its scrapes.
+    /*!
+     * See internal::RegistryMetrics for the metrics exported.
+     * Once enabled, the registry times each collector and exporters
+     * time each scrape; calling instrument again has no effect.
+     */
+    void instrument();
+
+    //! Returns the self-instrumentation collector, if enabled.
+    internal::RegistryMetrics* instrumentation();
+
    protected:
+    friend class internal::RegistryMetrics;
+
     //! Thread safe access to the registry.
     std::mutex mutex_;
 
-    //! Keep track of registered collectors.
-    std::vector<CollectorRef> collectors_;
+    //! Self-instrumentation, owned by instrumentation_ once enabled.
+    std::atomic<internal::RegistryMetrics*> instrumented_;
+    std::shared_ptr<internal::RegistryMetrics> instrumentation_;
+
+    //! Keep track of registered collectors, in registration order.
+    std::list<CollectorRef> collectors_;
+
+    //! Position of each registered collector in collectors_.
+    /*!
+     * The same collector can be registered more than once
+     * and unregister removes all of its entries.
+     */
+    std::unordered_map<
+      Collector*, std::vector<std::list<CollectorRef>::iterator>
+    > collectors_index_;
+
+    //! Registered collectors by the names of the metrics they describe.
+    std::unordered_map<
+      std::string, std::vector<Collector*>
+    > collectors_by_name_;
+
+    //! Names of the metrics described by each registered collector.
+    std::unordered_map<
+      Collector*, std::vector<std::string>
+    > collector_names_;
+
+    //! Registered collectors that are called by all filtered scrapes.
+    std::unordered_set<Collector*> dynamic_collectors_;
+
+    //! Immutable list of collectors used by scrapes.
+    struct Snapshot {
+      std::uint64_t epoch;
+      std::vector<CollectorRef> collectors;
+    };
+
+    //! Incremented (with mutex_ held) each time collectors_ changes.
+    std::atomic<std::uint64_t> epoch_;
+
+    //! Collectors as of a past epoch, read with std::atomic_load.
+    /*!
+     * Registration only bumps epoch_ so it stays O(1).
+     * The first scrape to see a stale snapshot rebuilds it, so each
+     * change is copied once no matter how many scrapes follow it.
+     */
+    std::shared_ptr<const Snapshot> snapshot_;
 
     //! Keep track of metric hash by name.
-    std::map<std::string, std::size_t> metrics_hash_;
+    std::unordered_map<std::string, std::size_t> metrics_hash_;
+
+    //! Returns the collectors to scrape, rebuilding them if stale.
+    std::shared_ptr<const std::vector<CollectorRef>> snapshot();
 
     //! Implements the sorted collection strategy.
-    MetricsList sortedCollect();
+    /*!
+     * Metrics not in names are dropped, unless names is nullptr.
+     */
+    MetricsList sortedCollect(
+        const std::vector<CollectorRef>& collectors,
+        const std::set<std::string>* names
+    );
   };
 
 }  // namespace promclient
@@ -2,36 +2,100 @@
 #ifndef PROMCLIENT_COUNTER_H_
 #define PROMCLIENT_COUNTER_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <typeindex>
+#include <unordered_map>
 
 #include "promclient/collector.h"
+#include "promclient/internal/atomic_double.h"
+#include "promclient/internal/exemplar_slot.h"
 
 
 namespace promclient {
 
   //! Simple ever-increasing counter.
   class Counter : public Collector {
+   public:
+    //! Increments a counter if it is destroyed by an exception.
+    class ExceptionGuard {
+     public:
+      explicit ExceptionGuard(Counter* counter);
+      ExceptionGuard(ExceptionGuard&& other);
+      ~ExceptionGuard();
+
+      ExceptionGuard(const ExceptionGuard&) = delete;
+      ExceptionGuard& operator=(const ExceptionGuard&) = delete;
+
+     protected:
+      Counter* counter_;
+      int uncaught_;
+    };
+
    public:
     Counter(std::string name, std::string help, double initial = 0);
 
+    //! Create a counter with an existing counter descriptor.
+    /*!
+     * Used by labelled counters so all children share one descriptor.
+     */
+    explicit Counter(DescriptorRef descriptor, double initial = 0);
+    ~Counter();
+
     //! Increment the counter by value (1 by default).
     void inc(double value = 1);
 
+    //! Increment the counter and record an exemplar for the increment.
+    /*!
+     * Only the latest exemplar is kept and it is only exposed in the
+     * OpenMetrics format.
+     * Exemplar storage is allocated the first time an exemplar is
+     * recorded; after that exemplars are recorded without allocations.
+     */
+    void inc(double value, const std::map<std::string, std::string>& labels);
+
+    //! Increments the counter if the returned guard is unwound.
+    /*!
+     * The guard increments the counter when it is destroyed while an
+     * exception thrown after its creation propagates; it costs two
+     * reads of the uncaught exceptions count otherwise.
+     */
+    ExceptionGuard countExceptions();
+
+    //! Calls a function and increments the counter if it throws.
+    /*!
+     * Only exceptions of type Exception (or derived) are counted,
+     * all exceptions are counted if Exception is void.
+     * The exception is always rethrown and the function result returned.
+     */
+    template<typename Exception = void, typename Function>
+    auto countExceptions(Function&& function) -> decltype(function());
+
     virtual MetricsList collect();
     virtual DescriptorsList describe();
 
    protected:
-    std::string help_;
-    std::string name_;
-    double value_;
+    //! Create a counter that stores its value in externally owned memory.
+    Counter(std::string name, std::string help, internal::AtomicDouble* value);
+    Counter(DescriptorRef descriptor, internal::AtomicDouble* value);
+
+    //! Lock free, thread safe, value.
+    /*!
+     * The value points to local_ unless the counter was created
+     * with externally owned storage (i.e, shared memory).
+     */
+    internal::AtomicDouble local_;
+    internal::AtomicDouble* value_;
 
     //! Descriptor of the counter.
     DescriptorRef descriptor_;
 
-    //! Thread safe access to the value.
-    std::mutex mutex_;
+    //! Latest exemplar, allocated on first use.
+    std::atomic<internal::ExemplarSlot*> exemplar_;
   };
   typedef std::shared_ptr<Counter> CounterRef;
 
@@ -44,14 +108,42 @@ namespace promclient {
         std::set<std::string> labels
     );
 
+    //! Calls a function and counts its exceptions by type.
+    /*!
+     * The exception type name is stored in the `label` label, the
+     * other labels are taken from `labels`.
+     * Only the first MAX_EXCEPTION_TYPES types are named, later
+     * types are recorded as OTHER_EXCEPTION to bound the series count.
+     * See Counter::countExceptions for the meaning of Exception.
+     * Labels that don't match the counter throw UndefinedLabel in
+     * place of the exception thrown by the function.
+     */
+    template<typename Exception = void, typename Function>
+    auto countExceptions(
+        const std::string& label, Function&& function,
+        std::map<std::string, std::string> labels = {}
+    ) -> decltype(function());
+
+    //! Maximum number of exception types recorded by name.
+    static const std::size_t MAX_EXCEPTION_TYPES = 32;
+
+    //! Label value of exception types past MAX_EXCEPTION_TYPES.
+    static const std::string OTHER_EXCEPTION;
+
    protected:
-    std::string help_;
-    std::string name_;
+    //! Names of the exception types seen by countExceptions.
+    std::unordered_map<std::type_index, std::string> exception_names_;
+    std::mutex exception_names_lock_;
 
     virtual Ref makeChild();
+
+    //! Returns the label value of the exception being handled.
+    std::string exceptionName();
   };
   typedef std::shared_ptr<LabelledCounter> LabelledCounterRef;
 
 }  // namespace promclient
 
+#include "promclient/counter.inc.h"
+
 #endif  // PROMCLIENT_COUNTER_H_
@@ -0,0 +1,37 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_COUNTER_INC_H_
+#define PROMCLIENT_COUNTER_INC_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "promclient/internal/exception_tracking.h"
+
+namespace promclient {
+
+  template<typename Exception, typename Function>
+  auto Counter::countExceptions(Function&& function)
+      -> decltype(function()) {
+    return internal::CatchExceptions<Exception>::Call(
+        std::forward<Function>(function), [this]() { this->inc(); }
+    );
+  }
+
+
+  template<typename Exception, typename Function>
+  auto LabelledCounter::countExceptions(
+      const std::string& label, Function&& function,
+      std::map<std::string, std::string> labels
+  ) -> decltype(function()) {
+    return internal::CatchExceptions<Exception>::Call(
+        std::forward<Function>(function), [&]() {
+          labels[label] = this->exceptionName();
+          this->labels(std::move(labels))->inc();
+        }
+    );
+  }
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_COUNTER_INC_H_
@@ -25,6 +25,18 @@ namespace promclient {
     explicit InvalidCollector(std::string what);
   };
 
+  //! Thrown when exemplar labels are too long.
+  class InvalidExemplar : public std::runtime_error {
+   public:
+    explicit InvalidExemplar(std::string what);
+  };
+
+  //! Thrown when a native histogram is created with invalid options.
+  class InvalidHistogram : public std::runtime_error {
+   public:
+    explicit InvalidHistogram(std::string what);
+  };
+
   //! Thrown when a metric label fails to validate.
   class InvalidMetricLabel : public std::runtime_error {
    public:
@@ -49,6 +61,12 @@ namespace promclient {
     MissingCollectorLabels();
   };
 
+  //! Thrown when a builder tries to build a collector without a callback.
+  class MissingCollectorFunc : public std::runtime_error {
+   public:
+    MissingCollectorFunc();
+  };
+
   //! Thrown when a builder tries to build a collector without a name.
   class NamelessCollector : public std::runtime_error {
    public:
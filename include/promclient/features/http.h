@@ -3,17 +3,71 @@
 #define PROMCLIENT_FEATURES_HTTP_H_
 
 #include <onion/onion.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "promclient/collector_registry.h"
+#include "promclient/internal/semaphore.h"
 
 
 namespace promclient {
 namespace features {
 
+  //! Limits on the scrapes served by an endpoint.
+  struct EndpointLimits {
+    //! Maximum number of concurrent scrapes (0 for no limit).
+    std::size_t concurrency;
+
+    //! Maximum wait for a concurrency slot before replying 503.
+    std::chrono::milliseconds timeout;
+
+    EndpointLimits(
+        std::size_t concurrency = 0,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(0)
+    );
+  };
+
+
   //! HTTP server (based on libonion) to run expose metrics.
+  /*!
+   * Scrapes are rendered in memory and tagged with an ETag (a hash of
+   * the body): clients that send it back with If-None-Match get a 304
+   * without the body when nothing changed.
+   * The registry's per-scrape self-instrumentation metrics (see
+   * CollectorRegistry::instrument) are not hashed, or no scrape would
+   * ever match the previous one.
+   *
+   * Each endpoint exposes one registry so metrics with different
+   * collection costs can be scraped at different intervals:
+   *
+   *     server.addEndpoint("/metrics/heavy", &heavy, EndpointLimits(1));
+   *
+   * The registry passed to the constructor is exposed at /metrics.
+   */
   class HttpExporter {
    protected:
+    //! Registry and limits of a path.
+    struct Endpoint {
+      HttpExporter* exporter;
+      std::string path;
+      CollectorRegistry* registry;
+      EndpointLimits limits;
+      internal::Semaphore slots;
+
+      //! Size of the last body, to size the buffer of the next scrape.
+      std::atomic<std::size_t> body_size;
+
+      Endpoint(
+          HttpExporter* exporter, std::string path,
+          CollectorRegistry* registry, EndpointLimits limits
+      );
+    };
+
     static onion_connection_status CallMetrics(
         void* instance, onion_request* request,
         onion_response* response
@@ -26,6 +80,16 @@ namespace features {
     );
     ~HttpExporter();
 
+    //! Exposes a registry at a path (replacing any registry at it).
+    /*!
+     * Must be called before mount().
+     * A nullptr registry exposes the default registry.
+     */
+    void addEndpoint(
+        std::string path, CollectorRegistry* registry,
+        EndpointLimits limits = EndpointLimits()
+    );
+
     //! Returns the endpoint we are listening on.
     std::string endpoint();
 
@@ -43,11 +107,18 @@ namespace features {
     std::string port_;
 
     onion* onion_;
-    CollectorRegistry* registry_;
+    std::vector<std::unique_ptr<Endpoint>> endpoints_;
 
-    //! Handles requests to /metrics
+    //! Handles requests to a metrics endpoint.
     onion_connection_status metrics(
-        onion_request* request, onion_response* response
+        Endpoint* endpoint, onion_request* request, onion_response* response
+    );
+
+    //! Sends a rendered body, honouring HEAD and If-None-Match.
+    onion_connection_status respond(
+        onion_request* request, onion_response* response,
+        const char* content_type, const std::string& body,
+        const std::string& etag
     );
   };
 
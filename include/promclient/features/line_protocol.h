@@ -0,0 +1,127 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_FEATURES_LINE_PROTOCOL_H_
+#define PROMCLIENT_FEATURES_LINE_PROTOCOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/line_formatter.h"
+
+
+namespace promclient {
+namespace features {
+
+  //! Options of a LineExporter.
+  struct LineExporterOptions {
+    //! Interval between pushes.
+    std::chrono::milliseconds interval;
+
+    //! Maximum size of a UDP datagram payload.
+    /*!
+     * The default fits an Ethernet frame with IPv6 and UDP headers.
+     * Lines longer then this are sent in their own datagram.
+     */
+    std::size_t mtu;
+
+    //! Send over a TCP connection instead of UDP datagrams.
+    bool tcp;
+
+    //! Timeout of connections and sends.
+    std::chrono::milliseconds timeout;
+
+    LineExporterOptions();
+  };
+
+
+  //! Counts of pushes made by a LineExporter.
+  struct LineExporterStats {
+    //! Pushes sent successfully.
+    std::uint64_t pushes;
+
+    //! Pushes that failed to send.
+    std::uint64_t errors;
+
+    //! Datagrams (or TCP writes) sent.
+    std::uint64_t packets;
+
+    //! Bytes of lines sent.
+    std::uint64_t bytes;
+  };
+
+
+  //! Pushes metrics to StatsD, Graphite or InfluxDB line receivers.
+  /*!
+   * Every interval the registry is collected and formatted with a
+   * LineFormatter and the lines are packed into as few packets as
+   * possible (up to the MTU for UDP, 64KiB writes for TCP).
+   * UDP packets are sent with a single sendmmsg call where available
+   * so a push costs a few system calls.
+   *
+   * Buffers are reused across pushes and TCP connections are kept
+   * open (and reopened by the next push after an error).
+   */
+  class LineExporter : protected internal::LineFormatBridge {
+   public:
+    LineExporter(
+        std::string host, std::string port,
+        internal::LineFormatter::Protocol protocol,
+        CollectorRegistry* registry = nullptr,
+        LineExporterOptions options = LineExporterOptions()
+    );
+    ~LineExporter();
+
+    //! Collects the registry and sends the lines now.
+    /*!
+     * Throws std::runtime_error if the lines can't be sent.
+     */
+    void push();
+
+    //! Pushes every interval from a background thread.
+    void start();
+
+    //! Returns the counts of pushes.
+    LineExporterStats stats();
+
+    //! Stops background pushes.
+    void stop();
+
+   protected:
+    std::string host_;
+    std::string port_;
+    LineExporterOptions options_;
+    int fd_;
+
+    //! Packets of the last push (only the first `packets_used_`).
+    std::vector<std::string> packets_;
+    std::size_t packets_used_;
+    std::size_t packet_size_;
+
+    //! Serialises pushes, which share the socket and buffers.
+    std::mutex lock_push_;
+
+    //! Background pusher state and stats.
+    std::mutex lock_;
+    std::condition_variable stopped_;
+    bool stopping_;
+    LineExporterStats stats_;
+    std::thread worker_;
+
+    //! Sends the packed packets, returns false on errors.
+    bool send();
+
+    //! Body of the background thread.
+    void work();
+
+    void write(const std::string& line);
+  };
+
+}  // namespace features
+}  // namespace promclient
+
+#endif  // PROMCLIENT_FEATURES_LINE_PROTOCOL_H_
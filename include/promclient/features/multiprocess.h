@@ -0,0 +1,292 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_FEATURES_MULTIPROCESS_H_
+#define PROMCLIENT_FEATURES_MULTIPROCESS_H_
+
+#include <sys/types.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "promclient/collector.h"
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/gauge.h"
+#include "promclient/internal/atomic_double.h"
+#include "promclient/internal/builder.h"
+
+
+namespace promclient {
+namespace features {
+
+  //! Memory mapped file storing the metric values of one process.
+  /*!
+   * Each process writes to its own file, named `promclient_<pid>.db`,
+   * in the configured directory.
+   * The file is an array of fixed-size records, one per metric and
+   * labels set, and each record holds an AtomicDouble so updates from
+   * the owning process are lock free.
+   *
+   * Records are never removed and the file is never resized so
+   * pointers to values remain valid for the life of the process.
+   * An existing file for the same pid (left by an exited process the
+   * pid was reused from) is taken over rather than truncated: its
+   * records are reused so aggregated counters do not go backwards.
+   */
+  class MultiProcessStore {
+   public:
+    //! Set the directory process files are written to.
+    /*!
+     * Must be called before any multi-process metric is created.
+     * The capacity is the maximum number of records per process.
+     */
+    static void Configure(std::string directory, std::size_t capacity = 4096);
+
+    //! Returns the store for the current process.
+    /*!
+     * A new store is opened the first time this is called after a fork.
+     * Metrics created before the fork keep using the parent's records,
+     * which are shared with the children: increments stay atomic across
+     * processes so aggregated values are still correct.
+     *
+     * Gauges aggregated over live processes only are kept in a separate
+     * `promclient_live_<pid>.db` file (see MarkProcessDead).
+     */
+    static MultiProcessStore* Current(bool live = false);
+
+    //! Size of the record key, in bytes.
+    static const std::size_t KEY_SIZE = 488;
+
+   public:
+    MultiProcessStore(std::string path, std::size_t capacity);
+    ~MultiProcessStore();
+
+    //! Returns the value for the given metric, allocating it if needed.
+    /*!
+     * Throws std::runtime_error if the store is full or if the metric
+     * name, type, help and labels do not fit in the record key.
+     */
+    internal::AtomicDouble* value(
+        const std::string& name, const std::string& type,
+        const std::string& help,
+        const std::map<std::string, std::string>& labels
+    );
+
+   protected:
+    std::size_t capacity_;
+    int fd_;
+    void* map_;
+    std::string path_;
+    std::size_t size_;
+
+    //! Allocated values by record key.
+    std::map<std::string, internal::AtomicDouble*> values_;
+
+    //! Thread safe allocation of records.
+    std::mutex mutex_;
+  };
+
+
+  //! Counter storing its value in the process MultiProcessStore.
+  class MultiProcessCounter : public Counter {
+   public:
+    MultiProcessCounter(
+        std::string name, std::string help,
+        std::map<std::string, std::string> labels = {}
+    );
+
+    //! Create a counter sharing an existing descriptor.
+    MultiProcessCounter(
+        DescriptorRef descriptor,
+        const std::map<std::string, std::string>& labels
+    );
+  };
+  typedef std::shared_ptr<MultiProcessCounter> MultiProcessCounterRef;
+
+  //! Labelled counter with children in the process MultiProcessStore.
+  class LabelledMultiProcessCounter : public LabelledCollector<Counter> {
+   public:
+    LabelledMultiProcessCounter(
+        std::string name, std::string help,
+        std::set<std::string> labels
+    );
+
+   protected:
+    virtual Ref makeChild();
+    virtual Ref makeChildFor(const std::map<std::string, std::string>& labels);
+  };
+  typedef std::shared_ptr<LabelledMultiProcessCounter>
+    LabelledMultiProcessCounterRef;
+
+
+  //! Gauge storing its value in the process MultiProcessStore.
+  class MultiProcessGauge : public Gauge {
+   public:
+    //! How the values of different processes are aggregated.
+    /*!
+     *   * ALL: one series per process, with an extra `pid` label.
+     *   * LIVEALL: like ALL but only for live processes.
+     *   * LIVESUM: the sum of the values of live processes.
+     *   * MAX: the largest value of any process.
+     *   * MIN: the smallest value of any process.
+     *   * SUM: the sum of the values of all processes.
+     *
+     * ALL, MAX, MIN and SUM also include processes that have exited.
+     */
+    enum Mode {
+      ALL = 0,
+      LIVEALL = 1,
+      LIVESUM = 2,
+      MAX = 3,
+      MIN = 4,
+      SUM = 5
+    };
+
+   public:
+    MultiProcessGauge(
+        std::string name, std::string help,
+        std::map<std::string, std::string> labels = {}, Mode mode = ALL
+    );
+
+    //! Create a gauge sharing an existing descriptor.
+    MultiProcessGauge(
+        DescriptorRef descriptor,
+        const std::map<std::string, std::string>& labels, Mode mode = ALL
+    );
+  };
+  typedef std::shared_ptr<MultiProcessGauge> MultiProcessGaugeRef;
+
+  //! Labelled gauge with children in the process MultiProcessStore.
+  class LabelledMultiProcessGauge : public LabelledCollector<Gauge> {
+   public:
+    LabelledMultiProcessGauge(
+        std::string name, std::string help,
+        std::set<std::string> labels,
+        MultiProcessGauge::Mode mode = MultiProcessGauge::ALL
+    );
+
+   protected:
+    MultiProcessGauge::Mode mode_;
+
+    virtual Ref makeChild();
+    virtual Ref makeChildFor(const std::map<std::string, std::string>& labels);
+  };
+  typedef std::shared_ptr<LabelledMultiProcessGauge>
+    LabelledMultiProcessGaugeRef;
+
+
+  //! Builder for multi-process counters and labelled counters.
+  typedef
+    promclient::internal::SimpleBuilder<
+      MultiProcessCounter, LabelledMultiProcessCounter
+    >
+    MultiProcessCounterBuilder;
+
+
+  //! Builder for labelled multi-process gauges.
+  class LabelledMultiProcessGaugeBuilder {
+   public:
+    LabelledMultiProcessGaugeBuilder();
+
+    //! Set the maximum number of label sets (0 for no limit).
+    LabelledMultiProcessGaugeBuilder cardinality(std::size_t limit);
+
+    //! Set the allowed metric labels.
+    LabelledMultiProcessGaugeBuilder labels(std::set<std::string> labels);
+
+    //! Set the metric description.
+    LabelledMultiProcessGaugeBuilder help(std::string help);
+
+    //! Set how values are aggregated across processes.
+    LabelledMultiProcessGaugeBuilder mode(MultiProcessGauge::Mode mode);
+
+    //! Set the metric name.
+    LabelledMultiProcessGaugeBuilder name(std::string name);
+
+    //! Returns a new LabelledMultiProcessGauge.
+    LabelledMultiProcessGaugeRef build();
+
+    //! Register and return a new LabelledMultiProcessGauge.
+    LabelledMultiProcessGaugeRef registr(
+        CollectorRegistry* registry = nullptr
+    );
+
+   protected:
+    std::size_t cardinality_;
+    bool help_set_;
+    std::string help_;
+    std::set<std::string> labels_;
+    MultiProcessGauge::Mode mode_;
+    std::string name_;
+  };
+
+  //! Builder for multi-process gauges and labelled gauges.
+  class MultiProcessGaugeBuilder {
+   public:
+    MultiProcessGaugeBuilder();
+
+    //! Set the allowed metric labels.
+    LabelledMultiProcessGaugeBuilder labels(std::set<std::string> labels);
+
+    //! Set the metric description.
+    MultiProcessGaugeBuilder help(std::string help);
+
+    //! Set how values are aggregated across processes.
+    MultiProcessGaugeBuilder mode(MultiProcessGauge::Mode mode);
+
+    //! Set the metric name.
+    MultiProcessGaugeBuilder name(std::string name);
+
+    //! Returns a new MultiProcessGauge.
+    MultiProcessGaugeRef build();
+
+    //! Register and return a new MultiProcessGauge.
+    MultiProcessGaugeRef registr(CollectorRegistry* registry = nullptr);
+
+   protected:
+    bool help_set_;
+    std::string help_;
+    MultiProcessGauge::Mode mode_;
+    std::string name_;
+  };
+
+
+  //! Removes the live gauge values of a process that has exited.
+  /*!
+   * Call this (typically from the master process, when a worker is
+   * reaped) so LIVEALL and LIVESUM gauges stop including the process.
+   * The configured MultiProcessStore directory is used.
+   */
+  void MarkProcessDead(pid_t pid);
+
+
+  //! Collects metrics from all process files in a directory.
+  /*!
+   * Counter values for the same labels are summed across processes,
+   * gauges are aggregated according to their MultiProcessGauge::Mode.
+   *
+   * Register this collector in the registry used by the exporter
+   * (typically a dedicated registry in the process serving scrapes).
+   * Since metric names are only known at collection time, the
+   * collector only describes the `promclient_multiprocess_files` gauge
+   * and is dynamic (see Collector::dynamic).
+   */
+  class MultiProcessCollector : public Collector {
+   public:
+    explicit MultiProcessCollector(std::string directory);
+
+    MetricsList collect();
+    DescriptorsList describe();
+    bool dynamic();
+
+   protected:
+    std::string directory_;
+    DescriptorRef files_descriptor_;
+  };
+
+}  // namespace features
+}  // namespace promclient
+
+#endif  // PROMCLIENT_FEATURES_MULTIPROCESS_H_
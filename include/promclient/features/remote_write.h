@@ -0,0 +1,141 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_FEATURES_REMOTE_WRITE_H_
+#define PROMCLIENT_FEATURES_REMOTE_WRITE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/remote_write.h"
+
+
+namespace promclient {
+namespace features {
+
+  //! Options of a RemoteWriteExporter.
+  struct RemoteWriteOptions {
+    //! Interval between snapshots of the registry.
+    std::chrono::milliseconds interval;
+
+    //! Number of queues sending requests in parallel.
+    std::size_t shards;
+
+    //! Samples each shard can queue (new samples are dropped when full).
+    std::size_t capacity;
+
+    //! Maximum number of samples in a request.
+    std::size_t max_samples_per_send;
+
+    //! Attempts after the first before a request is given up.
+    std::size_t max_retries;
+
+    //! Wait before retrying, doubled after each attempt.
+    std::chrono::milliseconds min_backoff;
+    std::chrono::milliseconds max_backoff;
+
+    //! Timeout of each connection and socket operation.
+    std::chrono::milliseconds timeout;
+
+    RemoteWriteOptions();
+  };
+
+
+  //! Counts of samples handled by a RemoteWriteExporter.
+  struct RemoteWriteStats {
+    //! Samples accepted by the receiver.
+    std::uint64_t sent;
+
+    //! Samples dropped because a shard queue was full.
+    std::uint64_t dropped;
+
+    //! Samples in requests that were given up.
+    std::uint64_t failed;
+
+    //! Requests that were retried.
+    std::uint64_t retries;
+  };
+
+
+  //! Pushes metrics to a Prometheus remote write receiver.
+  /*!
+   * For hosts Prometheus can't scrape: the registry is collected every
+   * interval and the samples are queued to a fixed number of shards.
+   * Series always map to the same shard so their samples are sent in
+   * order, while shards send `prometheus.WriteRequest` messages
+   * (snappy compressed) in parallel from background threads.
+   *
+   * Requests that fail with a network error, a 5xx or a 429 response
+   * are retried with exponential backoff; other responses are final.
+   *
+   * Only `http://` URLs are supported, TLS can be added with a local
+   * proxy.
+   *
+   * See https://prometheus.io/docs/concepts/remote_write_spec/
+   */
+  class RemoteWriteExporter {
+   public:
+    RemoteWriteExporter(
+        std::string url, CollectorRegistry* registry = nullptr,
+        RemoteWriteOptions options = RemoteWriteOptions()
+    );
+    ~RemoteWriteExporter();
+
+    //! Collects the registry now and queues its samples.
+    void push();
+
+    //! Starts the shards and the periodic snapshots.
+    void start();
+
+    //! Returns the counts of handled samples.
+    RemoteWriteStats stats();
+
+    //! Stops the snapshots and waits for the shards to send queued samples.
+    /*!
+     * Requests that fail while stopping are not retried.
+     */
+    void stop();
+
+   protected:
+    //! Queue of samples sent by one thread.
+    struct Shard {
+      std::deque<internal::RemoteSeries> queue;
+      std::thread worker;
+    };
+
+    std::string host_;
+    std::string path_;
+    std::string port_;
+    RemoteWriteOptions options_;
+    CollectorRegistry* registry_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::thread snapshots_;
+
+    //! Guards queues, stats and the stopping flag.
+    std::mutex lock_;
+    std::condition_variable queued_;
+    std::condition_variable stopped_;
+    bool started_;
+    bool stopping_;
+    RemoteWriteStats stats_;
+
+    //! Sends a compressed request, retrying recoverable failures.
+    void send(const std::string& body, std::size_t samples);
+
+    //! Body of the snapshots thread.
+    void snapshot();
+
+    //! Body of a shard thread.
+    void work(Shard* shard);
+  };
+
+}  // namespace features
+}  // namespace promclient
+
+#endif  // PROMCLIENT_FEATURES_REMOTE_WRITE_H_
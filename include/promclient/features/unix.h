@@ -0,0 +1,122 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_FEATURES_UNIX_H_
+#define PROMCLIENT_FEATURES_UNIX_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/text_formatter.h"
+
+
+namespace promclient {
+namespace features {
+
+  //! Exposes metrics to local clients over a Unix domain socket.
+  /*!
+   * Each client that connects is sent the text exposition and the
+   * connection is closed: there is no request to parse, so a client
+   * is as simple as `socat - UNIX-CONNECT:<path>`.
+   *
+   * Clients are served one at a time, from the thread that called
+   * listen(), and the exposition is rendered into a reused buffer.
+   * Clients that stop reading are dropped once a write blocks for
+   * longer than the timeout, so they can't hold up other clients.
+   */
+  class UnixSocketExporter {
+   public:
+    explicit UnixSocketExporter(
+        std::string path, CollectorRegistry* registry = nullptr,
+        internal::TextFormatter::Format format =
+          internal::TextFormatter::Format::PROMETHEUS,
+        std::chrono::milliseconds timeout = std::chrono::seconds(5)
+    );
+    ~UnixSocketExporter();
+
+    //! Returns the path of the socket.
+    std::string endpoint();
+
+    //! Serves clients until stop() is called.
+    void listen();
+
+    //! Creates the socket (replacing any file at the path).
+    void mount();
+
+    //! Stops listen() and the socket is removed.
+    void stop();
+
+   protected:
+    std::string buffer_;
+    int fd_;
+    internal::TextFormatter::Format format_;
+    std::string path_;
+    CollectorRegistry* registry_;
+    std::atomic<bool> stopping_;
+    std::chrono::milliseconds timeout_;
+
+    //! Writes the exposition to a connected client.
+    void serve(int client);
+  };
+
+
+  //! Periodically writes metrics to a file.
+  /*!
+   * Meant for node_exporter's textfile collector: the exposition is
+   * written to a temporary file (the path with `.tmp` appended) that
+   * is then synced and renamed over the path, so readers never see
+   * partial files (even after a crash).
+   *
+   * Files are written by a background thread, started with start(),
+   * from a reused buffer.
+   */
+  class TextFileExporter {
+   public:
+    explicit TextFileExporter(
+        std::string path, CollectorRegistry* registry = nullptr
+    );
+    ~TextFileExporter();
+
+    //! Writes the file now and every `interval` in the background.
+    /*!
+     * Errors in background writes are ignored and the write is
+     * retried at the next interval.
+     */
+    void start(std::chrono::milliseconds interval);
+
+    //! Stops background writes (the last file is left in place).
+    void stop();
+
+    //! Writes the file now.
+    /*!
+     * Throws std::runtime_error if the file can't be written.
+     */
+    void write();
+
+   protected:
+    std::string buffer_;
+    std::string path_;
+    CollectorRegistry* registry_;
+    std::string temp_path_;
+
+    //! Serialises writes, which share the buffer and temporary file.
+    std::mutex lock_write_;
+
+    //! Background writer state.
+    std::chrono::milliseconds interval_;
+    bool stopping_;
+    std::condition_variable wake_;
+    std::thread worker_;
+    std::mutex lock_worker_;
+
+    //! Body of the background writer thread.
+    void work();
+  };
+
+}  // namespace features
+}  // namespace promclient
+
+#endif  // PROMCLIENT_FEATURES_UNIX_H_
@@ -0,0 +1,127 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_FUNC_H_
+#define PROMCLIENT_FUNC_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "promclient/collector.h"
+
+
+namespace promclient {
+
+  //! Callback returning the current value of a metric.
+  typedef std::function<double()> ValueFunc;
+
+  //! Values of a labelled metric, keyed by labels set.
+  typedef std::map<std::map<std::string, std::string>, double> LabelledValues;
+
+  //! Callback returning the current values of a labelled metric.
+  typedef std::function<LabelledValues()> LabelledValuesFunc;
+
+
+  //! Collector that reads its value from a callback.
+  /*!
+   * The callback is only invoked by collect(), from the thread
+   * collecting the metrics, so values that are already tracked
+   * elsewhere (queue depths, pool sizes, ...) cost nothing until
+   * they are scraped.
+   * The callback must be thread safe if the metric is collected
+   * from more then one thread.
+   */
+  class FuncCollector : public Collector {
+   public:
+    FuncCollector(DescriptorRef descriptor, ValueFunc func);
+
+    MetricsList collect();
+    DescriptorsList describe();
+
+   protected:
+    DescriptorRef descriptor_;
+    ValueFunc func_;
+  };
+
+
+  //! Counter with the value returned by a callback.
+  /*!
+   * The callback is responsible for returning non-decreasing values.
+   */
+  class CounterFunc : public FuncCollector {
+   public:
+    CounterFunc(std::string name, std::string help, ValueFunc func);
+  };
+  typedef std::shared_ptr<CounterFunc> CounterFuncRef;
+
+
+  //! Gauge with the value returned by a callback.
+  class GaugeFunc : public FuncCollector {
+   public:
+    GaugeFunc(std::string name, std::string help, ValueFunc func);
+  };
+  typedef std::shared_ptr<GaugeFunc> GaugeFuncRef;
+
+
+  //! Collector that enumerates labelled values from a callback.
+  /*!
+   * Each labels set returned by the callback is a series of the
+   * metric, so series appear and disappear with the callback values.
+   * Label sets must define all (and only) the collector labels
+   * and label values must be valid UTF-8.
+   *
+   * Invalid label sets are dropped, so one bad value does not fail
+   * the whole scrape, and counted in the
+   * `promclient_invalid_label_sets_total` metric.
+   */
+  class LabelledFuncCollector : public Collector {
+   public:
+    LabelledFuncCollector(
+        DescriptorRef descriptor, std::set<std::string> labels,
+        LabelledValuesFunc func
+    );
+
+    MetricsList collect();
+    DescriptorsList describe();
+
+   protected:
+    DescriptorRef descriptor_;
+    LabelledValuesFunc func_;
+    std::set<std::string> labels_;
+
+    //! Invalid label sets dropped so far.
+    std::atomic<std::uint64_t> invalid_;
+    DescriptorRef invalid_descriptor_;
+
+    //! Returns true if the labels set can be exported.
+    bool valid(const std::map<std::string, std::string>& labels) const;
+  };
+
+
+  //! Labelled counter with the values returned by a callback.
+  class LabelledCounterFunc : public LabelledFuncCollector {
+   public:
+    LabelledCounterFunc(
+        std::string name, std::string help,
+        std::set<std::string> labels, LabelledValuesFunc func
+    );
+  };
+  typedef std::shared_ptr<LabelledCounterFunc> LabelledCounterFuncRef;
+
+
+  //! Labelled gauge with the values returned by a callback.
+  class LabelledGaugeFunc : public LabelledFuncCollector {
+   public:
+    LabelledGaugeFunc(
+        std::string name, std::string help,
+        std::set<std::string> labels, LabelledValuesFunc func
+    );
+  };
+  typedef std::shared_ptr<LabelledGaugeFunc> LabelledGaugeFuncRef;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_FUNC_H_
@@ -2,20 +2,42 @@
 #ifndef PROMCLIENT_GAUGE_H_
 #define PROMCLIENT_GAUGE_H_
 
-#include <atomic>
 #include <memory>
 #include <string>
 
 #include "promclient/collector.h"
+#include "promclient/timer.h"
+#include "promclient/internal/atomic_double.h"
 
 
 namespace promclient {
 
   //! Gauge represents a value that can go up and down.
   class Gauge : public Collector {
+   public:
+    //! Increments a gauge for as long as it is in scope.
+    class InProgress {
+     public:
+      explicit InProgress(Gauge* gauge);
+      InProgress(InProgress&& other);
+      ~InProgress();
+
+      InProgress(const InProgress&) = delete;
+      InProgress& operator=(const InProgress&) = delete;
+
+     protected:
+      Gauge* gauge_;
+    };
+
    public:
     Gauge(std::string name, std::string help, double initial = 0);
 
+    //! Create a gauge with an existing gauge descriptor.
+    /*!
+     * Used by labelled gauges so all children share one descriptor.
+     */
+    explicit Gauge(DescriptorRef descriptor, double initial = 0);
+
     MetricsList collect();
     DescriptorsList describe();
 
@@ -23,14 +45,25 @@ namespace promclient {
     void inc(double value = 1);
     void set(double value);
 
+    //! Sets the gauge to the current UNIX time, in seconds.
+    void setToCurrentTime();
+
+    //! Sets the gauge to the seconds spent until the timer is stopped.
+    Timer<Gauge> time();
+
+    //! Increments the gauge until the returned guard is destroyed.
+    InProgress trackInProgress();
+
    protected:
-    std::string help_;
-    std::string name_;
-    std::atomic<double> value_;
+    //! Create a gauge that stores its value in externally owned memory.
+    Gauge(std::string name, std::string help, internal::AtomicDouble* value);
+    Gauge(DescriptorRef descriptor, internal::AtomicDouble* value);
 
-    DescriptorRef descriptor_;
+    //! Points to local_ unless created with external storage.
+    internal::AtomicDouble local_;
+    internal::AtomicDouble* value_;
 
-    void update(double value);
+    DescriptorRef descriptor_;
   };
   typedef std::shared_ptr<Gauge> GaugeRef;
 
@@ -44,9 +77,6 @@ namespace promclient {
     );
 
    protected:
-    std::string help_;
-    std::string name_;
-
     virtual Ref makeChild();
   };
   typedef std::shared_ptr<LabelledGauge> LabelledGaugeRef;
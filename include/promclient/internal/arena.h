@@ -0,0 +1,94 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_ARENA_H_
+#define PROMCLIENT_INTERNAL_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Monotonic allocator for short lived objects.
+  /*!
+   * Allocations bump a pointer in the current block and are never
+   * freed individually: reset() releases everything at once.
+   * The first block is kept across resets so a reused arena does
+   * not allocate in the steady state.
+   *
+   * Arenas are not thread safe.
+   */
+  class Arena {
+   public:
+    explicit Arena(std::size_t block_size = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    //! Returns size bytes aligned to alignment.
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    //! Release all allocations.
+    void reset();
+
+   protected:
+    struct Block {
+      char* data;
+      std::size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    std::size_t block_size_;
+    char* cursor_;
+    char* end_;
+
+    //! Add a new block with at least size bytes.
+    void grow(std::size_t size);
+  };
+
+
+  //! STL allocator backed by an Arena.
+  template<typename Type>
+  class ArenaAllocator {
+   public:
+    typedef Type value_type;
+
+    explicit ArenaAllocator(Arena* arena) : arena_(arena) {
+      // Noop.
+    }
+
+    template<typename Other>
+    ArenaAllocator(const ArenaAllocator<Other>& other) : arena_(other.arena_) {
+      // Noop.
+    }
+
+    Type* allocate(std::size_t count) {
+      return static_cast<Type*>(
+          this->arena_->allocate(sizeof(Type) * count, alignof(Type))
+      );
+    }
+
+    void deallocate(Type*, std::size_t) {
+      // Memory is released when the arena is reset.
+    }
+
+    template<typename Other>
+    bool operator==(const ArenaAllocator<Other>& other) const {
+      return this->arena_ == other.arena_;
+    }
+
+    template<typename Other>
+    bool operator!=(const ArenaAllocator<Other>& other) const {
+      return this->arena_ != other.arena_;
+    }
+
+   protected:
+    template<typename Other> friend class ArenaAllocator;
+    Arena* arena_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_ARENA_H_
@@ -0,0 +1,99 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_ATOMIC_DOUBLE_H_
+#define PROMCLIENT_INTERNAL_ATOMIC_DOUBLE_H_
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Lock free double used to store metric values.
+  /*!
+   * The value is split between an integer accumulator and a double
+   * remainder so that whole increments (the common case for counters)
+   * are a single atomic fetch_add that never retries.
+   * Fractional increments update the remainder with a native fetch_add
+   * when available (C++20) or a compare-and-swap loop otherwise.
+   *
+   * Whole increments are exact up to 2^63 in total.
+   *
+   * Every operation writes a single word so values can live in memory
+   * shared between processes: a process dying mid-update never leaves
+   * the value in a state other processes have to wait on.
+   * add() updates one of the two parts (never both) so a concurrent
+   * load() sees either all or none of each increment.
+   * store() keeps the integer part and replaces the remainder with
+   * the difference to the new value, so a concurrent load() returns
+   * either the old or the new value.
+   * Increments racing with a store() are ordered before or after it.
+   *
+   * The value stored is rounded to the precision of the larger of it
+   * and the integer part accumulated by earlier whole increments.
+   */
+  class AtomicDouble {
+   public:
+    explicit AtomicDouble(double initial = 0);
+
+    //! Atomically adds value (can be negative).
+    void add(double value);
+
+    //! Returns the current value.
+    double load() const;
+
+    //! Replace the current value.
+    void store(double value);
+
+   protected:
+    //! Increments with magnitude below this limit are exact as integers.
+    static constexpr double WHOLE_LIMIT = 9007199254740992.0;  // 2^53
+
+    std::atomic<std::int64_t> whole_;
+    std::atomic<double> fraction_;
+  };
+
+
+  inline AtomicDouble::AtomicDouble(double initial)
+    : whole_(0), fraction_(initial) {
+    // Noop.
+  }
+
+  inline void AtomicDouble::add(double value) {
+    // NaNs fail the range check and go through the double path.
+    if (value > -WHOLE_LIMIT && value < WHOLE_LIMIT) {
+      std::int64_t whole = static_cast<std::int64_t>(value);
+      if (static_cast<double>(whole) == value) {
+        this->whole_.fetch_add(whole, std::memory_order_relaxed);
+        return;
+      }
+    }
+
+#if defined(__cpp_lib_atomic_float)
+    this->fraction_.fetch_add(value, std::memory_order_relaxed);
+#else
+    double stored = this->fraction_.load(std::memory_order_relaxed);
+    while (!this->fraction_.compare_exchange_weak(
+          stored, stored + value, std::memory_order_relaxed
+    )) {
+      // Noop.
+    }
+#endif
+  }
+
+  inline double AtomicDouble::load() const {
+    // The remainder is read first: a store() after this read leaves the
+    // integer part alone so the sum is the value from before the store.
+    double fraction = this->fraction_.load();
+    return fraction + static_cast<double>(this->whole_.load());
+  }
+
+  inline void AtomicDouble::store(double value) {
+    double whole = static_cast<double>(this->whole_.load());
+    this->fraction_.store(value - whole);
+  }
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_ATOMIC_DOUBLE_H_
@@ -2,6 +2,7 @@
 #ifndef PROMCLIENT_INTERNAL_BUILDER_H_
 #define PROMCLIENT_INTERNAL_BUILDER_H_
 
+#include <chrono>
 #include <memory>
 #include <set>
 #include <string>
@@ -27,6 +28,12 @@ namespace internal {
     SimpleLabelledBuilder();
     SimpleLabelledBuilder(const SimpleLabelledBuilder<Collector>&) = default;
 
+    //! Set the maximum number of label sets (0 for no limit).
+    /*!
+     * Label sets past the limit are aggregated into an overflow series.
+     */
+    SimpleLabelledBuilder<Collector> cardinality(std::size_t limit);
+
     //! Set the allowed metric labels.
     SimpleLabelledBuilder<Collector> labels(std::set<std::string> labels);
 
@@ -36,6 +43,9 @@ namespace internal {
     //! Set the metric name.
     SimpleLabelledBuilder<Collector> name(std::string name);
 
+    //! Expire label sets that are idle for longer then ttl.
+    SimpleLabelledBuilder<Collector> ttl(std::chrono::milliseconds ttl);
+
     //! Returns a new Collector.
     std::shared_ptr<Collector> build();
 
@@ -48,9 +58,11 @@ namespace internal {
 
    protected:
     bool help_set_;
+    std::size_t cardinality_;
     std::string help_;
     std::string name_;
     std::set<std::string> labels_;
+    std::chrono::milliseconds ttl_;
   };
 
 
@@ -10,7 +10,16 @@ namespace internal {
 
   template<typename Collector>
   SimpleLabelledBuilder<Collector>::SimpleLabelledBuilder() {
+    this->cardinality_ = 0;
     this->help_set_ = false;
+    this->ttl_ = std::chrono::milliseconds::zero();
+  }
+
+  template<typename Collector>
+  SimpleLabelledBuilder<Collector>
+  SimpleLabelledBuilder<Collector>::cardinality(std::size_t limit) {
+    this->cardinality_ = limit;
+    return *this;
   }
 
   template<typename Collector>
@@ -19,7 +28,7 @@ namespace internal {
     if (labels.size() == 0) {
       throw MissingCollectorLabels();
     }
-    for (std::string label : labels) {
+    for (const std::string& label : labels) {
       Metric::ValidateLabel(label);
     }
     this->labels_ = labels;
@@ -42,6 +51,13 @@ namespace internal {
     return *this;
   }
 
+  template<typename Collector>
+  SimpleLabelledBuilder<Collector>
+  SimpleLabelledBuilder<Collector>::ttl(std::chrono::milliseconds ttl) {
+    this->ttl_ = ttl;
+    return *this;
+  }
+
   template<typename Collector>
   std::shared_ptr<Collector> SimpleLabelledBuilder<Collector>::build() {
     // Check name is set.
@@ -59,9 +75,16 @@ namespace internal {
       throw MissingCollectorLabels();
     }
 
-    return std::shared_ptr<Collector>(new Collector(
+    std::shared_ptr<Collector> collector(new Collector(
           this->name_, this->help_, this->labels_
     ));
+    if (this->cardinality_ != 0) {
+      collector->cardinality(this->cardinality_);
+    }
+    if (this->ttl_ != std::chrono::milliseconds::zero()) {
+      collector->ttl(this->ttl_);
+    }
+    return collector;
   }
 
   template<typename Collector>
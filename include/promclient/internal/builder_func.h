@@ -0,0 +1,117 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_BUILDER_FUNC_H_
+#define PROMCLIENT_INTERNAL_BUILDER_FUNC_H_
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/func.h"
+
+namespace promclient {
+namespace internal {
+
+  //! Templated builder for callback metrics with labels.
+  /*!
+   * Collectors built by FuncLabelledBuilder must have
+   * a constructor with the following signature:
+   *
+   *  Collector(
+   *    std::string name, std::string help,
+   *    std::set<std::string> labels, LabelledValuesFunc func
+   *  )
+   */
+  template<typename Collector>
+  class FuncLabelledBuilder {
+   public:
+    FuncLabelledBuilder();
+    FuncLabelledBuilder(const FuncLabelledBuilder<Collector>&) = default;
+
+    //! Set the callback returning the metric values.
+    FuncLabelledBuilder<Collector> func(LabelledValuesFunc func);
+
+    //! Set the allowed metric labels.
+    FuncLabelledBuilder<Collector> labels(std::set<std::string> labels);
+
+    //! Set the metric description.
+    FuncLabelledBuilder<Collector> help(std::string help);
+
+    //! Set the metric name.
+    FuncLabelledBuilder<Collector> name(std::string name);
+
+    //! Returns a new Collector.
+    std::shared_ptr<Collector> build();
+
+    //! Register and return a new Collector.
+    std::shared_ptr<Collector> registr(CollectorRegistry* registry = nullptr);
+
+   protected:
+    LabelledValuesFunc func_;
+    bool help_set_;
+    std::string help_;
+    std::string name_;
+    std::set<std::string> labels_;
+  };
+
+
+  //! Templated builder for callback metrics without labels.
+  /*!
+   * Collectors built by FuncBuilder must have
+   * a constructor with the following signature:
+   *
+   *  Collector(std::string name, std::string help, ValueFunc func)
+   */
+  template<typename Collector, typename Labelled>
+  class FuncBuilder {
+   public:
+    FuncBuilder();
+    FuncBuilder(const FuncBuilder<Collector, Labelled>&) = default;
+
+    //! Set the callback returning the metric value.
+    FuncBuilder<Collector, Labelled> func(ValueFunc func);
+
+    //! Set the allowed metric labels.
+    /*!
+     * Labelled callback metrics need a LabelledValuesFunc callback
+     * so the callback set on this builder (if any) is not kept.
+     */
+    FuncLabelledBuilder<Labelled> labels(std::set<std::string> labels);
+
+    //! Set the metric description.
+    FuncBuilder<Collector, Labelled> help(std::string help);
+
+    //! Set the metric name.
+    FuncBuilder<Collector, Labelled> name(std::string name);
+
+    //! Returns a new Collector.
+    std::shared_ptr<Collector> build();
+
+    //! Register and return a new Collector.
+    std::shared_ptr<Collector> registr(CollectorRegistry* registry = nullptr);
+
+   protected:
+    ValueFunc func_;
+    bool help_set_;
+    std::string help_;
+    std::string name_;
+  };
+
+}  // namespace internal
+
+
+  //! Builder for callback counters and labelled callback counters.
+  typedef
+    promclient::internal::FuncBuilder<CounterFunc, LabelledCounterFunc>
+    CounterFuncBuilder;
+
+  //! Builder for callback gauges and labelled callback gauges.
+  typedef
+    promclient::internal::FuncBuilder<GaugeFunc, LabelledGaugeFunc>
+    GaugeFuncBuilder;
+
+}  // namespace promclient
+
+#include "promclient/internal/builder_func.inc.h"
+
+#endif  // PROMCLIENT_INTERNAL_BUILDER_FUNC_H_
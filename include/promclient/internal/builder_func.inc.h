@@ -0,0 +1,171 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_BUILDER_FUNC_INC_H_
+#define PROMCLIENT_INTERNAL_BUILDER_FUNC_INC_H_
+
+#include <utility>
+
+#include "promclient/collector_registry.h"
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+
+namespace promclient {
+namespace internal {
+
+  template<typename Collector>
+  FuncLabelledBuilder<Collector>::FuncLabelledBuilder() {
+    this->help_set_ = false;
+  }
+
+  template<typename Collector>
+  FuncLabelledBuilder<Collector>
+  FuncLabelledBuilder<Collector>::func(LabelledValuesFunc func) {
+    this->func_ = std::move(func);
+    return *this;
+  }
+
+  template<typename Collector>
+  FuncLabelledBuilder<Collector>
+  FuncLabelledBuilder<Collector>::labels(std::set<std::string> labels) {
+    if (labels.size() == 0) {
+      throw MissingCollectorLabels();
+    }
+    for (const std::string& label : labels) {
+      Metric::ValidateLabel(label);
+    }
+    this->labels_ = labels;
+    return *this;
+  }
+
+  template<typename Collector>
+  FuncLabelledBuilder<Collector>
+  FuncLabelledBuilder<Collector>::help(std::string help) {
+    this->help_ = help;
+    this->help_set_ = true;
+    return *this;
+  }
+
+  template<typename Collector>
+  FuncLabelledBuilder<Collector>
+  FuncLabelledBuilder<Collector>::name(std::string name) {
+    Metric::ValidateName(name);
+    this->name_ = name;
+    return *this;
+  }
+
+  template<typename Collector>
+  std::shared_ptr<Collector> FuncLabelledBuilder<Collector>::build() {
+    // Check name is set.
+    if (this->name_ == "") {
+      throw NamelessCollector();
+    }
+
+    // Check help is set, empty help is ok.
+    if (!this->help_set_) {
+      throw HelplessCollector();
+    }
+
+    // Check labels are set (no use for a labelled collector without labels).
+    if (this->labels_.size() == 0) {
+      throw MissingCollectorLabels();
+    }
+
+    // Check the callback is set.
+    if (!this->func_) {
+      throw MissingCollectorFunc();
+    }
+
+    return std::shared_ptr<Collector>(new Collector(
+          this->name_, this->help_, this->labels_, this->func_
+    ));
+  }
+
+  template<typename Collector>
+  std::shared_ptr<Collector>
+  FuncLabelledBuilder<Collector>::registr(CollectorRegistry* registry) {
+    if (!registry) {
+      registry = CollectorRegistry::Default();
+    }
+    std::shared_ptr<Collector> collector = this->build();
+    registry->registr(collector);
+    return collector;
+  }
+
+
+  template<typename Collector, typename Labelled>
+  FuncBuilder<Collector, Labelled>::FuncBuilder() {
+    this->help_set_ = false;
+  }
+
+  template<typename Collector, typename Labelled>
+  FuncBuilder<Collector, Labelled>
+  FuncBuilder<Collector, Labelled>::func(ValueFunc func) {
+    this->func_ = std::move(func);
+    return *this;
+  }
+
+  template<typename Collector, typename Labelled>
+  FuncLabelledBuilder<Labelled>
+  FuncBuilder<Collector, Labelled>::labels(std::set<std::string> labels) {
+    FuncLabelledBuilder<Labelled> builder;
+    if (this->name_ != "") {
+      builder.name(this->name_);
+    }
+    if (this->help_set_) {
+      builder.help(this->help_);
+    }
+    return builder.labels(labels);
+  }
+
+  template<typename Collector, typename Labelled>
+  FuncBuilder<Collector, Labelled>
+  FuncBuilder<Collector, Labelled>::help(std::string help) {
+    this->help_ = help;
+    this->help_set_ = true;
+    return *this;
+  }
+
+  template<typename Collector, typename Labelled>
+  FuncBuilder<Collector, Labelled>
+  FuncBuilder<Collector, Labelled>::name(std::string name) {
+    Metric::ValidateName(name);
+    this->name_ = name;
+    return *this;
+  }
+
+  template<typename Collector, typename Labelled>
+  std::shared_ptr<Collector> FuncBuilder<Collector, Labelled>::build() {
+    // Check name is set.
+    if (this->name_ == "") {
+      throw NamelessCollector();
+    }
+
+    // Check help is set, empty help is ok.
+    if (!this->help_set_) {
+      throw HelplessCollector();
+    }
+
+    // Check the callback is set.
+    if (!this->func_) {
+      throw MissingCollectorFunc();
+    }
+
+    return std::shared_ptr<Collector>(
+        new Collector(this->name_, this->help_, this->func_)
+    );
+  }
+
+  template<typename Collector, typename Labelled>
+  std::shared_ptr<Collector>
+  FuncBuilder<Collector, Labelled>::registr(CollectorRegistry* registry) {
+    if (!registry) {
+      registry = CollectorRegistry::Default();
+    }
+    std::shared_ptr<Collector> collector = this->build();
+    registry->registr(collector);
+    return collector;
+  }
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_BUILDER_FUNC_INC_H_
@@ -0,0 +1,23 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_BUILDER_NATIVE_HISTOGRAM_H_
+#define PROMCLIENT_INTERNAL_BUILDER_NATIVE_HISTOGRAM_H_
+
+#include "promclient/native_histogram.h"
+#include "promclient/internal/builder.h"
+
+namespace promclient {
+
+  //! Builder for native histograms with the default resolution.
+  /*!
+   * Use the constructors to set the schema, bucket limit
+   * and zero threshold.
+   */
+  typedef
+    promclient::internal::SimpleBuilder<
+      NativeHistogram, LabelledNativeHistogram
+    >
+    NativeHistogramBuilder;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_BUILDER_NATIVE_HISTOGRAM_H_
@@ -0,0 +1,61 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_CLOCK_H_
+#define PROMCLIENT_INTERNAL_CLOCK_H_
+
+#include <cstdint>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Process wide, configurable, source of time for timers.
+  /*!
+   * Timers take two timestamps per scope so the cost of reading the
+   * clock matters for code timing short operations.
+   * Available sources are:
+   *
+   *   * STEADY: std::chrono::steady_clock (the default).
+   *   * COARSE: CLOCK_MONOTONIC_COARSE, the cheapest to read but only
+   *     as precise as the kernel tick (1ms to 10ms).
+   *   * TSC: the CPU time stamp counter, cheaper to read than STEADY
+   *     and as precise; only used if the counter is invariant
+   *     (constant rate and synchronised across cores).
+   *
+   * The source should be configured once, at start up, before any
+   * timer is started: timestamps taken from different sources can't
+   * be compared.
+   *
+   * Users access this class as promclient::Clock (see timer.h).
+   */
+  class Clock {
+   public:
+    enum Source {
+      STEADY = 0,
+      COARSE = 1,
+      TSC = 2
+    };
+
+    //! Selects the source used by Now() and returns the source in use.
+    /*!
+     * Sources not supported by the system fall back to STEADY.
+     * Selecting TSC measures the counter rate (blocking for ~10ms).
+     */
+    static Source Configure(Source source);
+
+    //! Returns the source in use.
+    static Source Current();
+
+    //! Returns seconds elapsed between two timestamps from Now().
+    static double Elapsed(std::uint64_t start, std::uint64_t end);
+
+    //! Returns an opaque timestamp from the configured source.
+    static std::uint64_t Now();
+
+    //! Returns seconds since the UNIX epoch.
+    static double WallTime();
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_CLOCK_H_
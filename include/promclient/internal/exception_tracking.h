@@ -0,0 +1,69 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_EXCEPTION_TRACKING_H_
+#define PROMCLIENT_INTERNAL_EXCEPTION_TRACKING_H_
+
+#include <string>
+#include <typeinfo>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Calls a function and a handler if it throws an Exception.
+  /*!
+   * The exception is always rethrown.
+   * The void specialisation handles exceptions of any type.
+   */
+  template<typename Exception>
+  struct CatchExceptions {
+    template<typename Function, typename Handler>
+    static auto Call(Function&& function, Handler handler)
+        -> decltype(function()) {
+      try {
+        return function();
+      } catch (const Exception&) {
+        handler();
+        throw;
+      }
+    }
+  };
+
+  template<>
+  struct CatchExceptions<void> {
+    template<typename Function, typename Handler>
+    static auto Call(Function&& function, Handler handler)
+        -> decltype(function()) {
+      try {
+        return function();
+      } catch (...) {
+        handler();
+        throw;
+      }
+    }
+  };
+
+
+  //! Returns the type of the exception being handled (or nullptr).
+  /*!
+   * Only supported with the Itanium C++ ABI (GCC and clang),
+   * returns nullptr on other platforms.
+   */
+  const std::type_info* CurrentExceptionType();
+
+  //! Returns the human readable name of a type.
+  std::string TypeName(const std::type_info& type);
+
+  //! Returns the number of exceptions thrown but not yet caught.
+  /*!
+   * Same as C++17 std::uncaught_exceptions but also available in C++11
+   * with the Itanium C++ ABI.
+   * Other C++11 platforms fall back to std::uncaught_exception, which
+   * does not tell apart destructors called during unwinding from
+   * destructors of objects created during unwinding.
+   */
+  int UncaughtExceptions();
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_EXCEPTION_TRACKING_H_
@@ -0,0 +1,69 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_EXEMPLAR_SLOT_H_
+#define PROMCLIENT_INTERNAL_EXEMPLAR_SLOT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "promclient/metric.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! Fixed size, lock free, storage for the latest exemplar of a series.
+  /*!
+   * Exemplar labels are copied into a fixed array of atomic words
+   * protected by a sequence lock: store() never allocates or blocks
+   * and load() retries if it races with a store().
+   *
+   * Concurrent stores do not wait for each other: a store that finds
+   * another store in progress is dropped (the other exemplar wins).
+   */
+  class ExemplarSlot {
+   public:
+    //! Maximum combined length of exemplar label names and values.
+    static const std::size_t MAX_LABELS_LENGTH = 128;
+
+    //! Returns the slot in `slot`, installing a new one if it is empty.
+    /*!
+     * The loser of a race to install a slot frees its own slot.
+     * Installed slots are owned by the caller.
+     */
+    static ExemplarSlot* Install(std::atomic<ExemplarSlot*>* slot);
+
+   public:
+    ExemplarSlot();
+
+    //! Records an exemplar, returns false if dropped.
+    /*!
+     * Throws InvalidExemplar if the labels are longer than
+     * MAX_LABELS_LENGTH characters (or have too many names).
+     */
+    bool store(
+        const std::map<std::string, std::string>& labels,
+        double value, double timestamp
+    );
+
+    //! Returns the latest exemplar or nullptr if none was stored.
+    ExemplarRef load() const;
+
+   protected:
+    //! Encoded labels: a length byte before each name and value.
+    static const std::size_t DATA_SIZE = 192;
+    static const std::size_t WORDS = DATA_SIZE / 8;
+
+    std::atomic<std::uint64_t> sequence_;
+    std::atomic<std::uint64_t> size_;
+    std::atomic<std::uint64_t> timestamp_;
+    std::atomic<std::uint64_t> value_;
+    std::atomic<std::uint64_t> words_[WORDS];
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_EXEMPLAR_SLOT_H_
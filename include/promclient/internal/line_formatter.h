@@ -0,0 +1,118 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_LINE_FORMATTER_H_
+#define PROMCLIENT_INTERNAL_LINE_FORMATTER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! Helper class for generating push line protocols.
+  /*!
+   * Each sample is formatted as one line, named like in the text
+   * format (i.e, `<name>_bucket` for histogram buckets):
+   *
+   *   * STATSD: `name:value|type|#label:value,...` (DogStatsD tags).
+   *     Counters are sent as increments since the committed value of
+   *     the series (see commit), all other samples as gauges (negative
+   *     gauges take two lines: StatsD reads signed values as changes).
+   *   * GRAPHITE: `name;label=value;... value seconds` (Graphite tags).
+   *   * INFLUX: `name,label=value,... value=value nanoseconds`.
+   *
+   * Characters the protocols reserve are replaced or escaped and
+   * samples with non-finite values are skipped (no line is returned).
+   */
+  class LineFormatter {
+   public:
+    enum Protocol {
+      STATSD = 0,
+      GRAPHITE = 1,
+      INFLUX = 2
+    };
+
+   public:
+    explicit LineFormatter(Protocol protocol);
+
+    //! Returns the line (newline terminated) for a sample or "".
+    /*!
+     * The timestamp is in milliseconds since the UNIX epoch.
+     */
+    std::string line(
+        const DescriptorRef& descriptor, const Sample& sample,
+        std::int64_t timestamp
+    );
+
+    //! Uses the counter values formatted since the last commit as base.
+    /*!
+     * Call once the lines were delivered so the increments of failed
+     * sends are included in the next lines.
+     * Series that were not formatted since the last commit are dropped.
+     */
+    void commit();
+
+    //! Forgets the counter values formatted since the last commit.
+    void discard();
+
+    //! Returns the protocol in use.
+    Protocol protocol() const;
+
+   protected:
+    Protocol protocol_;
+
+    //! Committed value of StatsD counters, by series.
+    std::unordered_map<std::string, double> counters_;
+
+    //! Value of StatsD counters formatted since the last commit.
+    std::unordered_map<std::string, double> pending_;
+
+    std::string graphite(
+        const std::string& name, const Sample& sample, std::int64_t timestamp
+    );
+    std::string influx(
+        const std::string& name, const Sample& sample, std::int64_t timestamp
+    );
+    std::string statsd(
+        const std::string& name, const std::string& type,
+        const Sample& sample
+    );
+  };
+
+
+  //! Abstract class to share LineFormatter code.
+  class LineFormatBridge {
+   public:
+    LineFormatBridge(
+        CollectorRegistry* registry, LineFormatter::Protocol protocol
+    );
+
+    //! Collect metrics form the register and calls write for each line.
+    /*!
+     * StatsD counter increments are relative to the last commit.
+     */
+    void collect();
+
+    //! Commits the counter values of the last collect.
+    /*!
+     * Call after the lines of the last collect were delivered.
+     */
+    void commit();
+
+   protected:
+    LineFormatter formatter;
+    CollectorRegistry* registry_;
+    CollectorRegistry::CollectStrategy strategy_;
+
+    //! Writes a formatted line.
+    virtual void write(const std::string& line) = 0;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_LINE_FORMATTER_H_
@@ -0,0 +1,99 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_PHASER_H_
+#define PROMCLIENT_INTERNAL_PHASER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Writer-reader phaser to switch writers between two buffers.
+  /*!
+   * Writers wrap updates in enter()/exit() and write to the buffer of
+   * the phase returned by Phase(token).
+   * A reader calls flip() to move writers to the other phase: when
+   * flip() returns all writers of the previous phase have exited so
+   * its buffer can be read and reset without races.
+   *
+   * Writers never block or retry (two atomic increments per update);
+   * flip() waits for in-flight writers and must not be called by
+   * more than one reader at a time.
+   */
+  class Phaser {
+   public:
+    Phaser();
+
+    //! Enter a writer critical section, returns the token for exit().
+    std::int64_t enter();
+
+    //! Exit the critical section started by enter().
+    void exit(std::int64_t token);
+
+    //! Returns the phase (0 or 1) a writer token belongs to.
+    static int Phase(std::int64_t token);
+
+    //! Flips to the other phase and returns the phase that ended.
+    int flip();
+
+   protected:
+    //! Writer entries, negative while in the odd phase.
+    std::atomic<std::int64_t> start_;
+
+    //! Writer exits for each phase.
+    std::atomic<std::int64_t> even_end_;
+    std::atomic<std::int64_t> odd_end_;
+  };
+
+
+  inline Phaser::Phaser()
+    : start_(0), even_end_(0),
+      odd_end_(std::numeric_limits<std::int64_t>::min()) {
+    // Noop.
+  }
+
+  inline std::int64_t Phaser::enter() {
+    return this->start_.fetch_add(1);
+  }
+
+  inline void Phaser::exit(std::int64_t token) {
+    if (token < 0) {
+      this->odd_end_.fetch_add(1);
+    } else {
+      this->even_end_.fetch_add(1);
+    }
+  }
+
+  inline int Phaser::Phase(std::int64_t token) {
+    return token < 0 ? 1 : 0;
+  }
+
+  inline int Phaser::flip() {
+    bool next_even = this->start_.load() < 0;
+    std::int64_t initial = next_even ?
+      0 : std::numeric_limits<std::int64_t>::min();
+
+    // Reset the end counter of the next phase before writers enter it.
+    if (next_even) {
+      this->even_end_.store(initial);
+    } else {
+      this->odd_end_.store(initial);
+    }
+
+    // Move writers over and wait for the ones still in the old phase.
+    std::int64_t start_at_flip = this->start_.exchange(initial);
+    std::atomic<std::int64_t>& ended = next_even ?
+      this->odd_end_ : this->even_end_;
+    while (ended.load() != start_at_flip) {
+      std::this_thread::yield();
+    }
+    return next_even ? 1 : 0;
+  }
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_PHASER_H_
@@ -0,0 +1,74 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_PROTOBUF_FORMATTER_H_
+#define PROMCLIENT_INTERNAL_PROTOBUF_FORMATTER_H_
+
+#include <set>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_writer.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! Helper class for generating the Prometheus protobuf format.
+  /*!
+   * Metrics are encoded as length delimited `io.prometheus.client`
+   * MetricFamily messages, the only format that can expose native
+   * histogram buckets.
+   *
+   * See https://github.com/prometheus/client_model/blob/master/io/prometheus/client/metrics.proto
+   */
+  class ProtobufFormatter {
+   public:
+    //! HTTP Content-Type of the format.
+    static const char* const CONTENT_TYPE;
+
+    //! Returns true if an HTTP Accept header prefers protobuf.
+    /*!
+     * Protobuf must be accepted with a quality not lower then any
+     * of the text formats.
+     */
+    static bool Accepts(const std::string& accept);
+
+   public:
+    //! Returns the delimited MetricFamily message for a metric.
+    std::string family(const Metric& metric);
+
+   protected:
+    //! Buffers reused across calls to family().
+    ProtobufWriter family_;
+    ProtobufWriter metric_;
+  };
+
+
+  //! Abstract class to share ProtobufFormatter code.
+  class ProtobufFormatBridge {
+   public:
+    explicit ProtobufFormatBridge(CollectorRegistry* registry);
+
+    //! Collect metrics form the register and calls write for each metric.
+    void collect();
+
+    //! Only collect metrics with the given names (all if empty).
+    void filter(std::set<std::string> names);
+
+   protected:
+    ProtobufFormatter formatter;
+    std::set<std::string> names_;
+    CollectorRegistry* registry_;
+    CollectorRegistry::CollectStrategy strategy_;
+
+    //! Called before each metric family is written.
+    virtual void starting(const DescriptorRef& descriptor);
+
+    //! Writes an encoded metric family.
+    virtual void write(const std::string& family) = 0;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_PROTOBUF_FORMATTER_H_
@@ -0,0 +1,68 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_PROTOBUF_WRITER_H_
+#define PROMCLIENT_INTERNAL_PROTOBUF_WRITER_H_
+
+#include <cstdint>
+#include <string>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Minimal encoder for protocol buffer messages.
+  /*!
+   * Fields are appended to a buffer in the protobuf wire format so
+   * messages can be written without depending on libprotobuf.
+   * Embedded messages are encoded with their own writer and added
+   * with message().
+   *
+   * See https://protobuf.dev/programming-guides/encoding/
+   */
+  class ProtobufWriter {
+   public:
+    enum WireType {
+      VARINT = 0,
+      FIXED64 = 1,
+      LENGTH = 2,
+      FIXED32 = 5
+    };
+
+    //! Zig-zag encoding of signed integers (for sint32 and sint64).
+    static std::uint64_t ZigZag(std::int64_t value);
+
+   public:
+    //! Returns the encoded bytes.
+    const std::string& buffer() const;
+
+    //! Removes all encoded fields.
+    void clear();
+
+    //! Writes a double field.
+    void doubleField(int field, double value);
+
+    //! Writes an int32, int64, uint32, uint64 or enum field.
+    void intField(int field, std::uint64_t value);
+
+    //! Writes an embedded message field.
+    void message(int field, const ProtobufWriter& message);
+
+    //! Writes an sint32 or sint64 field.
+    void sintField(int field, std::int64_t value);
+
+    //! Writes a string or bytes field.
+    void stringField(int field, const std::string& value);
+
+    //! Writes a field key.
+    void tag(int field, WireType type);
+
+    //! Writes a variable length integer.
+    void varint(std::uint64_t value);
+
+   protected:
+    std::string buffer_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_PROTOBUF_WRITER_H_
@@ -0,0 +1,133 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_REGISTRY_METRICS_H_
+#define PROMCLIENT_INTERNAL_REGISTRY_METRICS_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "promclient/collector.h"
+#include "promclient/collector_registry.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! Collector of metrics about a registry and its scrapes.
+  /*!
+   * Enabled with CollectorRegistry::instrument(), exposes:
+   *
+   *   * `promclient_collector_duration_seconds{collector}`: duration of
+   *     the latest collect() of each registered collector, named after
+   *     the first metric it describes (collectors with the same name
+   *     are summed). Only full collections update these.
+   *   * `promclient_scrape_duration_seconds{phase}`: duration of the
+   *     collect, format and write phases of the latest scrape.
+   *     The write phase times the bridge's write() calls: exporters
+   *     that buffer the body (HTTP, Unix socket, textfile and line
+   *     protocol exporters) only measure appends to the buffer and
+   *     send it to clients after the scrape is recorded.
+   *   * `promclient_scrape_series` and `promclient_scrape_bytes`: size
+   *     of the latest collection and of the latest scrape.
+   *   * `promclient_scrapes_total{format}`: scrapes by exposition format.
+   *   * `promclient_labelled_children{metric}` and
+   *     `promclient_labelled_lookups_total{metric,result}`: children and
+   *     cache hits/misses of each labelled collector.
+   *
+   * Durations are measured with the configured Clock and recorded
+   * once per scrape so the cost is a few clock reads per collector.
+   */
+  class RegistryMetrics : public Collector {
+   public:
+    //! Returns true for metrics that change with every scrape.
+    /*!
+     * These are the collector and scrape metrics above: exporters
+     * leave them out of content hashes (i.e, HTTP ETags).
+     */
+    static bool PerScrape(const std::string& name);
+
+   public:
+    explicit RegistryMetrics(CollectorRegistry* registry);
+
+    MetricsList collect();
+    DescriptorsList describe();
+
+    //! Records a collection by the registry.
+    /*!
+     * The durations are the seconds spent in the collect() call of the
+     * collector that returned the metrics with the same index.
+     * Collector durations are replaced when `full` is set, so
+     * unregistered collectors stop being exported.
+     */
+    void collected(
+        const std::vector<CollectorRef>& collectors,
+        const std::vector<MetricsList>& metrics,
+        const std::vector<double>& durations, bool full
+    );
+
+    //! Records a scrape formatted by an exporter.
+    void scraped(
+        const std::string& format, double collect, double formatting,
+        double write, std::uint64_t bytes
+    );
+
+   protected:
+    CollectorRegistry* registry_;
+
+    DescriptorRef collector_duration_;
+    DescriptorRef labelled_children_;
+    DescriptorRef labelled_lookups_;
+    DescriptorRef scrape_bytes_;
+    DescriptorRef scrape_duration_;
+    DescriptorRef scrape_series_;
+    DescriptorRef scrapes_;
+
+    //! Latest values, updated once per collection or scrape.
+    std::mutex lock_;
+    std::uint64_t bytes_;
+    std::map<std::string, double> collector_durations_;
+    std::map<std::string, double> phases_;
+    std::map<std::string, std::uint64_t> scrapes_by_format_;
+    std::uint64_t series_;
+  };
+
+
+  //! Times the phases of a scrape and records it to RegistryMetrics.
+  /*!
+   * All methods do nothing (and don't read the clock) if the
+   * registry is not instrumented.
+   * Time not spent collecting or writing is spent formatting.
+   */
+  class ScrapeTimer {
+   public:
+    ScrapeTimer(CollectorRegistry* registry, const char* format);
+
+    //! Marks the end of the collect phase.
+    void collected();
+
+    //! Records the scrape.
+    void done();
+
+    //! Marks the start of a write.
+    void writing();
+
+    //! Marks the end of a write of `bytes` bytes.
+    void written(std::size_t bytes);
+
+   protected:
+    RegistryMetrics* metrics_;
+    const char* format_;
+
+    std::uint64_t bytes_;
+    double collect_;
+    std::uint64_t start_;
+    double write_;
+    std::uint64_t write_start_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_REGISTRY_METRICS_H_
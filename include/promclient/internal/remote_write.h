@@ -0,0 +1,51 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_REMOTE_WRITE_H_
+#define PROMCLIENT_INTERNAL_REMOTE_WRITE_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_writer.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! A sample of a series, as sent by Prometheus remote write.
+  struct RemoteSeries {
+    //! Labels sorted by name, including `__name__`.
+    std::vector<std::pair<std::string, std::string>> labels;
+
+    double value;
+
+    //! Milliseconds since the UNIX epoch.
+    std::int64_t timestamp;
+  };
+  typedef std::vector<RemoteSeries> RemoteSeriesList;
+
+  //! Converts collected metrics to remote write series.
+  /*!
+   * Samples are named like in the text format (i.e, `<name>_bucket`
+   * for histogram buckets) and all have the given timestamp.
+   */
+  RemoteSeriesList RemoteSeriesOf(
+      const MetricsList& metrics, std::int64_t timestamp
+  );
+
+  //! Encodes a `prometheus.WriteRequest` message.
+  /*!
+   * The request is replaced, so callers can reuse its capacity.
+   *
+   * See https://github.com/prometheus/prometheus/blob/main/prompb/remote.proto
+   */
+  void EncodeWriteRequest(
+      const RemoteSeriesList& series, ProtobufWriter* request
+  );
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_REMOTE_WRITE_H_
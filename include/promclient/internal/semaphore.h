@@ -0,0 +1,43 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_SEMAPHORE_H_
+#define PROMCLIENT_INTERNAL_SEMAPHORE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Counting semaphore with a bounded wait.
+  /*!
+   * Limits the number of threads in a section (i.e, concurrent
+   * scrapes of an HTTP endpoint).
+   * A semaphore with zero permits never blocks.
+   */
+  class Semaphore {
+   public:
+    explicit Semaphore(std::size_t permits);
+
+    //! Takes a permit, waiting at most `timeout` for one to be released.
+    /*!
+     * Returns false if no permit was available in time.
+     */
+    bool acquire(std::chrono::milliseconds timeout);
+
+    //! Returns a permit taken with acquire().
+    void release();
+
+   protected:
+    std::size_t available_;
+    std::size_t permits_;
+    std::mutex lock_;
+    std::condition_variable released_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_SEMAPHORE_H_
@@ -0,0 +1,30 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_SNAPPY_H_
+#define PROMCLIENT_INTERNAL_SNAPPY_H_
+
+#include <string>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Compresses a buffer in the snappy block format.
+  /*!
+   * This is the (unframed) format expected by Prometheus remote write.
+   * The output is replaced, so callers can reuse its capacity across
+   * calls.
+   *
+   * See https://github.com/google/snappy/blob/main/format_description.txt
+   */
+  void SnappyCompress(const std::string& input, std::string* output);
+
+  //! Decompresses a snappy block.
+  /*!
+   * Throws std::runtime_error if the input is not a valid block.
+   */
+  std::string SnappyUncompress(const std::string& input);
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_SNAPPY_H_
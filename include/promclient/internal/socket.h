@@ -0,0 +1,29 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_SOCKET_H_
+#define PROMCLIENT_INTERNAL_SOCKET_H_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Connects a socket to a host, returns the descriptor or -1.
+  /*!
+   * The type is SOCK_STREAM or SOCK_DGRAM and the timeout applies to
+   * connect and to every send and receive on the socket.
+   */
+  int Connect(
+      const std::string& host, const std::string& port, int type,
+      std::chrono::milliseconds timeout
+  );
+
+  //! Sends all of a buffer to a connected socket, without SIGPIPE.
+  bool SendAll(int fd, const char* data, std::size_t size);
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_SOCKET_H_
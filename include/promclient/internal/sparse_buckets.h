@@ -0,0 +1,73 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_SPARSE_BUCKETS_H_
+#define PROMCLIENT_INTERNAL_SPARSE_BUCKETS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+
+
+namespace promclient {
+namespace internal {
+
+  //! Lock free, fixed capacity, map from bucket keys to counts.
+  /*!
+   * Buckets are stored in a single open addressing table (linear
+   * probing) of key and count pairs so populated buckets share cache
+   * lines and lookups do not chase pointers.
+   * Keys are claimed with a compare-and-swap and never move or get
+   * removed, so add() never blocks and never retries on a count.
+   *
+   * Reading and clearing the table is not safe while add() is running
+   * on other threads: callers must stop writers first (i.e, with a
+   * Phaser).
+   */
+  class SparseBuckets {
+   public:
+    //! The table can hold at least `capacity` buckets.
+    explicit SparseBuckets(std::size_t capacity);
+
+    //! Adds count to the bucket for key.
+    /*!
+     * A new bucket is only created if fewer then `limit` buckets are
+     * populated; returns false if the bucket does not exist and can't
+     * be created (because of the limit or because the table is full).
+     */
+    bool add(
+        std::int64_t key, std::uint64_t count = 1,
+        std::size_t limit = std::numeric_limits<std::size_t>::max()
+    );
+
+    //! Returns the number of slots in the table.
+    std::size_t capacity() const;
+
+    //! Resets the table to empty (not thread safe).
+    void clear();
+
+    //! Adds all populated buckets to counts (not thread safe).
+    void copy(std::map<std::int64_t, std::uint64_t>* counts) const;
+
+    //! Returns the number of populated buckets.
+    std::size_t size() const;
+
+   protected:
+    //! Marks an unused slot, never a valid key.
+    static const std::int64_t EMPTY;
+
+    struct Entry {
+      std::atomic<std::int64_t> key;
+      std::atomic<std::uint64_t> count;
+    };
+
+    std::size_t mask_;
+    std::atomic<std::size_t> size_;
+    std::unique_ptr<Entry[]> entries_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_SPARSE_BUCKETS_H_
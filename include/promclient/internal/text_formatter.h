@@ -2,6 +2,8 @@
 #ifndef PROMCLIENT_INTERNAL_TEXT_FORMATTER_H_
 #define PROMCLIENT_INTERNAL_TEXT_FORMATTER_H_
 
+#include <sstream>
+#include <set>
 #include <string>
 
 #include "promclient/collector_registry.h"
@@ -14,34 +16,105 @@ namespace internal {
   //! Helper class for generating Prometheous text format.
   /*!
    * See https://prometheus.io/docs/instrumenting/exposition_formats/#text-format-details
+   *
+   * The OpenMetrics text format is also supported, see
+   * https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md
    */
   class TextFormatter {
    public:
+    enum Format {
+      PROMETHEUS = 0,
+      OPENMETRICS = 1
+    };
+
+    //! Returns the preferred format in an HTTP Accept header.
+    /*!
+     * Prometheus text is returned unless OpenMetrics is accepted
+     * with a quality not lower then Prometheus text.
+     */
+    static Format Negotiate(const std::string& accept);
+
+   public:
+    explicit TextFormatter(Format format = Format::PROMETHEUS);
+
+    //! Returns the HTTP Content-Type of the format.
+    const char* contentType() const;
+
+    //! Returns the format in use.
+    Format format() const;
+
     //! Format HELP and TYPE lines for a descriptor.
-    std::string describe(DescriptorRef descriptor);
+    std::string describe(const DescriptorRef& descriptor);
+
+    //! Returns the line to terminate the exposition with, if any.
+    std::string end();
 
     //! Format a metric sample.
-    std::string sample(std::string name, Sample sample);
+    std::string sample(const std::string& name, const Sample& sample);
+
+    //! Returns the name samples of a metric are exposed as.
+    /*!
+     * OpenMetrics requires counter samples to end in `_total`.
+     */
+    std::string sampleName(const DescriptorRef& descriptor);
+
+   protected:
+    Format format_;
+
+    //! Writes a sample or exemplar value.
+    void value(std::ostream& line, double value);
   };
 
 
   //! Abstract class to share TextFormatter code.
   class TextFormatBridge {
    public:
-    explicit TextFormatBridge(CollectorRegistry* registry);
+    explicit TextFormatBridge(
+        CollectorRegistry* registry,
+        TextFormatter::Format format = TextFormatter::Format::PROMETHEUS
+    );
 
     //! Collect metrics form the register and calls write for each metric.
     void collect();
 
+    //! Only collect metrics with the given names (all if empty).
+    void filter(std::set<std::string> names);
+
    protected:
     TextFormatter formatter;
+    std::set<std::string> names_;
     CollectorRegistry* registry_;
     CollectorRegistry::CollectStrategy strategy_;
 
+    //! Called before the lines of each metric are written.
+    virtual void starting(const DescriptorRef& descriptor);
+
     //! Writes a formatted line.
     virtual void write(std::string line) = 0;
   };
 
+
+  //! Bridge that appends the formatted metrics to a string.
+  /*!
+   * Callers can reuse the same string (after clearing it) across
+   * collections to avoid growing a new buffer each time.
+   */
+  class BufferTextBridge : public TextFormatBridge {
+   public:
+    BufferTextBridge(
+        CollectorRegistry* registry, std::string* buffer,
+        TextFormatter::Format format = TextFormatter::Format::PROMETHEUS
+    );
+
+    //! Returns the HTTP Content-Type of the format.
+    const char* contentType() const;
+
+   protected:
+    std::string* buffer_;
+
+    void write(std::string line);
+  };
+
 }  // namespace internal
 }  // namespace promclient
 
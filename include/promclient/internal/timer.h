@@ -0,0 +1,51 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_TIMER_H_
+#define PROMCLIENT_INTERNAL_TIMER_H_
+
+#include <cstdint>
+
+#include "promclient/internal/clock.h"
+
+
+namespace promclient {
+namespace internal {
+
+  //! Records the seconds spent in a scope to a metric.
+  /*!
+   * The time is taken from the configured Clock when the timer is
+   * created and when it is stopped or destroyed (whichever comes first).
+   * The metric must outlive the timer.
+   */
+  template<typename Target>
+  class Timer {
+   public:
+    //! Member function the elapsed seconds are recorded with.
+    typedef void (Target::*Record)(double);
+
+   public:
+    Timer(Target* target, Record record);
+    Timer(Timer<Target>&& other);
+    ~Timer();
+
+    Timer(const Timer<Target>&) = delete;
+    Timer<Target>& operator=(const Timer<Target>&) = delete;
+
+    //! Records and returns the seconds elapsed so far.
+    /*!
+     * Only the first call records the elapsed time, later calls
+     * (and the destructor) do nothing and return 0.
+     */
+    double stop();
+
+   protected:
+    Record record_;
+    std::uint64_t start_;
+    Target* target_;
+  };
+
+}  // namespace internal
+}  // namespace promclient
+
+#include "promclient/internal/timer.inc.h"
+
+#endif  // PROMCLIENT_INTERNAL_TIMER_H_
@@ -0,0 +1,44 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_INTERNAL_TIMER_INC_H_
+#define PROMCLIENT_INTERNAL_TIMER_INC_H_
+
+#include "promclient/internal/clock.h"
+
+namespace promclient {
+namespace internal {
+
+  template<typename Target>
+  Timer<Target>::Timer(Target* target, Timer<Target>::Record record) {
+    this->record_ = record;
+    this->target_ = target;
+    this->start_ = Clock::Now();
+  }
+
+  template<typename Target>
+  Timer<Target>::Timer(Timer<Target>&& other) {
+    this->record_ = other.record_;
+    this->start_ = other.start_;
+    this->target_ = other.target_;
+    other.target_ = nullptr;
+  }
+
+  template<typename Target>
+  Timer<Target>::~Timer() {
+    this->stop();
+  }
+
+  template<typename Target>
+  double Timer<Target>::stop() {
+    if (this->target_ == nullptr) {
+      return 0;
+    }
+    double elapsed = Clock::Elapsed(this->start_, Clock::Now());
+    (this->target_->*this->record_)(elapsed);
+    this->target_ = nullptr;
+    return elapsed;
+  }
+
+}  // namespace internal
+}  // namespace promclient
+
+#endif  // PROMCLIENT_INTERNAL_TIMER_INC_H_
@@ -2,21 +2,87 @@
 #ifndef PROMCLIENT_INTERNAL_UTILS_H_
 #define PROMCLIENT_INTERNAL_UTILS_H_
 
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 
 namespace promclient {
 namespace internal {
 
+  //! Media range of an HTTP Accept header.
+  struct MediaRange {
+    std::string type;
+    std::map<std::string, std::string> params;
+    double quality;
+  };
+
+  //! How to answer a request for a rendered body.
+  struct ResponsePlan {
+    //! HTTP status: 200, or 304 if the client has the current body.
+    int code;
+
+    //! Content-Length: the size of the full body, even for 304s.
+    std::size_t length;
+
+    //! Whether to send the body (not for 304s and HEAD requests).
+    bool send_body;
+  };
+
   //! Combine the given vector of hashes into an hash.
   std::size_t CombineHashes(const std::vector<std::size_t>& hashes);
 
+  //! Returns a strong HTTP entity tag for a response body.
+  std::string ETag(const std::string& body);
+
+  //! Returns an entity tag for a body without the given byte ranges.
+  /*!
+   * Ranges are `[start, end)` pairs, sorted and not overlapping.
+   * Bodies that only differ in the skipped ranges get the same tag.
+   */
+  std::string ETag(
+      const std::string& body,
+      const std::vector<std::pair<std::size_t, std::size_t>>& skip
+  );
+
+  //! Fast, well distributed, 64-bits hash of a buffer (wyhash based).
+  std::uint64_t HashBytes(
+      const char* data, std::size_t size, std::uint64_t seed = 0
+  );
+
   //! Generate an hash for the given labels map.
+  /*!
+   * Names and values are hashed in order in a single pass,
+   * without copies or allocations.
+   */
   std::size_t HashLabels(const std::map<std::string, std::string>& labels);
 
+  //! Checks if an HTTP If-None-Match header matches an entity tag.
+  /*!
+   * Tags are compared weakly (`W/"x"` matches `"x"`), as required
+   * for If-None-Match, and `*` matches any tag.
+   */
+  bool MatchETag(const std::string& if_none_match, const std::string& etag);
+
+  //! Parse the media ranges of an HTTP Accept header.
+  /*!
+   * Types and parameter names are lowercase, whitespace is dropped
+   * and the quality (`q` parameter, 1 if missing) is not in params.
+   */
+  std::vector<MediaRange> ParseAccept(const std::string& accept);
+
+  //! Decides how to answer a GET or HEAD request for a body.
+  /*!
+   * if_none_match is the If-None-Match header, nullptr if missing.
+   */
+  ResponsePlan PlanResponse(
+      std::size_t size, const std::string& etag,
+      const char* if_none_match, bool head
+  );
+
 }  // namespace internal
 }  // namespace promclient
 
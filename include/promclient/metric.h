@@ -2,6 +2,7 @@
 #ifndef PROMCLIENT_METRIC_H_
 #define PROMCLIENT_METRIC_H_
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
@@ -22,9 +23,9 @@ namespace promclient {
         std::string help, std::set<std::string> labels
     );
 
-    std::set<std::string> labels() const;
-    std::string help() const;
-    std::string name() const;
+    const std::set<std::string>& labels() const;
+    const std::string& help() const;
+    const std::string& name() const;
 
     //! Type of the metric.
     /*!
@@ -36,7 +37,7 @@ namespace promclient {
      *   * histogram
      *   * untyped
      */
-    std::string type() const;
+    const std::string& type() const;
 
     //! Return a hash for the descriptor.
     /*!
@@ -62,6 +63,67 @@ namespace promclient {
   typedef std::vector<DescriptorRef>  DescriptorsList;
 
 
+  //! Reference to an external event (i.e, a trace) attached to a sample.
+  /*!
+   * Exemplars are only exposed by formats that support them
+   * (OpenMetrics) and are ignored by other formats.
+   */
+  class Exemplar {
+   public:
+    Exemplar(
+        std::map<std::string, std::string> labels,
+        double value, double timestamp
+    );
+
+    const std::map<std::string, std::string>& labels() const;
+    double value() const;
+
+    //! Seconds since the UNIX epoch when the exemplar was recorded.
+    double timestamp() const;
+
+   protected:
+    std::map<std::string, std::string> labels_;
+    double timestamp_;
+    double value_;
+  };
+  typedef std::shared_ptr<const Exemplar> ExemplarRef;
+
+
+  //! Sparse exponential buckets of a native histogram.
+  /*!
+   * Bucket `i` of schema `s` counts observations with an absolute value
+   * in (2^((i-1)/2^s), 2^(i/2^s)], for positive and negative values
+   * separately; observations within the zero threshold are only counted
+   * in the zero bucket.
+   * Bucket counts are not cumulative and empty buckets are omitted.
+   *
+   * Native buckets are only exposed by formats that support them
+   * (protobuf) and are ignored by other formats.
+   */
+  class NativeBuckets {
+   public:
+    NativeBuckets(
+        int schema, double zero_threshold, std::uint64_t zero_count,
+        std::map<int, std::uint64_t> positive,
+        std::map<int, std::uint64_t> negative
+    );
+
+    const std::map<int, std::uint64_t>& negative() const;
+    const std::map<int, std::uint64_t>& positive() const;
+    int schema() const;
+    std::uint64_t zeroCount() const;
+    double zeroThreshold() const;
+
+   protected:
+    std::map<int, std::uint64_t> negative_;
+    std::map<int, std::uint64_t> positive_;
+    int schema_;
+    std::uint64_t zero_count_;
+    double zero_threshold_;
+  };
+  typedef std::shared_ptr<const NativeBuckets> NativeBucketsRef;
+
+
   //! A single data point that is part of a metric.
   /*!
    * This is to allow both simple metrics (such as counters
@@ -74,27 +136,43 @@ namespace promclient {
     //! Compare operation to use in sorder std structures.
     class Compare {
      public:
-      bool operator()(const Sample& lhs, const Sample& rhs);
+      bool operator()(const Sample& lhs, const Sample& rhs) const;
     };
 
    public:
     Sample(
         std::string role, double value,
-        std::map<std::string, std::string> labels
+        std::map<std::string, std::string> labels,
+        ExemplarRef exemplar = nullptr, NativeBucketsRef native = nullptr
     );
 
-    std::map<std::string, std::string> labels() const;
-    std::string role() const;
+    //! Exemplar for the sample, if any (nullptr otherwise).
+    const ExemplarRef& exemplar() const;
+
+    const std::map<std::string, std::string>& labels() const;
+
+    //! Native histogram buckets, if any (nullptr otherwise).
+    const NativeBucketsRef& native() const;
+
+    const std::string& role() const;
     double value() const;
 
    protected:
+    ExemplarRef exemplar_;
     std::map<std::string, std::string> labels_;
+    NativeBucketsRef native_;
     std::string role_;
     double value_;
   };
 
 
   //! Immutable store for a collected metric.
+  /*!
+   * Accessors return references into the metric and are valid for as
+   * long as the metric is.
+   * Samples can be moved out of a metric that is no longer needed
+   * with `std::move(metric).samples()`.
+   */
   class Metric {
    public:
     //! Validates a metric label name.
@@ -123,8 +201,14 @@ namespace promclient {
     Metric(DescriptorRef descriptor, std::vector<Sample> samples);
     virtual ~Metric() = default;
 
-    DescriptorRef descriptor() const;
-    std::vector<Sample> samples() const;
+    Metric(const Metric& other) = default;
+    Metric(Metric&& other) = default;
+    Metric& operator=(const Metric& other) = default;
+    Metric& operator=(Metric&& other) = default;
+
+    const DescriptorRef& descriptor() const;
+    const std::vector<Sample>& samples() const &;
+    std::vector<Sample> samples() &&;
 
    protected:
     DescriptorRef descriptor_;
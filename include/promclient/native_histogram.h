@@ -0,0 +1,197 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_NATIVE_HISTOGRAM_H_
+#define PROMCLIENT_NATIVE_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "promclient/collector.h"
+#include "promclient/timer.h"
+#include "promclient/internal/atomic_double.h"
+#include "promclient/internal/exemplar_slot.h"
+#include "promclient/internal/phaser.h"
+#include "promclient/internal/sparse_buckets.h"
+
+
+namespace promclient {
+
+  //! Histogram with sparse exponential buckets (Prometheus native histogram).
+  /*!
+   * Bucket boundaries are powers of 2^(2^-schema), so there is no need
+   * to pick boundaries up front, and only populated buckets are stored
+   * and exposed: a whole distribution is a single series.
+   *
+   * Observations are lock free: they go to one of two fixed size
+   * bucket tables, switched with a Phaser, and collect() folds the
+   * table writers left into the one they moved to.
+   * When more then `max_buckets` buckets are populated the schema
+   * is reduced, merging pairs of adjacent buckets, until the buckets
+   * fit (or the lowest schema is reached).
+   * The resolution is never increased again.
+   *
+   * Native buckets are only exposed in the protobuf format.
+   * Text formats see a histogram with a single `+Inf` bucket.
+   */
+  class NativeHistogram : public Collector {
+   public:
+    //! Default maximum number of populated buckets.
+    static const std::size_t DEFAULT_MAX_BUCKETS = 160;
+
+    //! Default schema (8 buckets for each power of 2, about 9% wide).
+    static const int DEFAULT_SCHEMA = 3;
+
+    //! Default width of the zero bucket (2^-128).
+    static const double DEFAULT_ZERO_THRESHOLD;
+
+    //! Schemas supported by Prometheus.
+    static const int MAX_SCHEMA = 8;
+    static const int MIN_SCHEMA = -4;
+
+    //! Returns the index of the bucket a positive value falls in.
+    static int BucketIndex(double value, int schema);
+
+    //! Checks the options of a native histogram.
+    /*!
+     * Throws InvalidHistogram if the schema is out of range, the bucket
+     * limit is zero or the zero threshold is negative.
+     */
+    static void Validate(
+        int schema, std::size_t max_buckets, double zero_threshold
+    );
+
+   public:
+    NativeHistogram(
+        std::string name, std::string help,
+        int schema = DEFAULT_SCHEMA,
+        std::size_t max_buckets = DEFAULT_MAX_BUCKETS,
+        double zero_threshold = DEFAULT_ZERO_THRESHOLD
+    );
+
+    //! Create a histogram with an existing histogram descriptor.
+    /*!
+     * Used by labelled histograms so all children share one descriptor.
+     */
+    NativeHistogram(
+        DescriptorRef descriptor, int schema,
+        std::size_t max_buckets, double zero_threshold
+    );
+    ~NativeHistogram();
+
+    //! Record an observation.
+    void observe(double value);
+
+    //! Record an observation and an exemplar for it.
+    /*!
+     * Only the latest exemplar is kept, attached to the `+Inf` bucket.
+     */
+    void observe(
+        double value, const std::map<std::string, std::string>& labels
+    );
+
+    //! Returns the current schema.
+    int schema();
+
+    //! Observes the seconds spent until the timer is stopped.
+    Timer<NativeHistogram> time();
+
+    virtual MetricsList collect();
+    virtual DescriptorsList describe();
+
+   protected:
+    //! Observations recorded while writers are in one phase.
+    /*!
+     * Bucket keys encode the bucket index and the sign of observations
+     * (see Key()) so positive and negative buckets share a table.
+     */
+    struct Shard {
+      explicit Shard(std::size_t capacity);
+
+      std::atomic<int> schema;
+      std::atomic<std::uint64_t> count;
+      std::atomic<std::uint64_t> zero_count;
+      internal::AtomicDouble sum;
+      internal::SparseBuckets buckets;
+    };
+
+    //! Values of all observations at the end of a phase.
+    struct Totals {
+      std::uint64_t count;
+      double sum;
+      std::uint64_t zero_count;
+      std::map<std::int64_t, std::uint64_t> buckets;
+    };
+
+    //! Returns the table key for a bucket index and sign.
+    static std::int64_t Key(int index, bool negative);
+
+    //! Returns the key of the bucket key is merged into `levels` down.
+    static std::int64_t ReduceKey(std::int64_t key, int levels);
+
+    DescriptorRef descriptor_;
+    std::size_t max_buckets_;
+    double zero_threshold_;
+
+    //! Writers use the shard of their phase.
+    internal::Phaser phaser_;
+    std::unique_ptr<Shard> shards_[2];
+
+    //! Index of the shard writers are using (changed by rotate()).
+    int active_;
+
+    //! Buckets that did not fit the active shard on the last rotate().
+    std::map<std::int64_t, std::uint64_t> pending_;
+
+    //! Latest exemplar, allocated on first use.
+    std::atomic<internal::ExemplarSlot*> exemplar_;
+
+    //! Serialises collections and schema changes.
+    std::mutex mutex_;
+
+    //! Records value in shard, returns false if the shard is full.
+    bool record(Shard* shard, double value);
+
+    //! Lowers the schema until the buckets fit the limit.
+    void reduce();
+
+    //! Moves writers to the other shard, using the given schema.
+    /*!
+     * The shard writers left is merged into the new one and
+     * the totals it held are returned.
+     * Expects mutex_ to be held.
+     */
+    Totals rotate(int schema);
+
+    //! Number of buckets in the active shard and pending_.
+    std::size_t populated() const;
+  };
+  typedef std::shared_ptr<NativeHistogram> NativeHistogramRef;
+
+
+  //! Native histogram with labels.
+  class LabelledNativeHistogram : public LabelledCollector<NativeHistogram> {
+   public:
+    LabelledNativeHistogram(
+        std::string name, std::string help,
+        std::set<std::string> labels,
+        int schema = NativeHistogram::DEFAULT_SCHEMA,
+        std::size_t max_buckets = NativeHistogram::DEFAULT_MAX_BUCKETS,
+        double zero_threshold = NativeHistogram::DEFAULT_ZERO_THRESHOLD
+    );
+
+   protected:
+    int schema_;
+    std::size_t max_buckets_;
+    double zero_threshold_;
+
+    virtual Ref makeChild();
+  };
+  typedef std::shared_ptr<LabelledNativeHistogram> LabelledNativeHistogramRef;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_NATIVE_HISTOGRAM_H_
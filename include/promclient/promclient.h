@@ -6,10 +6,18 @@
 
 // This is just an include wrapper to make all needed headers
 // available to library users.
+#include "promclient/bound.h"
+#include "promclient/cached.h"
 #include "promclient/counter.h"
+#include "promclient/func.h"
 #include "promclient/gauge.h"
+#include "promclient/native_histogram.h"
+#include "promclient/snapshot.h"
+#include "promclient/timer.h"
 
 #include "promclient/internal/builder_counter.h"
+#include "promclient/internal/builder_func.h"
 #include "promclient/internal/builder_gauge.h"
+#include "promclient/internal/builder_native_histogram.h"
 
 #endif  // PROMCLIENT_PROMCLIENT_H_
@@ -0,0 +1,155 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_SNAPSHOT_H_
+#define PROMCLIENT_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "promclient/collector.h"
+#include "promclient/internal/atomic_double.h"
+#include "promclient/internal/phaser.h"
+
+
+namespace promclient {
+
+  class SnapshotGroup;
+
+  //! Writer critical section across metrics of a SnapshotGroup.
+  /*!
+   * All updates made through an update are either all included
+   * in a scrape or all left for the next one.
+   * Updates should be short lived: scrapes wait for them to finish.
+   */
+  class SnapshotUpdate {
+   public:
+    explicit SnapshotUpdate(const SnapshotGroup& group);
+    ~SnapshotUpdate();
+
+    SnapshotUpdate(const SnapshotUpdate&) = delete;
+    SnapshotUpdate& operator=(const SnapshotUpdate&) = delete;
+
+   protected:
+    friend class SnapshotMetric;
+    internal::Phaser* phaser_;
+    std::int64_t token_;
+  };
+
+
+  //! Base for metrics of a SnapshotGroup.
+  /*!
+   * Writes go to the slot of the current phase and scrapes fold
+   * the slot of the previous phase into a reader-owned total.
+   */
+  class SnapshotMetric {
+   public:
+    virtual ~SnapshotMetric() = default;
+
+   protected:
+    friend class SnapshotGroup;
+    SnapshotMetric(
+        DescriptorRef descriptor, std::shared_ptr<internal::Phaser> phaser
+    );
+
+    DescriptorRef descriptor_;
+    std::shared_ptr<internal::Phaser> phaser_;
+
+    //! Values written during each phase.
+    internal::AtomicDouble slots_[2];
+
+    //! Total of all ended phases, only accessed by scrapes.
+    double total_;
+
+    //! Adds value in its own critical section.
+    void add(double value);
+
+    //! Adds value in the critical section of update.
+    void add(const SnapshotUpdate& update, double value);
+
+    //! Folds the slot of an ended phase in the total and returns it.
+    double absorb(int phase);
+  };
+
+
+  //! Counter with values collected in consistent snapshots.
+  class SnapshotCounter : public SnapshotMetric {
+   public:
+    void inc(double value = 1);
+    void inc(const SnapshotUpdate& update, double value = 1);
+
+   protected:
+    friend class SnapshotGroup;
+    SnapshotCounter(
+        DescriptorRef descriptor, std::shared_ptr<internal::Phaser> phaser
+    );
+  };
+  typedef std::shared_ptr<SnapshotCounter> SnapshotCounterRef;
+
+
+  //! Gauge with values collected in consistent snapshots.
+  /*!
+   * Only relative updates are supported: a set() would not compose
+   * with increments folded from earlier phases.
+   */
+  class SnapshotGauge : public SnapshotMetric {
+   public:
+    void dec(double value = 1);
+    void dec(const SnapshotUpdate& update, double value = 1);
+    void inc(double value = 1);
+    void inc(const SnapshotUpdate& update, double value = 1);
+
+   protected:
+    friend class SnapshotGroup;
+    SnapshotGauge(
+        DescriptorRef descriptor, std::shared_ptr<internal::Phaser> phaser
+    );
+  };
+  typedef std::shared_ptr<SnapshotGauge> SnapshotGaugeRef;
+
+
+  //! Collector reading a consistent cut across a group of metrics.
+  /*!
+   * Plain counters and gauges are read one at a time during a scrape
+   * so related metrics (i.e, errors and requests) can be out of step
+   * within a scrape.
+   * Metrics in a snapshot group are double buffered: a scrape flips
+   * writers to the other buffer and waits for in-flight updates before
+   * reading, so each update (or SnapshotUpdate) is either entirely in
+   * the scrape or entirely in the next one.
+   * Updates remain lock free.
+   *
+   * Create all metrics in the group before registering it: metrics
+   * added later are not checked against the registry.
+   */
+  class SnapshotGroup : public Collector {
+   public:
+    SnapshotGroup();
+
+    MetricsList collect();
+    DescriptorsList describe();
+
+    //! Adds a counter to the group.
+    SnapshotCounterRef counter(std::string name, std::string help);
+
+    //! Adds a gauge to the group.
+    SnapshotGaugeRef gauge(std::string name, std::string help);
+
+   protected:
+    friend class SnapshotUpdate;
+
+    std::shared_ptr<internal::Phaser> phaser_;
+    std::vector<std::shared_ptr<SnapshotMetric>> metrics_;
+
+    //! Serialises scrapes and changes to the group.
+    std::mutex mutex_;
+
+    //! Checks and adds a metric to the group.
+    void add(std::shared_ptr<SnapshotMetric> metric);
+  };
+  typedef std::shared_ptr<SnapshotGroup> SnapshotGroupRef;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_SNAPSHOT_H_
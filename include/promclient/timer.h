@@ -0,0 +1,27 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#ifndef PROMCLIENT_TIMER_H_
+#define PROMCLIENT_TIMER_H_
+
+#include "promclient/internal/clock.h"
+#include "promclient/internal/timer.h"
+
+
+namespace promclient {
+
+  //! Process wide source of time for timers.
+  /*!
+   * Select a cheaper source at start up, before any timer is started:
+   *
+   *     promclient::Clock::Configure(promclient::Clock::TSC);
+   *
+   * See internal::Clock for the available sources.
+   */
+  typedef internal::Clock Clock;
+
+  //! Scoped timer returned by Gauge::time() and NativeHistogram::time().
+  template<typename Target>
+  using Timer = internal::Timer<Target>;
+
+}  // namespace promclient
+
+#endif  // PROMCLIENT_TIMER_H_
@@ -0,0 +1,67 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/bound.h"
+
+#include <mutex>
+#include <utility>
+
+#include "promclient/metric.h"
+
+using promclient::BoundCollector;
+using promclient::BoundCollectorRef;
+using promclient::CollectorRegistry;
+using promclient::ScopedBinding;
+
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::Metric;
+using promclient::MetricsList;
+
+
+BoundCollector::BoundCollector(DescriptorRef descriptor) {
+  this->bound_ = true;
+  this->descriptor_ = std::move(descriptor);
+}
+
+MetricsList BoundCollector::collect() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  MetricsList metrics;
+  if (this->bound_) {
+    metrics.push_back(Metric(this->descriptor_, this->samples()));
+  }
+  return metrics;
+}
+
+DescriptorsList BoundCollector::describe() {
+  return DescriptorsList({this->descriptor_});
+}
+
+void BoundCollector::unbind() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  this->bound_ = false;
+}
+
+
+ScopedBinding::ScopedBinding(
+    BoundCollectorRef collector, CollectorRegistry* registry
+) {
+  if (!registry) {
+    registry = CollectorRegistry::Default();
+  }
+  registry->registr(collector);
+  this->collector_ = std::move(collector);
+  this->registry_ = registry;
+}
+
+ScopedBinding::ScopedBinding(ScopedBinding&& other) {
+  this->collector_ = std::move(other.collector_);
+  this->registry_ = other.registry_;
+  other.collector_.reset();
+}
+
+ScopedBinding::~ScopedBinding() {
+  if (this->collector_) {
+    // Scrapes in progress may still hold the collector.
+    this->registry_->unregister(this->collector_);
+    this->collector_->unbind();
+  }
+}
@@ -0,0 +1,134 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/cached.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "promclient/collector.h"
+#include "promclient/metric.h"
+
+using promclient::CachedCollector;
+using promclient::CachedCollectorStats;
+using promclient::CollectorRef;
+using promclient::DescriptorsList;
+using promclient::MetricsList;
+
+
+CachedCollector::CachedCollector(
+    CollectorRef collector, std::chrono::milliseconds ttl
+) : stats_() {
+  this->collector_ = std::move(collector);
+  this->ttl_ = ttl;
+  this->warm_ = false;
+  this->refreshing_ = false;
+  this->stopping_ = false;
+}
+
+CachedCollector::~CachedCollector() {
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->stopping_ = true;
+  }
+  this->wake_.notify_one();
+  if (this->worker_.joinable()) {
+    this->worker_.join();
+  }
+}
+
+MetricsList CachedCollector::collect() {
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    if (this->warm_) {
+      auto age = std::chrono::steady_clock::now() - this->collected_;
+      if (age < this->ttl_) {
+        this->stats_.hits += 1;
+        return this->metrics_;
+      }
+
+      this->stats_.stale += 1;
+      if (!this->refreshing_) {
+        this->refreshing_ = true;
+        if (!this->worker_.joinable()) {
+          this->worker_ = std::thread(&CachedCollector::work, this);
+        }
+        this->wake_.notify_one();
+      }
+      return this->metrics_;
+    }
+  }
+
+  // Cold cache: wait for the collector (or for a concurrent scrape).
+  std::lock_guard<std::mutex> refresh(this->lock_refresh_);
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    if (this->warm_) {
+      this->stats_.hits += 1;
+      return this->metrics_;
+    }
+    this->stats_.misses += 1;
+  }
+  return this->refreshLocked();
+}
+
+DescriptorsList CachedCollector::describe() {
+  return this->collector_->describe();
+}
+
+bool CachedCollector::dynamic() {
+  return this->collector_->dynamic();
+}
+
+MetricsList CachedCollector::refresh() {
+  std::lock_guard<std::mutex> refresh(this->lock_refresh_);
+  return this->refreshLocked();
+}
+
+CachedCollectorStats CachedCollector::stats() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  return this->stats_;
+}
+
+
+MetricsList CachedCollector::refreshLocked() {
+  MetricsList metrics;
+  try {
+    metrics = this->collector_->collect();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->stats_.failures += 1;
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(this->lock_);
+  this->metrics_ = metrics;
+  this->collected_ = std::chrono::steady_clock::now();
+  this->warm_ = true;
+  this->stats_.refreshes += 1;
+  return metrics;
+}
+
+void CachedCollector::work() {
+  std::unique_lock<std::mutex> lock(this->lock_);
+  while (true) {
+    this->wake_.wait(lock, [this]() {
+      return this->refreshing_ || this->stopping_;
+    });
+    if (this->stopping_) {
+      return;
+    }
+
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> refresh(this->lock_refresh_);
+      try {
+        this->refreshLocked();
+      } catch (...) {
+        // Counted as a failure, stale metrics are kept.
+      }
+    }
+    lock.lock();
+    this->refreshing_ = false;
+  }
+}
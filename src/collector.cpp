@@ -1,2 +1,9 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/collector.h"
+
+using promclient::Collector;
+
+
+bool Collector::dynamic() {
+  return false;
+}
@@ -1,9 +1,23 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/collector_registry.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "promclient/exceptions.h"
+#include "promclient/internal/arena.h"
+#include "promclient/internal/clock.h"
+#include "promclient/internal/registry_metrics.h"
 
 using promclient::CollectorRef;
 using promclient::CollectorRegistry;
@@ -17,6 +31,10 @@ using promclient::Metric;
 using promclient::MetricsList;
 using promclient::Sample;
 
+using promclient::internal::Arena;
+using promclient::internal::Clock;
+using promclient::internal::RegistryMetrics;
+
 
 std::shared_ptr<CollectorRegistry> default_registry_;
 
@@ -30,18 +48,58 @@ CollectorRegistry* CollectorRegistry::Default() {
 }
 
 
+CollectorRegistry::CollectorRegistry()
+  : instrumented_(nullptr), epoch_(0),
+    snapshot_(std::make_shared<const Snapshot>()) {
+  // Noop.
+}
+
+
 MetricsList CollectorRegistry::collect(
     CollectorRegistry::CollectStrategy strategy
 ) {
   switch (strategy) {
     case CollectorRegistry::CollectStrategy::SORTED:
-      return this->sortedCollect();
+      return this->sortedCollect(*this->snapshot(), nullptr);
 
     default:
       throw InvalidCollectionStrategy();
   }
 }
 
+MetricsList CollectorRegistry::collect(
+    const std::set<std::string>& names,
+    CollectorRegistry::CollectStrategy strategy
+) {
+  if (strategy != CollectorRegistry::CollectStrategy::SORTED) {
+    throw InvalidCollectionStrategy();
+  }
+
+  // Find the collectors of the requested metrics.
+  std::unordered_set<Collector*> wanted;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    wanted = this->dynamic_collectors_;
+    for (const std::string& name : names) {
+      auto entry = this->collectors_by_name_.find(name);
+      if (entry != this->collectors_by_name_.end()) {
+        wanted.insert(entry->second.begin(), entry->second.end());
+      }
+    }
+  }
+
+  // Keep registration order so the first duplicate sample still wins.
+  std::vector<CollectorRef> collectors;
+  if (wanted.size() != 0) {
+    for (const CollectorRef& collector : *this->snapshot()) {
+      if (wanted.find(collector.get()) != wanted.end()) {
+        collectors.push_back(collector);
+      }
+    }
+  }
+  return this->sortedCollect(collectors, &names);
+}
+
 void CollectorRegistry::registr(CollectorRef collector) {
   // Ensure at least one metric is collected.
   DescriptorsList descriptors = collector->describe();
@@ -49,100 +107,256 @@ void CollectorRegistry::registr(CollectorRef collector) {
     throw InvalidCollector("Collector does not export any metric.");
   }
 
-  // Lock the registry so we can check the new collector and
-  // copy global settings for us to check and update them.
+  // Lock the registry so we can check the new collector
+  // against the metrics that are already registered.
   std::lock_guard<std::mutex> lock(this->mutex_);
-  std::map<std::string, std::size_t> metrics_hash = this->metrics_hash_;
 
   // Ensure metrics are not exposed with conflicting descriptors.
-  for (auto desc : descriptors) {
-    std::string name = desc->name();
-    std::size_t hash = desc->hash();
-    bool have_metric = metrics_hash.find(name) != metrics_hash.end();
-
-    if (have_metric && metrics_hash[name] != hash) {
+  // Names recorded for this collector are rolled back on conflict
+  // so a rejected collector leaves the registry unchanged.
+  std::vector<std::string> added;
+  for (const auto& desc : descriptors) {
+    auto result = this->metrics_hash_.insert(
+        std::make_pair(desc->name(), desc->hash())
+    );
+    if (result.second) {
+      added.push_back(desc->name());
+    } else if (result.first->second != desc->hash()) {
+      for (const std::string& name : added) {
+        this->metrics_hash_.erase(name);
+      }
       throw InvalidCollector(
-          "Metric " + name + " already declared with a confliction descriptor"
+          "Metric " + desc->name() +
+          " already declared with a confliction descriptor"
       );
     }
-    metrics_hash[name] = hash;
   }
 
-  // Update internal state and add the collector to the registry.
-  this->metrics_hash_ = metrics_hash;
-  this->collectors_.push_back(collector);
+  // Add the collector to the registry.
+  auto position = this->collectors_.insert(this->collectors_.end(), collector);
+  this->collectors_index_[collector.get()].push_back(position);
+  this->epoch_.fetch_add(1, std::memory_order_release);
+
+  // Index the collector by metric name, once per collector.
+  auto names = this->collector_names_.find(collector.get());
+  if (names == this->collector_names_.end()) {
+    if (collector->dynamic()) {
+      this->dynamic_collectors_.insert(collector.get());
+    }
+    std::vector<std::string>& indexed = this->collector_names_[
+      collector.get()
+    ];
+    for (const auto& desc : descriptors) {
+      const std::string& name = desc->name();
+      if (std::find(indexed.begin(), indexed.end(), name) == indexed.end()) {
+        indexed.push_back(name);
+        this->collectors_by_name_[name].push_back(collector.get());
+      }
+    }
+  }
 }
 
 bool CollectorRegistry::unregister(CollectorRef collector) {
   // Lock the registry so we can remove the collector.
   std::lock_guard<std::mutex> lock(this->mutex_);
-  std::vector<CollectorRef>::iterator it;
+  auto entry = this->collectors_index_.find(collector.get());
+  if (entry == this->collectors_index_.end()) {
+    return false;
+  }
 
   // Remove the collector but keep the descriptors.
   // If a collector for the metric name is added again,
   // it is good that we can ensure the metric is the same.
-  std::vector<std::vector<CollectorRef>::iterator> to_remove;
-  for (it = this->collectors_.begin(); it != this->collectors_.end(); it++) {
-    if (it->get() == collector.get()) {
-      to_remove.push_back(it);
+  for (const auto& position : entry->second) {
+    this->collectors_.erase(position);
+  }
+  this->collectors_index_.erase(entry);
+  this->epoch_.fetch_add(1, std::memory_order_release);
+
+  // Drop the collector from the names index.
+  auto names = this->collector_names_.find(collector.get());
+  for (const std::string& name : names->second) {
+    std::vector<Collector*>& indexed = this->collectors_by_name_[name];
+    indexed.erase(std::remove(
+        indexed.begin(), indexed.end(), collector.get()
+    ), indexed.end());
+    if (indexed.size() == 0) {
+      this->collectors_by_name_.erase(name);
     }
   }
-  for (auto it : to_remove) {
-    this->collectors_.erase(it);
+  this->collector_names_.erase(names);
+  this->dynamic_collectors_.erase(collector.get());
+  return true;
+}
+
+
+void CollectorRegistry::instrument() {
+  std::shared_ptr<RegistryMetrics> metrics;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (this->instrumentation_) {
+      return;
+    }
+    metrics = std::make_shared<RegistryMetrics>(this);
+    this->instrumentation_ = metrics;
+  }
+  this->registr(metrics);
+  this->instrumented_.store(metrics.get(), std::memory_order_release);
+}
+
+RegistryMetrics* CollectorRegistry::instrumentation() {
+  return this->instrumented_.load(std::memory_order_acquire);
+}
+
+
+std::shared_ptr<const std::vector<CollectorRef>>
+CollectorRegistry::snapshot() {
+  std::uint64_t epoch = this->epoch_.load(std::memory_order_acquire);
+  std::shared_ptr<const Snapshot> snapshot = std::atomic_load(
+      &this->snapshot_
+  );
+  if (snapshot->epoch != epoch) {
+    // Another scrape may have rebuilt it while we waited for the lock.
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    snapshot = std::atomic_load(&this->snapshot_);
+    epoch = this->epoch_.load(std::memory_order_relaxed);
+    if (snapshot->epoch != epoch) {
+      std::shared_ptr<Snapshot> rebuilt = std::make_shared<Snapshot>();
+      rebuilt->epoch = epoch;
+      rebuilt->collectors.assign(
+          this->collectors_.begin(), this->collectors_.end()
+      );
+      snapshot = rebuilt;
+      std::atomic_store(&this->snapshot_, snapshot);
+    }
   }
-  return to_remove.size() != 0;
+  return std::shared_ptr<const std::vector<CollectorRef>>(
+      snapshot, &snapshot->collectors
+  );
 }
 
 
 /*** SORTED STRATEGY ***/
+// Temporary index of the samples collected for a metric.
+// The index only points to samples owned by the collected metrics
+// and lives in a per-thread arena released once the scrape is done.
+typedef promclient::internal::ArenaAllocator<Sample*> SamplePtrAllocator;
+typedef std::vector<Sample*, SamplePtrAllocator> SamplePtrs;
+
 struct SortedMetricRecord {
+  SortedMetricRecord(DescriptorRef descriptor, SamplePtrAllocator allocator)
+    : descriptor(descriptor), samples(allocator) {
+    // Noop.
+  }
+
   DescriptorRef descriptor;
-  std::set<Sample, Sample::Compare> samples;
+  SamplePtrs samples;
 };
 
+typedef std::map<
+  std::string, SortedMetricRecord, std::less<std::string>,
+  promclient::internal::ArenaAllocator<
+    std::pair<const std::string, SortedMetricRecord>
+  >
+> SortedMetricsIndex;
 
-MetricsList CollectorRegistry::sortedCollect() {
-  std::vector<CollectorRef> collectors;
-  std::map<std::string, SortedMetricRecord> metrics_by_name;
 
-  // Scoped access to the collectors list to copy it so we can
-  // unlock the regisrty while collection is performed.
-  {
-    std::lock_guard<std::mutex> lock(this->mutex_);
-    collectors = this->collectors_;
-  }
-
-  // Collect all metrics and index by name.
-  // The map will sort metrics by name of us.
-  for (CollectorRef collector : collectors) {
-    MetricsList metrics = collector->collect();
-    for (Metric metric : metrics) {
-      DescriptorRef desc = metric.descriptor();
-      std::string name = desc->name();
-
-      // Index the metric.
-      if (metrics_by_name.find(name) == metrics_by_name.end()) {
-        SortedMetricRecord record;
-        record.descriptor = desc;
-        metrics_by_name[name] = record;
+// Resets the arena when the scrape ends, even on errors.
+class ArenaReset {
+ public:
+  explicit ArenaReset(Arena* arena) : arena_(arena) {
+    // Noop.
+  }
+
+  ~ArenaReset() {
+    this->arena_->reset();
+  }
+
+ protected:
+  Arena* arena_;
+};
+
+
+MetricsList CollectorRegistry::sortedCollect(
+    const std::vector<CollectorRef>& collectors,
+    const std::set<std::string>* names
+) {
+  static thread_local Arena arena;
+
+  // Collectors come from an immutable snapshot so collection runs
+  // without the lock; metrics are kept alive while the index is in use.
+  std::vector<MetricsList> collected;
+  collected.reserve(collectors.size());
+  RegistryMetrics* instrumentation = this->instrumentation();
+  if (instrumentation) {
+    std::vector<double> durations;
+    durations.reserve(collectors.size());
+    for (const CollectorRef& collector : collectors) {
+      std::uint64_t start = Clock::Now();
+      collected.push_back(collector->collect());
+      durations.push_back(Clock::Elapsed(start, Clock::Now()));
+    }
+    instrumentation->collected(
+        collectors, collected, durations, names == nullptr
+    );
+  } else {
+    for (const CollectorRef& collector : collectors) {
+      collected.push_back(collector->collect());
+    }
+  }
+
+  // Declared before the index so the index is destroyed first.
+  ArenaReset reset(&arena);
+  SamplePtrAllocator allocator(&arena);
+  SortedMetricsIndex metrics_by_name(
+      (SortedMetricsIndex::allocator_type(allocator))
+  );
+
+  // Index metrics by name; the map will sort metrics by name for us.
+  // Samples are moved out of the metrics and moved again in the result.
+  std::vector<std::vector<Sample>> samples_storage;
+  for (MetricsList& metrics : collected) {
+    for (Metric& metric : metrics) {
+      const DescriptorRef& desc = metric.descriptor();
+      if (names && names->find(desc->name()) == names->end()) {
+        continue;
+      }
+      auto record = metrics_by_name.find(desc->name());
+      if (record == metrics_by_name.end()) {
+        record = metrics_by_name.insert(std::make_pair(
+            desc->name(), SortedMetricRecord(desc, allocator)
+        )).first;
       }
 
-      // Add the samples.
-      for (Sample sample : metric.samples()) {
-        metrics_by_name[name].samples.insert(sample);
+      samples_storage.push_back(std::move(metric).samples());
+      for (Sample& sample : samples_storage.back()) {
+        record->second.samples.push_back(&sample);
       }
     }
   }
 
-  // Iterate over the "indexed" metrics and return them.
+  // Sort the samples of each metric and drop duplicates.
+  // The sort is stable so the first collected sample wins.
+  Sample::Compare compare;
+  auto less = [&compare](const Sample* lhs, const Sample* rhs) {
+    return compare(*lhs, *rhs);
+  };
+  auto same = [&compare](const Sample* lhs, const Sample* rhs) {
+    return !compare(*lhs, *rhs) && !compare(*rhs, *lhs);
+  };
+
   MetricsList metrics;
-  for (auto pair : metrics_by_name) {
-    std::vector<Sample> samples(
-        pair.second.samples.begin(),
-        pair.second.samples.end()
-    );
-    Metric metric(pair.second.descriptor, samples);
-    metrics.push_back(metric);
+  for (auto& pair : metrics_by_name) {
+    SamplePtrs& index = pair.second.samples;
+    std::stable_sort(index.begin(), index.end(), less);
+    index.erase(std::unique(index.begin(), index.end(), same), index.end());
+
+    std::vector<Sample> samples;
+    samples.reserve(index.size());
+    for (Sample* sample : index) {
+      samples.push_back(std::move(*sample));
+    }
+    metrics.emplace_back(pair.second.descriptor, std::move(samples));
   }
   return metrics;
 }
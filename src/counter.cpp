@@ -1,13 +1,19 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/counter.h"
 
+#include <atomic>
+#include <map>
 #include <mutex>
 #include <set>
 #include <string>
+#include <typeindex>
+#include <utility>
 #include <vector>
 
 #include "promclient/exceptions.h"
 #include "promclient/metric.h"
+#include "promclient/internal/clock.h"
+#include "promclient/internal/exception_tracking.h"
 
 using promclient::Counter;
 using promclient::LabelledCollector;
@@ -17,29 +23,59 @@ using promclient::CounterDecrease;
 using promclient::Descriptor;
 using promclient::DescriptorRef;
 using promclient::DescriptorsList;
+using promclient::ExemplarRef;
 
 using promclient::Metric;
 using promclient::MetricsList;
 using promclient::Sample;
 
+using promclient::internal::Clock;
+using promclient::internal::ExemplarSlot;
 
-Counter::Counter(std::string name, std::string help, double initial) {
-  this->help_ = help;
-  this->name_ = name;
-  this->value_ = initial;
-  this->descriptor_ = DescriptorRef(new Descriptor(
-      this->name_, "counter", this->help_, {}
-  ));
+using promclient::internal::CurrentExceptionType;
+using promclient::internal::TypeName;
+using promclient::internal::UncaughtExceptions;
+
+
+Counter::Counter(std::string name, std::string help, double initial)
+  : Counter(
+      DescriptorRef(new Descriptor(name, "counter", help, {})), initial
+  ) {
+  // Noop.
+}
+
+Counter::Counter(DescriptorRef descriptor, double initial)
+  : local_(initial), exemplar_(nullptr) {
+  this->value_ = &this->local_;
+  this->descriptor_ = std::move(descriptor);
+}
+
+Counter::Counter(
+    std::string name, std::string help,
+    internal::AtomicDouble* value
+) : Counter(DescriptorRef(new Descriptor(name, "counter", help, {})), value) {
+  // Noop.
+}
+
+Counter::Counter(DescriptorRef descriptor, internal::AtomicDouble* value)
+  : exemplar_(nullptr) {
+  this->value_ = value;
+  this->descriptor_ = std::move(descriptor);
+}
+
+Counter::~Counter() {
+  delete this->exemplar_.load();
 }
 
 MetricsList Counter::collect() {
-  double value = 0;
-  {
-    std::lock_guard<std::mutex> lock(this->mutex_);
-    value = this->value_;
+  ExemplarRef exemplar;
+  ExemplarSlot* slot = this->exemplar_.load(std::memory_order_acquire);
+  if (slot) {
+    exemplar = slot->load();
   }
+
   MetricsList metrics;
-  Sample sample("", value, {});
+  Sample sample("", this->value_->load(), {}, exemplar);
   metrics.push_back(Metric(this->descriptor_, {sample}));
   return metrics;
 }
@@ -50,21 +86,82 @@ DescriptorsList Counter::describe() {
 
 void Counter::inc(double value) {
   if (value < 0) {
-    throw CounterDecrease(this->name_);
+    throw CounterDecrease(this->descriptor_->name());
+  }
+  this->value_->add(value);
+}
+
+void Counter::inc(
+    double value, const std::map<std::string, std::string>& labels
+) {
+  if (value < 0) {
+    throw CounterDecrease(this->descriptor_->name());
+  }
+
+  ExemplarSlot* slot = ExemplarSlot::Install(&this->exemplar_);
+
+  // Record the exemplar first so invalid labels leave the value unchanged.
+  slot->store(labels, value, Clock::WallTime());
+  this->value_->add(value);
+}
+
+Counter::ExceptionGuard Counter::countExceptions() {
+  return Counter::ExceptionGuard(this);
+}
+
+
+Counter::ExceptionGuard::ExceptionGuard(Counter* counter) {
+  this->counter_ = counter;
+  this->uncaught_ = UncaughtExceptions();
+}
+
+Counter::ExceptionGuard::ExceptionGuard(Counter::ExceptionGuard&& other) {
+  this->counter_ = other.counter_;
+  this->uncaught_ = other.uncaught_;
+  other.counter_ = nullptr;
+}
+
+Counter::ExceptionGuard::~ExceptionGuard() {
+  // More uncaught exceptions then at creation means we are unwinding.
+  if (this->counter_ && UncaughtExceptions() > this->uncaught_) {
+    this->counter_->inc();
   }
-  std::lock_guard<std::mutex> lock(this->mutex_);
-  this->value_ += value;
 }
 
 
 LabelledCounter::LabelledCounter(
     std::string name, std::string help,
     std::set<std::string> labels
-) : LabelledCollector<Counter>(labels) {
-  this->help_ = help;
-  this->name_ = name;
+) : LabelledCollector<Counter>(std::move(labels), {
+      DescriptorRef(new Descriptor(name, "counter", help, {}))
+    }) {
+  // Noop.
 }
 
+const std::size_t LabelledCounter::MAX_EXCEPTION_TYPES;
+const std::string LabelledCounter::OTHER_EXCEPTION = "other";
+
 LabelledCounter::Ref LabelledCounter::makeChild() {
-  return LabelledCounter::Ref(new Counter(this->name_, this->help_));
+  return LabelledCounter::Ref(new Counter(this->child_descriptors_[0]));
+}
+
+std::string LabelledCounter::exceptionName() {
+  const std::type_info* type = CurrentExceptionType();
+  if (type == nullptr) {
+    return LabelledCounter::OTHER_EXCEPTION;
+  }
+
+  // Demangling allocates so names are cached, up to a limit.
+  std::type_index index(*type);
+  std::lock_guard<std::mutex> lock(this->exception_names_lock_);
+  auto cached = this->exception_names_.find(index);
+  if (cached != this->exception_names_.end()) {
+    return cached->second;
+  }
+  if (this->exception_names_.size() >= MAX_EXCEPTION_TYPES) {
+    return LabelledCounter::OTHER_EXCEPTION;
+  }
+  std::string name = TypeName(*type);
+  this->exception_names_[index] = name;
+  return name;
 }
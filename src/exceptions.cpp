@@ -4,10 +4,13 @@
 using promclient::CounterDecrease;
 using promclient::InvalidCollectionStrategy;
 using promclient::InvalidCollector;
+using promclient::InvalidExemplar;
+using promclient::InvalidHistogram;
 using promclient::InvalidMetricLabel;
 using promclient::InvalidMetricName;
 
 using promclient::HelplessCollector;
+using promclient::MissingCollectorFunc;
 using promclient::MissingCollectorLabels;
 using promclient::NamelessCollector;
 
@@ -33,6 +36,18 @@ InvalidCollector::InvalidCollector(std::string what) :
   // Noop.
 }
 
+InvalidExemplar::InvalidExemplar(std::string what) :
+  std::runtime_error(what)
+{
+  // Noop.
+}
+
+InvalidHistogram::InvalidHistogram(std::string what) :
+  std::runtime_error(what)
+{
+  // Noop.
+}
+
 InvalidMetricLabel::InvalidMetricLabel(std::string name) :
   std::runtime_error(
       "Metric label '" + name + "' is not a valid Prometheous label"
@@ -55,6 +70,12 @@ HelplessCollector::HelplessCollector() :
   // Noop.
 }
 
+MissingCollectorFunc::MissingCollectorFunc() :
+  std::runtime_error("Cannot create a callback collector without a callback")
+{
+  // Noop.
+}
+
 MissingCollectorLabels::MissingCollectorLabels() :
   std::runtime_error("Labelled collectors must have at least one label")
 {
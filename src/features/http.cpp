@@ -2,46 +2,178 @@
 #include "promclient/features/http.h"
 
 #include <onion/onion.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "promclient/collector_registry.h"
+#include "promclient/internal/protobuf_formatter.h"
+#include "promclient/internal/registry_metrics.h"
 #include "promclient/internal/text_formatter.h"
+#include "promclient/internal/utils.h"
 #include "promclient/metric.h"
 
 
 using promclient::CollectorRegistry;
+using promclient::DescriptorRef;
 using promclient::MetricsList;
 using promclient::Sample;
 
+using promclient::features::EndpointLimits;
 using promclient::features::HttpExporter;
-using promclient::internal::TextFormatBridge;
+using promclient::internal::BufferTextBridge;
+using promclient::internal::ProtobufFormatBridge;
+using promclient::internal::ProtobufFormatter;
+using promclient::internal::RegistryMetrics;
+using promclient::internal::TextFormatter;
+
+using promclient::internal::ETag;
+using promclient::internal::PlanResponse;
+using promclient::internal::ResponsePlan;
 
 
-//! Write lines to an onion response.
-class OnionTextBridge : public TextFormatBridge {
+//! Parts of a body rendered from metrics that change every scrape.
+/*!
+ * Left out of the ETag so self-instrumentation (which updates its
+ * scrape metrics on each scrape) does not defeat If-None-Match.
+ */
+class PerScrapeRanges {
  public:
-  OnionTextBridge(
-      CollectorRegistry* registry, onion_response* response
-  ) : TextFormatBridge(registry) {
-    this->response_ = response;
+  explicit PerScrapeRanges(std::string* body) {
+    this->body_ = body;
+    this->open_ = false;
   }
 
-  void setContentType() {
-    onion_response_set_header(
-        this->response_, "Content-Type",
-        "text/plain; version=0.0.4"
-    );
+  //! Tags the body without the per-scrape metrics.
+  std::string etag() {
+    this->close();
+    return ETag(*this->body_, this->ranges_);
+  }
+
+  //! Marks the start of a metric in the body.
+  void starting(const DescriptorRef& descriptor) {
+    this->close();
+    if (RegistryMetrics::PerScrape(descriptor->name())) {
+      this->ranges_.emplace_back(this->body_->size(), 0);
+      this->open_ = true;
+    }
+  }
+
+ protected:
+  std::string* body_;
+  bool open_;
+  std::vector<std::pair<std::size_t, std::size_t>> ranges_;
+
+  void close() {
+    if (this->open_) {
+      this->ranges_.back().second = this->body_->size();
+      this->open_ = false;
+    }
+  }
+};
+
+
+//! Buffers metric families of a scrape so the body can be tagged.
+class BufferProtobufBridge : public ProtobufFormatBridge {
+ public:
+  BufferProtobufBridge(CollectorRegistry* registry, std::string* body)
+    : ProtobufFormatBridge(registry), ranges_(body) {
+    this->body_ = body;
+  }
+
+  std::string etag() {
+    return this->ranges_.etag();
+  }
+
+ protected:
+  std::string* body_;
+  PerScrapeRanges ranges_;
+
+  void starting(const DescriptorRef& descriptor) {
+    this->ranges_.starting(descriptor);
+  }
+
+  void write(const std::string& family) {
+    this->body_->append(family);
+  }
+};
+
+
+//! Buffers the text exposition of a scrape so the body can be tagged.
+class TaggedTextBridge : public BufferTextBridge {
+ public:
+  TaggedTextBridge(
+      CollectorRegistry* registry, std::string* body,
+      TextFormatter::Format format
+  ) : BufferTextBridge(registry, body, format), ranges_(body) {
+    // Noop.
+  }
+
+  std::string etag() {
+    return this->ranges_.etag();
   }
 
  protected:
-  onion_response* response_;
+  PerScrapeRanges ranges_;
 
-  void write(std::string line) {
-    onion_response_write0(this->response_, line.c_str());
+  void starting(const DescriptorRef& descriptor) {
+    this->ranges_.starting(descriptor);
   }
 };
 
 
+//! Collects the values of `name[]` query parameters.
+static void CollectNames(
+    void* data, const char* key, const void* value, int flags
+) {
+  if (std::strcmp(key, "name[]") == 0 && value != nullptr) {
+    std::set<std::string>* names = static_cast<std::set<std::string>*>(data);
+    names->insert(static_cast<const char*>(value));
+  }
+}
+
+
+//! Releases an endpoint concurrency slot when the scrape ends.
+class SlotGuard {
+ public:
+  explicit SlotGuard(promclient::internal::Semaphore* slots) {
+    this->slots_ = slots;
+  }
+
+  ~SlotGuard() {
+    this->slots_->release();
+  }
+
+ protected:
+  promclient::internal::Semaphore* slots_;
+};
+
+
+EndpointLimits::EndpointLimits(
+    std::size_t concurrency, std::chrono::milliseconds timeout
+) {
+  this->concurrency = concurrency;
+  this->timeout = timeout;
+}
+
+
+HttpExporter::Endpoint::Endpoint(
+    HttpExporter* exporter, std::string path,
+    CollectorRegistry* registry, EndpointLimits limits
+) : limits(limits), slots(limits.concurrency), body_size(0) {
+  this->exporter = exporter;
+  this->path = std::move(path);
+  this->registry = registry;
+}
+
+
 HttpExporter::HttpExporter(
     CollectorRegistry* registry,
     std::string host, std::string port
@@ -49,11 +181,7 @@ HttpExporter::HttpExporter(
   this->host_  = host;
   this->onion_ = nullptr;
   this->port_  = port;
-
-  this->registry_ = registry;
-  if (this->registry_ == nullptr) {
-    this->registry_ = CollectorRegistry::Default();
-  }
+  this->addEndpoint("/metrics", registry);
 }
 
 HttpExporter::~HttpExporter() {
@@ -63,6 +191,30 @@ HttpExporter::~HttpExporter() {
 }
 
 
+void HttpExporter::addEndpoint(
+    std::string path, CollectorRegistry* registry, EndpointLimits limits
+) {
+  if (this->onion_) {
+    throw std::runtime_error("Endpoints must be added before mount");
+  }
+  if (registry == nullptr) {
+    registry = CollectorRegistry::Default();
+  }
+
+  // Onion matches paths without the leading slash.
+  path.erase(0, path.find_first_not_of('/'));
+  this->endpoints_.erase(
+      std::remove_if(
+        this->endpoints_.begin(), this->endpoints_.end(),
+        [&path](const std::unique_ptr<Endpoint>& endpoint) {
+          return endpoint->path == path;
+        }
+      ),
+      this->endpoints_.end()
+  );
+  this->endpoints_.emplace_back(new Endpoint(this, path, registry, limits));
+}
+
 std::string HttpExporter::endpoint() {
   if (!this->onion_) {
     throw std::runtime_error("Need to call mount first");
@@ -83,14 +235,28 @@ void HttpExporter::mount() {
   onion_set_hostname(this->onion_, this->host_.c_str());
   onion_set_port(this->onion_, this->port_.c_str());
 
-  // Add paths
+  // Add paths, longest first so nested paths are matched before
+  // the paths they are nested in.
+  std::vector<Endpoint*> endpoints;
+  for (const auto& endpoint : this->endpoints_) {
+    endpoints.push_back(endpoint.get());
+  }
+  std::stable_sort(
+      endpoints.begin(), endpoints.end(),
+      [](const Endpoint* lhs, const Endpoint* rhs) {
+        return lhs->path.size() > rhs->path.size();
+      }
+  );
+
   onion_url* urls = onion_root_url(this->onion_);
+  for (Endpoint* endpoint : endpoints) {
+    onion_url_add_handler(
+        urls, endpoint->path.c_str(), onion_handler_new(
+          HttpExporter::CallMetrics, endpoint, nullptr
+        )
+    );
+  }
   onion_url_add_static(urls, "", "See /metrics", HTTP_OK);
-  onion_url_add_handler(
-      urls, "metrics", onion_handler_new(
-        HttpExporter::CallMetrics, this, nullptr
-      )
-  );
 }
 
 void HttpExporter::stop() {
@@ -108,16 +274,83 @@ onion_connection_status HttpExporter::CallMetrics(
   if (!instance) {
     throw std::runtime_error("Unable to call exporter back");
   }
-  HttpExporter* server = static_cast<HttpExporter*>(instance);
-  return server->metrics(request, response);
+  Endpoint* endpoint = static_cast<Endpoint*>(instance);
+  return endpoint->exporter->metrics(endpoint, request, response);
 }
 
 
 onion_connection_status HttpExporter::metrics(
-    onion_request* request, onion_response* response
+    Endpoint* endpoint, onion_request* request, onion_response* response
 ) {
-  OnionTextBridge bridge(this->registry_, response);
-  bridge.setContentType();
+  // Shed scrapes once the endpoint is busy for longer then the timeout.
+  if (!endpoint->slots.acquire(endpoint->limits.timeout)) {
+    onion_response_set_code(response, HTTP_SERVICE_UNAVALIABLE);
+    onion_response_write0(response, "Too many concurrent scrapes\n");
+    return OCS_PROCESSED;
+  }
+  SlotGuard slot(&endpoint->slots);
+
+  // Only collect the metrics listed with `name[]`, if any.
+  std::set<std::string> names;
+  onion_dict* query = onion_request_get_query_dict(request);
+  if (query) {
+    onion_dict_preorder(
+        query, reinterpret_cast<void*>(CollectNames), &names
+    );
+  }
+
+  // Expose native histograms to clients that accept protobuf.
+  const char* header = onion_request_get_header(request, "Accept");
+  std::string accept = header ? header : "";
+  std::string body;
+  body.reserve(endpoint->body_size.load(std::memory_order_relaxed));
+  if (ProtobufFormatter::Accepts(accept)) {
+    BufferProtobufBridge bridge(endpoint->registry, &body);
+    bridge.filter(names);
+    bridge.collect();
+    endpoint->body_size.store(body.size(), std::memory_order_relaxed);
+    return this->respond(
+        request, response, ProtobufFormatter::CONTENT_TYPE, body,
+        bridge.etag()
+    );
+  }
+
+  // Expose exemplars to clients that accept OpenMetrics.
+  TextFormatter::Format format = TextFormatter::Negotiate(accept);
+
+  TaggedTextBridge bridge(endpoint->registry, &body, format);
+  bridge.filter(names);
   bridge.collect();
+  endpoint->body_size.store(body.size(), std::memory_order_relaxed);
+  return this->respond(
+      request, response, bridge.contentType(), body, bridge.etag()
+  );
+}
+
+onion_connection_status HttpExporter::respond(
+    onion_request* request, onion_response* response,
+    const char* content_type, const std::string& body,
+    const std::string& etag
+) {
+  // Clients that have the current body only need the headers.
+  onion_response_set_header(response, "ETag", etag.c_str());
+  onion_response_set_header(response, "Vary", "Accept");
+  bool head = (onion_request_get_flags(request) & OR_METHODS) == OR_HEAD;
+  ResponsePlan plan = PlanResponse(
+      body.size(), etag, onion_request_get_header(request, "If-None-Match"),
+      head
+  );
+
+  if (plan.code == 304) {
+    onion_response_set_code(response, HTTP_NOT_MODIFIED);
+  } else {
+    onion_response_set_header(response, "Content-Type", content_type);
+  }
+  onion_response_set_length(response, plan.length);
+  if (!plan.send_body) {
+    onion_response_write_headers(response);
+    return OCS_PROCESSED;
+  }
+  onion_response_write(response, body.data(), body.size());
   return OCS_PROCESSED;
 }
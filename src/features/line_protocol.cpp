@@ -0,0 +1,211 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/features/line_protocol.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/line_formatter.h"
+#include "promclient/internal/socket.h"
+
+
+using promclient::CollectorRegistry;
+
+using promclient::features::LineExporter;
+using promclient::features::LineExporterOptions;
+using promclient::features::LineExporterStats;
+using promclient::internal::LineFormatBridge;
+using promclient::internal::LineFormatter;
+
+using promclient::internal::Connect;
+using promclient::internal::SendAll;
+
+
+//! Size of the writes to TCP connections.
+static const std::size_t TCP_WRITE_SIZE = 1 << 16;
+
+
+LineExporterOptions::LineExporterOptions()
+  : interval(std::chrono::seconds(10)),
+    timeout(std::chrono::seconds(5)) {
+  this->mtu = 1432;
+  this->tcp = false;
+}
+
+
+LineExporter::LineExporter(
+    std::string host, std::string port, LineFormatter::Protocol protocol,
+    CollectorRegistry* registry, LineExporterOptions options
+) : LineFormatBridge(
+      registry ? registry : CollectorRegistry::Default(), protocol
+    ),
+    options_(options), stats_() {
+  this->host_ = std::move(host);
+  this->port_ = std::move(port);
+  this->fd_ = -1;
+  this->packets_used_ = 0;
+  this->packet_size_ = options.tcp ? TCP_WRITE_SIZE : options.mtu;
+  this->stopping_ = false;
+}
+
+LineExporter::~LineExporter() {
+  this->stop();
+  if (this->fd_ != -1) {
+    close(this->fd_);
+  }
+}
+
+
+void LineExporter::push() {
+  std::lock_guard<std::mutex> lock(this->lock_push_);
+  this->packets_used_ = 0;
+  this->collect();
+
+  // Failed increments are sent again with the next push.
+  bool sent = this->send();
+  if (sent) {
+    this->commit();
+  }
+  std::lock_guard<std::mutex> stats(this->lock_);
+  if (!sent) {
+    this->stats_.errors += 1;
+    throw std::runtime_error(
+        "Unable to send metrics to " + this->host_ + ":" + this->port_
+    );
+  }
+  this->stats_.pushes += 1;
+  this->stats_.packets += this->packets_used_;
+  for (std::size_t idx = 0; idx < this->packets_used_; idx++) {
+    this->stats_.bytes += this->packets_[idx].size();
+  }
+}
+
+void LineExporter::start() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  if (this->worker_.joinable()) {
+    throw std::runtime_error("LineExporter already started");
+  }
+  this->stopping_ = false;
+  this->worker_ = std::thread(&LineExporter::work, this);
+}
+
+LineExporterStats LineExporter::stats() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  return this->stats_;
+}
+
+void LineExporter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->stopping_ = true;
+  }
+  this->stopped_.notify_all();
+  if (this->worker_.joinable()) {
+    this->worker_.join();
+  }
+}
+
+
+bool LineExporter::send() {
+  if (this->fd_ == -1) {
+    int type = this->options_.tcp ? SOCK_STREAM : SOCK_DGRAM;
+    this->fd_ = Connect(
+        this->host_, this->port_, type, this->options_.timeout
+    );
+    if (this->fd_ == -1) {
+      return false;
+    }
+  }
+
+  bool sent = true;
+  if (this->options_.tcp) {
+    for (std::size_t idx = 0; sent && idx < this->packets_used_; idx++) {
+      const std::string& packet = this->packets_[idx];
+      sent = SendAll(this->fd_, packet.data(), packet.size());
+    }
+  } else {
+#ifdef __linux__
+    // Send all datagrams with as few system calls as possible.
+    std::vector<struct iovec> iovecs(this->packets_used_);
+    std::vector<struct mmsghdr> messages(this->packets_used_);
+    for (std::size_t idx = 0; idx < this->packets_used_; idx++) {
+      std::string& packet = this->packets_[idx];
+      iovecs[idx].iov_base = &packet[0];
+      iovecs[idx].iov_len = packet.size();
+      messages[idx] = {};
+      messages[idx].msg_hdr.msg_iov = &iovecs[idx];
+      messages[idx].msg_hdr.msg_iovlen = 1;
+    }
+    std::size_t done = 0;
+    while (sent && done < messages.size()) {
+      int result = sendmmsg(
+          this->fd_, messages.data() + done, messages.size() - done, 0
+      );
+      if (result < 0 && errno != EINTR) {
+        sent = false;
+      } else if (result > 0) {
+        done += static_cast<std::size_t>(result);
+      }
+    }
+#else
+    for (std::size_t idx = 0; sent && idx < this->packets_used_; idx++) {
+      const std::string& packet = this->packets_[idx];
+      sent = ::send(this->fd_, packet.data(), packet.size(), 0) >= 0;
+    }
+#endif
+  }
+
+  // Reconnect on the next push.
+  if (!sent) {
+    close(this->fd_);
+    this->fd_ = -1;
+  }
+  return sent;
+}
+
+void LineExporter::work() {
+  std::unique_lock<std::mutex> lock(this->lock_);
+  while (true) {
+    bool stopping = this->stopped_.wait_for(
+        lock, this->options_.interval, [this]() { return this->stopping_; }
+    );
+    if (stopping) {
+      return;
+    }
+
+    lock.unlock();
+    try {
+      this->push();
+    } catch (const std::exception&) {
+      // Counted in the stats, retried at the next interval.
+    }
+    lock.lock();
+  }
+}
+
+void LineExporter::write(const std::string& line) {
+  // Lines are never split across packets.
+  bool fits = this->packets_used_ > 0 &&
+    this->packets_[this->packets_used_ - 1].size() + line.size() <=
+      this->packet_size_;
+  if (!fits) {
+    if (this->packets_used_ == this->packets_.size()) {
+      this->packets_.emplace_back();
+      this->packets_.back().reserve(this->packet_size_);
+    }
+    this->packets_[this->packets_used_].clear();
+    this->packets_used_ += 1;
+  }
+  this->packets_[this->packets_used_ - 1].append(line);
+}
@@ -0,0 +1,718 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/features/multiprocess.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/exceptions.h"
+#include "promclient/internal/atomic_double.h"
+#include "promclient/metric.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::HelplessCollector;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::MissingCollectorLabels;
+using promclient::NamelessCollector;
+using promclient::Sample;
+
+using promclient::features::LabelledMultiProcessCounter;
+using promclient::features::LabelledMultiProcessGauge;
+using promclient::features::LabelledMultiProcessGaugeBuilder;
+using promclient::features::LabelledMultiProcessGaugeRef;
+using promclient::features::MultiProcessCollector;
+using promclient::features::MultiProcessCounter;
+using promclient::features::MultiProcessGauge;
+using promclient::features::MultiProcessGaugeBuilder;
+using promclient::features::MultiProcessGaugeRef;
+using promclient::features::MultiProcessStore;
+using promclient::internal::AtomicDouble;
+
+
+/*** FILE FORMAT ***/
+namespace {
+
+  const char MAGIC[8] = {'P', 'R', 'O', 'M', 'M', 'P', '0', '1'};
+  const char* FILE_PREFIX = "promclient_";
+  const char* FILE_SUFFIX = ".db";
+  const char* LIVE_PREFIX = "live_";
+
+  //! Record type of gauges for each MultiProcessGauge::Mode.
+  const char* const GAUGE_TYPES[] = {
+    "gauge:all", "gauge:liveall", "gauge:livesum",
+    "gauge:max", "gauge:min", "gauge:sum"
+  };
+
+  //! Returns the path of the file of a process.
+  std::string FilePath(const std::string& directory, pid_t pid, bool live) {
+    return directory + "/" + FILE_PREFIX + (live ? LIVE_PREFIX : "") +
+      std::to_string(pid) + FILE_SUFFIX;
+  }
+
+  //! Returns true if the gauge mode only includes live processes.
+  bool IsLive(MultiProcessGauge::Mode mode) {
+    return mode == MultiProcessGauge::LIVEALL ||
+      mode == MultiProcessGauge::LIVESUM;
+  }
+
+  //! Header at the start of each process file.
+  struct FileHeader {
+    char magic[8];
+    std::uint32_t capacity;
+    std::uint32_t record_size;
+    std::atomic<std::uint32_t> used;
+    char padding[44];
+  };
+
+  //! Fixed-size metric record.
+  /*!
+   * The key packs the metric type, name, help and labels
+   * (names and values) as NUL terminated strings.
+   */
+  struct Record {
+    std::atomic<std::uint32_t> ready;
+    std::uint32_t key_size;
+    char key[MultiProcessStore::KEY_SIZE];
+    AtomicDouble value;
+  };
+
+  static_assert(sizeof(FileHeader) == 64, "Unexpected file header size");
+  static_assert(sizeof(Record) == 512, "Unexpected record size");
+
+  Record* RecordAt(void* map, std::size_t index) {
+    char* records = static_cast<char*>(map) + sizeof(FileHeader);
+    return reinterpret_cast<Record*>(records + index * sizeof(Record));
+  }
+
+  std::string PackKey(
+      const std::string& name, const std::string& type,
+      const std::string& help,
+      const std::map<std::string, std::string>& labels
+  ) {
+    std::string key;
+    key.append(type).push_back('\0');
+    key.append(name).push_back('\0');
+    key.append(help).push_back('\0');
+    for (const auto& pair : labels) {
+      key.append(pair.first).push_back('\0');
+      key.append(pair.second).push_back('\0');
+    }
+    return key;
+  }
+
+  std::vector<std::string> UnpackKey(const char* key, std::size_t size) {
+    std::vector<std::string> fields;
+    std::size_t start = 0;
+    for (std::size_t idx = 0; idx < size; idx++) {
+      if (key[idx] == '\0') {
+        fields.push_back(std::string(key + start, idx - start));
+        start = idx + 1;
+      }
+    }
+    return fields;
+  }
+
+
+  //! Metric aggregated across process files.
+  struct Family {
+    std::string type;
+    std::string mode;
+    std::string help;
+    std::set<std::string> labels;
+    std::map<std::map<std::string, std::string>, double> values;
+  };
+
+  //! Aggregates the value of a process into a family.
+  void Aggregate(
+      Family* family, std::map<std::string, std::string> labels,
+      double value, const std::string& pid
+  ) {
+    if (family->mode == "all" || family->mode == "liveall") {
+      labels["pid"] = pid;
+    }
+    auto existing = family->values.find(labels);
+    if (existing == family->values.end()) {
+      family->values[labels] = value;
+    } else if (family->mode == "max") {
+      existing->second = std::max(existing->second, value);
+    } else if (family->mode == "min") {
+      existing->second = std::min(existing->second, value);
+    } else {
+      existing->second += value;
+    }
+  }
+
+  //! Add the values in a process file to the aggregated families.
+  bool ReadFile(
+      const std::string& path, const std::string& pid,
+      std::map<std::string, Family>* families
+  ) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      return false;
+    }
+    std::size_t size = info.st_size;
+    if (size < sizeof(FileHeader)) {
+      close(fd);
+      return false;
+    }
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      return false;
+    }
+
+    // Validate the header before reading records.
+    const FileHeader* header = static_cast<const FileHeader*>(map);
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->record_size == sizeof(Record);
+    valid = valid && size >= sizeof(FileHeader) +
+      static_cast<std::size_t>(header->capacity) * sizeof(Record);
+    if (!valid) {
+      munmap(map, size);
+      return false;
+    }
+
+    std::size_t used = header->used.load(std::memory_order_acquire);
+    if (used > header->capacity) {
+      used = header->capacity;
+    }
+
+    for (std::size_t idx = 0; idx < used; idx++) {
+      const Record* record = RecordAt(map, idx);
+      if (record->ready.load(std::memory_order_acquire) != 1) {
+        continue;
+      }
+      std::size_t key_size = record->key_size;
+      if (key_size > MultiProcessStore::KEY_SIZE) {
+        continue;
+      }
+      std::vector<std::string> fields = UnpackKey(record->key, key_size);
+      if (fields.size() < 3 || (fields.size() - 3) % 2 != 0) {
+        continue;
+      }
+
+      std::map<std::string, std::string> labels;
+      for (std::size_t field = 3; field < fields.size(); field += 2) {
+        labels[fields[field]] = fields[field + 1];
+      }
+
+      // Gauge types carry the aggregation mode: `gauge:<mode>`.
+      Family& family = (*families)[fields[1]];
+      if (family.type == "") {
+        std::size_t colon = fields[0].find(':');
+        family.type = fields[0].substr(0, colon);
+        family.mode = colon == std::string::npos ?
+          "sum" : fields[0].substr(colon + 1);
+        family.help = fields[2];
+        for (const auto& pair : labels) {
+          family.labels.insert(pair.first);
+        }
+        if (family.mode == "all" || family.mode == "liveall") {
+          family.labels.insert("pid");
+        }
+      }
+      Aggregate(&family, std::move(labels), record->value.load(), pid);
+    }
+
+    munmap(map, size);
+    return true;
+  }
+
+}  // namespace
+
+
+/*** STORE ***/
+static std::mutex current_mutex_;
+static std::string current_directory_;
+static std::size_t current_capacity_ = 4096;
+static pid_t current_pid_ = 0;
+static MultiProcessStore* current_ = nullptr;
+static MultiProcessStore* current_live_ = nullptr;
+
+
+void MultiProcessStore::Configure(
+    std::string directory, std::size_t capacity
+) {
+  std::lock_guard<std::mutex> lock(current_mutex_);
+  current_directory_ = directory;
+  current_capacity_ = capacity;
+  current_ = nullptr;
+  current_live_ = nullptr;
+}
+
+MultiProcessStore* MultiProcessStore::Current(bool live) {
+  std::lock_guard<std::mutex> lock(current_mutex_);
+  if (current_directory_ == "") {
+    throw std::runtime_error("MultiProcessStore::Configure was not called");
+  }
+
+  // Stores are never freed: metrics keep pointers into them.
+  pid_t pid = getpid();
+  if (current_pid_ != pid) {
+    current_ = nullptr;
+    current_live_ = nullptr;
+    current_pid_ = pid;
+  }
+  MultiProcessStore*& current = live ? current_live_ : current_;
+  if (current == nullptr) {
+    // Live values of an exited process with the same pid are stale.
+    std::string path = FilePath(current_directory_, pid, live);
+    if (live) {
+      unlink(path.c_str());
+    }
+    current = new MultiProcessStore(path, current_capacity_);
+  }
+  return current;
+}
+
+
+MultiProcessStore::MultiProcessStore(std::string path, std::size_t capacity) {
+  this->path_ = path;
+
+  // The file is not truncated: a process reusing the pid of one that
+  // exited takes over its records so aggregated counters never go back.
+  this->fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (this->fd_ < 0) {
+    throw std::runtime_error("Unable to create metrics file " + path);
+  }
+  FileHeader existing;
+  struct stat info;
+  bool adopt = fstat(this->fd_, &info) == 0 &&
+    pread(this->fd_, &existing, sizeof(existing), 0) ==
+      static_cast<ssize_t>(sizeof(existing));
+  adopt = adopt && std::memcmp(existing.magic, MAGIC, sizeof(MAGIC)) == 0;
+  adopt = adopt && existing.record_size == sizeof(Record);
+  adopt = adopt && static_cast<std::size_t>(info.st_size) >=
+    sizeof(FileHeader) + existing.capacity * sizeof(Record);
+  if (adopt) {
+    capacity = std::max<std::size_t>(capacity, existing.capacity);
+  } else if (ftruncate(this->fd_, 0) != 0) {
+    close(this->fd_);
+    throw std::runtime_error("Unable to reset metrics file " + path);
+  }
+
+  this->capacity_ = capacity;
+  this->size_ = sizeof(FileHeader) + capacity * sizeof(Record);
+  if (ftruncate(this->fd_, this->size_) != 0) {
+    close(this->fd_);
+    throw std::runtime_error("Unable to size metrics file " + path);
+  }
+  this->map_ = mmap(
+      nullptr, this->size_, PROT_READ | PROT_WRITE,
+      MAP_SHARED, this->fd_, 0
+  );
+  if (this->map_ == MAP_FAILED) {
+    close(this->fd_);
+    throw std::runtime_error("Unable to map metrics file " + path);
+  }
+
+  FileHeader* header = static_cast<FileHeader*>(this->map_);
+  if (adopt) {
+    // The file was grown before the capacity so readers stay in bounds.
+    header->capacity = capacity;
+    std::size_t used = std::min<std::size_t>(header->used.load(), capacity);
+    for (std::size_t idx = 0; idx < used; idx++) {
+      Record* record = RecordAt(this->map_, idx);
+      bool valid = record->ready.load() == 1 &&
+        record->key_size <= MultiProcessStore::KEY_SIZE;
+      if (valid) {
+        std::string key(record->key, record->key_size);
+        this->values_[key] = &record->value;
+      }
+    }
+    return;
+  }
+
+  // The magic is written last so readers never see partial headers.
+  header->capacity = capacity;
+  header->record_size = sizeof(Record);
+  header->used.store(0);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+}
+
+MultiProcessStore::~MultiProcessStore() {
+  munmap(this->map_, this->size_);
+  close(this->fd_);
+}
+
+
+AtomicDouble* MultiProcessStore::value(
+    const std::string& name, const std::string& type,
+    const std::string& help,
+    const std::map<std::string, std::string>& labels
+) {
+  std::string key = PackKey(name, type, help, labels);
+  if (key.size() > MultiProcessStore::KEY_SIZE) {
+    throw std::runtime_error("Metric " + name + " is too large to store");
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  auto cached = this->values_.find(key);
+  if (cached != this->values_.end()) {
+    return cached->second;
+  }
+
+  FileHeader* header = static_cast<FileHeader*>(this->map_);
+  std::uint32_t index = header->used.load();
+  if (index >= this->capacity_) {
+    throw std::runtime_error("Metrics file " + this->path_ + " is full");
+  }
+
+  // Fill the record before publishing it to readers.
+  // A process that exited mid-allocation may have left it ready.
+  Record* record = RecordAt(this->map_, index);
+  record->ready.store(0);
+  new (&record->value) AtomicDouble(0);
+  std::memcpy(record->key, key.data(), key.size());
+  record->key_size = key.size();
+  record->ready.store(1, std::memory_order_release);
+  header->used.store(index + 1, std::memory_order_release);
+
+  this->values_[key] = &record->value;
+  return &record->value;
+}
+
+
+/*** METRICS ***/
+MultiProcessCounter::MultiProcessCounter(
+    std::string name, std::string help,
+    std::map<std::string, std::string> labels
+) : MultiProcessCounter(
+      DescriptorRef(new Descriptor(name, "counter", help, {})), labels
+  ) {
+  // Noop.
+}
+
+MultiProcessCounter::MultiProcessCounter(
+    DescriptorRef descriptor,
+    const std::map<std::string, std::string>& labels
+) : Counter(descriptor, MultiProcessStore::Current()->value(
+      descriptor->name(), "counter", descriptor->help(), labels
+  )) {
+  // Noop.
+}
+
+LabelledMultiProcessCounter::LabelledMultiProcessCounter(
+    std::string name, std::string help,
+    std::set<std::string> labels
+) : LabelledCollector<Counter>(std::move(labels), {
+      DescriptorRef(new Descriptor(name, "counter", help, {}))
+    }) {
+  // Noop.
+}
+
+LabelledMultiProcessCounter::Ref LabelledMultiProcessCounter::makeChild() {
+  // Not used to describe the metric: do not allocate a record.
+  return LabelledMultiProcessCounter::Ref(
+      new Counter(this->child_descriptors_[0])
+  );
+}
+
+LabelledMultiProcessCounter::Ref LabelledMultiProcessCounter::makeChildFor(
+    const std::map<std::string, std::string>& labels
+) {
+  return LabelledMultiProcessCounter::Ref(new MultiProcessCounter(
+      this->child_descriptors_[0], labels
+  ));
+}
+
+
+MultiProcessGauge::MultiProcessGauge(
+    std::string name, std::string help,
+    std::map<std::string, std::string> labels, MultiProcessGauge::Mode mode
+) : MultiProcessGauge(
+      DescriptorRef(new Descriptor(name, "gauge", help, {})), labels, mode
+  ) {
+  // Noop.
+}
+
+MultiProcessGauge::MultiProcessGauge(
+    DescriptorRef descriptor,
+    const std::map<std::string, std::string>& labels,
+    MultiProcessGauge::Mode mode
+) : Gauge(descriptor, MultiProcessStore::Current(IsLive(mode))->value(
+      descriptor->name(), GAUGE_TYPES[mode], descriptor->help(), labels
+  )) {
+  // Noop.
+}
+
+LabelledMultiProcessGauge::LabelledMultiProcessGauge(
+    std::string name, std::string help,
+    std::set<std::string> labels, MultiProcessGauge::Mode mode
+) : LabelledCollector<Gauge>(std::move(labels), {
+      DescriptorRef(new Descriptor(name, "gauge", help, {}))
+    }) {
+  this->mode_ = mode;
+}
+
+LabelledMultiProcessGauge::Ref LabelledMultiProcessGauge::makeChild() {
+  // Not used to describe the metric: do not allocate a record.
+  return LabelledMultiProcessGauge::Ref(
+      new Gauge(this->child_descriptors_[0])
+  );
+}
+
+LabelledMultiProcessGauge::Ref LabelledMultiProcessGauge::makeChildFor(
+    const std::map<std::string, std::string>& labels
+) {
+  return LabelledMultiProcessGauge::Ref(new MultiProcessGauge(
+      this->child_descriptors_[0], labels, this->mode_
+  ));
+}
+
+
+/*** BUILDERS ***/
+LabelledMultiProcessGaugeBuilder::LabelledMultiProcessGaugeBuilder() {
+  this->cardinality_ = 0;
+  this->help_set_ = false;
+  this->mode_ = MultiProcessGauge::ALL;
+}
+
+LabelledMultiProcessGaugeBuilder LabelledMultiProcessGaugeBuilder::cardinality(
+    std::size_t limit
+) {
+  this->cardinality_ = limit;
+  return *this;
+}
+
+LabelledMultiProcessGaugeBuilder LabelledMultiProcessGaugeBuilder::labels(
+    std::set<std::string> labels
+) {
+  if (labels.size() == 0) {
+    throw MissingCollectorLabels();
+  }
+  for (const std::string& label : labels) {
+    Metric::ValidateLabel(label);
+  }
+  this->labels_ = labels;
+  return *this;
+}
+
+LabelledMultiProcessGaugeBuilder LabelledMultiProcessGaugeBuilder::help(
+    std::string help
+) {
+  this->help_ = help;
+  this->help_set_ = true;
+  return *this;
+}
+
+LabelledMultiProcessGaugeBuilder LabelledMultiProcessGaugeBuilder::mode(
+    MultiProcessGauge::Mode mode
+) {
+  this->mode_ = mode;
+  return *this;
+}
+
+LabelledMultiProcessGaugeBuilder LabelledMultiProcessGaugeBuilder::name(
+    std::string name
+) {
+  Metric::ValidateName(name);
+  this->name_ = name;
+  return *this;
+}
+
+LabelledMultiProcessGaugeRef LabelledMultiProcessGaugeBuilder::build() {
+  if (this->name_ == "") {
+    throw NamelessCollector();
+  }
+  if (!this->help_set_) {
+    throw HelplessCollector();
+  }
+  if (this->labels_.size() == 0) {
+    throw MissingCollectorLabels();
+  }
+
+  LabelledMultiProcessGaugeRef collector(new LabelledMultiProcessGauge(
+      this->name_, this->help_, this->labels_, this->mode_
+  ));
+  if (this->cardinality_ != 0) {
+    collector->cardinality(this->cardinality_);
+  }
+  return collector;
+}
+
+LabelledMultiProcessGaugeRef LabelledMultiProcessGaugeBuilder::registr(
+    CollectorRegistry* registry
+) {
+  if (!registry) {
+    registry = CollectorRegistry::Default();
+  }
+  LabelledMultiProcessGaugeRef collector = this->build();
+  registry->registr(collector);
+  return collector;
+}
+
+
+MultiProcessGaugeBuilder::MultiProcessGaugeBuilder() {
+  this->help_set_ = false;
+  this->mode_ = MultiProcessGauge::ALL;
+}
+
+LabelledMultiProcessGaugeBuilder MultiProcessGaugeBuilder::labels(
+    std::set<std::string> labels
+) {
+  LabelledMultiProcessGaugeBuilder builder;
+  if (this->name_ != "") {
+    builder = builder.name(this->name_);
+  }
+  if (this->help_set_) {
+    builder = builder.help(this->help_);
+  }
+  return builder.mode(this->mode_).labels(labels);
+}
+
+MultiProcessGaugeBuilder MultiProcessGaugeBuilder::help(std::string help) {
+  this->help_ = help;
+  this->help_set_ = true;
+  return *this;
+}
+
+MultiProcessGaugeBuilder MultiProcessGaugeBuilder::mode(
+    MultiProcessGauge::Mode mode
+) {
+  this->mode_ = mode;
+  return *this;
+}
+
+MultiProcessGaugeBuilder MultiProcessGaugeBuilder::name(std::string name) {
+  Metric::ValidateName(name);
+  this->name_ = name;
+  return *this;
+}
+
+MultiProcessGaugeRef MultiProcessGaugeBuilder::build() {
+  if (this->name_ == "") {
+    throw NamelessCollector();
+  }
+  if (!this->help_set_) {
+    throw HelplessCollector();
+  }
+  return MultiProcessGaugeRef(new MultiProcessGauge(
+      this->name_, this->help_, {}, this->mode_
+  ));
+}
+
+MultiProcessGaugeRef MultiProcessGaugeBuilder::registr(
+    CollectorRegistry* registry
+) {
+  if (!registry) {
+    registry = CollectorRegistry::Default();
+  }
+  MultiProcessGaugeRef collector = this->build();
+  registry->registr(collector);
+  return collector;
+}
+
+
+void promclient::features::MarkProcessDead(pid_t pid) {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(current_mutex_);
+    directory = current_directory_;
+  }
+  if (directory == "") {
+    throw std::runtime_error("MultiProcessStore::Configure was not called");
+  }
+  std::string path = FilePath(directory, pid, true);
+  if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+    throw std::runtime_error("Unable to remove metrics file " + path);
+  }
+}
+
+
+/*** AGGREGATION ***/
+MultiProcessCollector::MultiProcessCollector(std::string directory) {
+  this->directory_ = directory;
+  this->files_descriptor_ = DescriptorRef(new Descriptor(
+      "promclient_multiprocess_files", "gauge",
+      "Number of process files aggregated by the last collection", {}
+  ));
+}
+
+MetricsList MultiProcessCollector::collect() {
+  std::map<std::string, Family> families;
+  double files = 0;
+
+  DIR* dir = opendir(this->directory_.c_str());
+  if (dir != nullptr) {
+    std::string prefix = FILE_PREFIX;
+    std::string suffix = FILE_SUFFIX;
+    std::string live = LIVE_PREFIX;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+      std::string name = entry->d_name;
+      bool match = name.size() > prefix.size() + suffix.size() &&
+        name.compare(0, prefix.size(), prefix) == 0 &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+      if (!match) {
+        continue;
+      }
+      // Names are `promclient_[live_]<pid>.db`.
+      std::string pid = name.substr(
+          prefix.size(), name.size() - prefix.size() - suffix.size()
+      );
+      if (pid.compare(0, live.size(), live) == 0) {
+        pid = pid.substr(live.size());
+      }
+      if (ReadFile(this->directory_ + "/" + name, pid, &families)) {
+        files += 1;
+      }
+    }
+    closedir(dir);
+  }
+
+  MetricsList metrics;
+  for (const auto& pair : families) {
+    DescriptorRef descriptor(new Descriptor(
+        pair.first, pair.second.type, pair.second.help, pair.second.labels
+    ));
+    std::vector<Sample> samples;
+    for (const auto& value : pair.second.values) {
+      samples.push_back(Sample("", value.second, value.first));
+    }
+    metrics.push_back(Metric(descriptor, samples));
+  }
+  metrics.push_back(Metric(this->files_descriptor_, {
+      Sample("", files, {})
+  }));
+  return metrics;
+}
+
+DescriptorsList MultiProcessCollector::describe() {
+  return DescriptorsList({this->files_descriptor_});
+}
+
+bool MultiProcessCollector::dynamic() {
+  return true;
+}
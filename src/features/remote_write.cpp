@@ -0,0 +1,289 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/features/remote_write.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/clock.h"
+#include "promclient/internal/protobuf_writer.h"
+#include "promclient/internal/remote_write.h"
+#include "promclient/internal/snappy.h"
+#include "promclient/internal/socket.h"
+#include "promclient/internal/utils.h"
+
+
+using promclient::CollectorRegistry;
+
+using promclient::features::RemoteWriteExporter;
+using promclient::features::RemoteWriteOptions;
+using promclient::features::RemoteWriteStats;
+using promclient::internal::Clock;
+using promclient::internal::ProtobufWriter;
+using promclient::internal::RemoteSeries;
+using promclient::internal::RemoteSeriesList;
+
+using promclient::internal::Connect;
+using promclient::internal::EncodeWriteRequest;
+using promclient::internal::HashBytes;
+using promclient::internal::RemoteSeriesOf;
+using promclient::internal::SendAll;
+using promclient::internal::SnappyCompress;
+
+
+//! POSTs a remote write request, returns the HTTP status or -1.
+static int Post(
+    const std::string& host, const std::string& port,
+    const std::string& path, const std::string& body,
+    std::chrono::milliseconds timeout
+) {
+  int fd = Connect(host, port, SOCK_STREAM, timeout);
+  if (fd == -1) {
+    return -1;
+  }
+
+  std::string request;
+  request.reserve(body.size() + 256);
+  request += "POST " + path + " HTTP/1.1\r\n";
+  request += "Host: " + host + ":" + port + "\r\n";
+  request += "Connection: close\r\n";
+  request += "Content-Encoding: snappy\r\n";
+  request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  request += "Content-Type: application/x-protobuf\r\n";
+  request += "User-Agent: promclient\r\n";
+  request += "X-Prometheus-Remote-Write-Version: 0.1.0\r\n";
+  request += "\r\n";
+  request += body;
+
+  // Only the status line of the response is needed.
+  int status = -1;
+  if (SendAll(fd, request.data(), request.size())) {
+    std::string response;
+    char buffer[256];
+    while (response.find("\r\n") == std::string::npos) {
+      ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+      if (size < 0 && errno == EINTR) {
+        continue;
+      }
+      if (size <= 0) {
+        break;
+      }
+      response.append(buffer, size);
+    }
+    if (response.compare(0, 5, "HTTP/") == 0) {
+      std::size_t space = response.find(' ');
+      if (space != std::string::npos) {
+        status = std::atoi(response.c_str() + space + 1);
+      }
+    }
+  }
+  close(fd);
+  return status;
+}
+
+
+RemoteWriteOptions::RemoteWriteOptions()
+  : interval(std::chrono::seconds(15)),
+    min_backoff(std::chrono::milliseconds(30)),
+    max_backoff(std::chrono::seconds(5)),
+    timeout(std::chrono::seconds(30)) {
+  this->shards = 1;
+  this->capacity = 10000;
+  this->max_samples_per_send = 2000;
+  this->max_retries = 5;
+}
+
+
+RemoteWriteExporter::RemoteWriteExporter(
+    std::string url, CollectorRegistry* registry, RemoteWriteOptions options
+) : options_(options), stats_() {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) {
+    throw std::runtime_error("Only http:// remote write URLs are supported");
+  }
+  std::size_t slash = url.find('/', scheme.size());
+  std::string authority = url.substr(scheme.size(), slash - scheme.size());
+  this->path_ = slash == std::string::npos ? "/" : url.substr(slash);
+  std::size_t colon = authority.rfind(':');
+  this->host_ = authority.substr(0, colon);
+  this->port_ = colon == std::string::npos ?
+    "80" : authority.substr(colon + 1);
+  if (this->host_ == "") {
+    throw std::runtime_error("Missing host in remote write URL " + url);
+  }
+
+  this->registry_ = registry;
+  if (this->registry_ == nullptr) {
+    this->registry_ = CollectorRegistry::Default();
+  }
+  this->options_.shards = std::max<std::size_t>(1, this->options_.shards);
+  this->options_.max_samples_per_send = std::max<std::size_t>(
+      1, this->options_.max_samples_per_send
+  );
+  for (std::size_t idx = 0; idx < this->options_.shards; idx++) {
+    this->shards_.emplace_back(new Shard());
+  }
+  this->started_ = false;
+  this->stopping_ = false;
+}
+
+RemoteWriteExporter::~RemoteWriteExporter() {
+  this->stop();
+}
+
+
+void RemoteWriteExporter::push() {
+  std::int64_t timestamp = static_cast<std::int64_t>(Clock::WallTime() * 1000);
+  RemoteSeriesList series = RemoteSeriesOf(
+      this->registry_->collect(), timestamp
+  );
+
+  std::lock_guard<std::mutex> lock(this->lock_);
+  for (RemoteSeries& remote : series) {
+    // Hash labels so each series is always sent by the same shard.
+    std::uint64_t hash = 0;
+    for (const auto& pair : remote.labels) {
+      hash = HashBytes(pair.first.data(), pair.first.size(), hash);
+      hash = HashBytes(pair.second.data(), pair.second.size(), hash);
+    }
+    Shard* shard = this->shards_[hash % this->shards_.size()].get();
+    if (shard->queue.size() >= this->options_.capacity) {
+      this->stats_.dropped += 1;
+      continue;
+    }
+    shard->queue.push_back(std::move(remote));
+  }
+  this->queued_.notify_all();
+}
+
+void RemoteWriteExporter::start() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  if (this->started_) {
+    throw std::runtime_error("RemoteWriteExporter already started");
+  }
+  this->started_ = true;
+  this->stopping_ = false;
+  for (const auto& shard : this->shards_) {
+    shard->worker = std::thread(&RemoteWriteExporter::work, this, shard.get());
+  }
+  this->snapshots_ = std::thread(&RemoteWriteExporter::snapshot, this);
+}
+
+RemoteWriteStats RemoteWriteExporter::stats() {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  return this->stats_;
+}
+
+void RemoteWriteExporter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    if (!this->started_) {
+      return;
+    }
+    this->started_ = false;
+    this->stopping_ = true;
+  }
+  this->queued_.notify_all();
+  this->stopped_.notify_all();
+
+  this->snapshots_.join();
+  for (const auto& shard : this->shards_) {
+    shard->worker.join();
+  }
+}
+
+
+void RemoteWriteExporter::send(const std::string& body, std::size_t samples) {
+  std::chrono::milliseconds backoff = this->options_.min_backoff;
+  for (std::size_t attempt = 0; ; attempt++) {
+    int status = Post(
+        this->host_, this->port_, this->path_, body, this->options_.timeout
+    );
+
+    std::unique_lock<std::mutex> lock(this->lock_);
+    if (status >= 200 && status < 300) {
+      this->stats_.sent += samples;
+      return;
+    }
+
+    // Only network errors, server errors and throttling are retried.
+    bool recoverable = status == -1 || status == 429 || status >= 500;
+    if (!recoverable || attempt >= this->options_.max_retries) {
+      this->stats_.failed += samples;
+      return;
+    }
+    if (this->stopped_.wait_for(lock, backoff, [this]() {
+      return this->stopping_;
+    })) {
+      this->stats_.failed += samples;
+      return;
+    }
+    this->stats_.retries += 1;
+    backoff = std::min(backoff * 2, this->options_.max_backoff);
+  }
+}
+
+void RemoteWriteExporter::snapshot() {
+  std::unique_lock<std::mutex> lock(this->lock_);
+  while (true) {
+    bool stopping = this->stopped_.wait_for(
+        lock, this->options_.interval, [this]() { return this->stopping_; }
+    );
+    if (stopping) {
+      return;
+    }
+
+    lock.unlock();
+    try {
+      this->push();
+    } catch (const std::exception&) {
+      // Collection errors are retried at the next interval.
+    }
+    lock.lock();
+  }
+}
+
+void RemoteWriteExporter::work(Shard* shard) {
+  // Buffers are reused across requests.
+  RemoteSeriesList batch;
+  ProtobufWriter request;
+  std::string body;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(this->lock_);
+      this->queued_.wait(lock, [this, shard]() {
+        return this->stopping_ || !shard->queue.empty();
+      });
+      if (shard->queue.empty()) {
+        return;
+      }
+
+      std::size_t size = std::min(
+          shard->queue.size(), this->options_.max_samples_per_send
+      );
+      batch.assign(
+          std::make_move_iterator(shard->queue.begin()),
+          std::make_move_iterator(shard->queue.begin() + size)
+      );
+      shard->queue.erase(shard->queue.begin(), shard->queue.begin() + size);
+    }
+
+    EncodeWriteRequest(batch, &request);
+    SnappyCompress(request.buffer(), &body);
+    this->send(body, batch.size());
+  }
+}
@@ -0,0 +1,236 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/features/unix.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "promclient/collector_registry.h"
+#include "promclient/internal/text_formatter.h"
+
+
+using promclient::CollectorRegistry;
+
+using promclient::features::TextFileExporter;
+using promclient::features::UnixSocketExporter;
+using promclient::internal::BufferTextBridge;
+using promclient::internal::TextFormatter;
+
+
+//! Writes all of a buffer to a file descriptor.
+static bool WriteAll(int fd, const std::string& buffer, bool socket) {
+  std::size_t written = 0;
+  while (written < buffer.size()) {
+    const char* data = buffer.data() + written;
+    std::size_t size = buffer.size() - written;
+    ssize_t result = socket ?
+      send(fd, data, size, MSG_NOSIGNAL) : ::write(fd, data, size);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      return false;
+    }
+    written += static_cast<std::size_t>(result);
+  }
+  return true;
+}
+
+
+UnixSocketExporter::UnixSocketExporter(
+    std::string path, CollectorRegistry* registry,
+    TextFormatter::Format format, std::chrono::milliseconds timeout
+) : stopping_(false), timeout_(timeout) {
+  this->fd_ = -1;
+  this->format_ = format;
+  this->path_ = std::move(path);
+  this->registry_ = registry;
+  if (this->registry_ == nullptr) {
+    this->registry_ = CollectorRegistry::Default();
+  }
+}
+
+UnixSocketExporter::~UnixSocketExporter() {
+  if (this->fd_ != -1) {
+    close(this->fd_);
+    unlink(this->path_.c_str());
+  }
+}
+
+
+std::string UnixSocketExporter::endpoint() {
+  if (this->fd_ == -1) {
+    throw std::runtime_error("Need to call mount first");
+  }
+  return this->path_;
+}
+
+void UnixSocketExporter::listen() {
+  if (this->fd_ == -1) {
+    throw std::runtime_error("Need to call mount first");
+  }
+
+  while (!this->stopping_.load()) {
+    int client = accept(this->fd_, nullptr, nullptr);
+    if (client == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // stop() shuts the socket down to wake accept up.
+      if (this->stopping_.load()) {
+        break;
+      }
+      throw std::runtime_error(
+          "Unable to accept on " + this->path_ + ": " + strerror(errno)
+      );
+    }
+    this->serve(client);
+    close(client);
+  }
+}
+
+void UnixSocketExporter::mount() {
+  struct sockaddr_un address;
+  if (this->path_.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Socket path is too long: " + this->path_);
+  }
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(
+      address.sun_path, this->path_.c_str(), sizeof(address.sun_path) - 1
+  );
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    throw std::runtime_error("Unable to create socket " + this->path_);
+  }
+
+  // A socket left behind by a previous process would fail bind.
+  unlink(this->path_.c_str());
+  struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+  if (bind(fd, addr, sizeof(address)) == -1 || ::listen(fd, 16) == -1) {
+    close(fd);
+    throw std::runtime_error("Unable to listen on " + this->path_);
+  }
+  this->fd_ = fd;
+}
+
+void UnixSocketExporter::stop() {
+  if (this->fd_ == -1) {
+    throw std::runtime_error("Need to call mount first");
+  }
+  this->stopping_.store(true);
+  shutdown(this->fd_, SHUT_RDWR);
+}
+
+
+void UnixSocketExporter::serve(int client) {
+  // Writes fail once blocked for the timeout, dropping stuck clients.
+  struct timeval timeout;
+  timeout.tv_sec = this->timeout_.count() / 1000;
+  timeout.tv_usec = (this->timeout_.count() % 1000) * 1000;
+  setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  this->buffer_.clear();
+  BufferTextBridge bridge(this->registry_, &this->buffer_, this->format_);
+  bridge.collect();
+
+  // Clients that go away or time out before reading are not an error.
+  WriteAll(client, this->buffer_, true);
+}
+
+
+TextFileExporter::TextFileExporter(
+    std::string path, CollectorRegistry* registry
+) : interval_(0) {
+  this->path_ = std::move(path);
+  this->temp_path_ = this->path_ + ".tmp";
+  this->registry_ = registry;
+  if (this->registry_ == nullptr) {
+    this->registry_ = CollectorRegistry::Default();
+  }
+  this->stopping_ = false;
+}
+
+TextFileExporter::~TextFileExporter() {
+  this->stop();
+}
+
+
+void TextFileExporter::start(std::chrono::milliseconds interval) {
+  this->write();
+  std::lock_guard<std::mutex> lock(this->lock_worker_);
+  if (this->worker_.joinable()) {
+    throw std::runtime_error("TextFileExporter already started");
+  }
+  this->interval_ = interval;
+  this->stopping_ = false;
+  this->worker_ = std::thread(&TextFileExporter::work, this);
+}
+
+void TextFileExporter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(this->lock_worker_);
+    this->stopping_ = true;
+  }
+  this->wake_.notify_one();
+  if (this->worker_.joinable()) {
+    this->worker_.join();
+  }
+}
+
+void TextFileExporter::write() {
+  std::lock_guard<std::mutex> lock(this->lock_write_);
+  this->buffer_.clear();
+  BufferTextBridge bridge(this->registry_, &this->buffer_);
+  bridge.collect();
+
+  const char* temp = this->temp_path_.c_str();
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    throw std::runtime_error("Unable to create " + this->temp_path_);
+  }
+  // Sync before the rename so a crash can't leave an empty file.
+  bool written = WriteAll(fd, this->buffer_, false) && fsync(fd) == 0;
+  if (close(fd) == -1 || !written) {
+    unlink(temp);
+    throw std::runtime_error("Unable to write " + this->temp_path_);
+  }
+  if (rename(temp, this->path_.c_str()) == -1) {
+    unlink(temp);
+    throw std::runtime_error("Unable to replace " + this->path_);
+  }
+}
+
+
+void TextFileExporter::work() {
+  std::unique_lock<std::mutex> lock(this->lock_worker_);
+  while (true) {
+    bool stopping = this->wake_.wait_for(lock, this->interval_, [this]() {
+      return this->stopping_;
+    });
+    if (stopping) {
+      return;
+    }
+
+    lock.unlock();
+    try {
+      this->write();
+    } catch (const std::exception&) {
+      // Retried at the next interval.
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,186 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/func.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/metric.h"
+
+using promclient::CounterFunc;
+using promclient::FuncCollector;
+using promclient::GaugeFunc;
+using promclient::LabelledCounterFunc;
+using promclient::LabelledFuncCollector;
+using promclient::LabelledGaugeFunc;
+using promclient::LabelledValues;
+using promclient::LabelledValuesFunc;
+using promclient::ValueFunc;
+
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+
+FuncCollector::FuncCollector(DescriptorRef descriptor, ValueFunc func) {
+  this->descriptor_ = std::move(descriptor);
+  this->func_ = std::move(func);
+}
+
+MetricsList FuncCollector::collect() {
+  MetricsList metrics;
+  Sample sample("", this->func_(), {});
+  metrics.push_back(Metric(this->descriptor_, {sample}));
+  return metrics;
+}
+
+DescriptorsList FuncCollector::describe() {
+  return DescriptorsList({this->descriptor_});
+}
+
+
+CounterFunc::CounterFunc(std::string name, std::string help, ValueFunc func)
+  : FuncCollector(
+      DescriptorRef(new Descriptor(name, "counter", help, {})),
+      std::move(func)
+  ) {
+  // Noop.
+}
+
+GaugeFunc::GaugeFunc(std::string name, std::string help, ValueFunc func)
+  : FuncCollector(
+      DescriptorRef(new Descriptor(name, "gauge", help, {})),
+      std::move(func)
+  ) {
+  // Noop.
+}
+
+
+//! Returns true if value is a valid UTF-8 string.
+static bool IsUtf8(const std::string& value) {
+  std::size_t idx = 0;
+  while (idx < value.size()) {
+    unsigned char lead = value[idx];
+    std::size_t extra = 0;
+    std::uint32_t point = 0;
+    if (lead < 0x80) {
+      idx += 1;
+      continue;
+    } else if ((lead & 0xE0) == 0xC0) {
+      extra = 1;
+      point = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+      extra = 2;
+      point = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+      extra = 3;
+      point = lead & 0x07;
+    } else {
+      return false;
+    }
+    if (idx + extra >= value.size()) {
+      return false;
+    }
+    for (std::size_t next = 1; next <= extra; next++) {
+      unsigned char byte = value[idx + next];
+      if ((byte & 0xC0) != 0x80) {
+        return false;
+      }
+      point = (point << 6) | (byte & 0x3F);
+    }
+
+    // Reject overlong encodings, surrogates and out of range points.
+    static const std::uint32_t MIN_POINT[] = {0, 0x80, 0x800, 0x10000};
+    if (point < MIN_POINT[extra] || point > 0x10FFFF ||
+        (point >= 0xD800 && point <= 0xDFFF)) {
+      return false;
+    }
+    idx += extra + 1;
+  }
+  return true;
+}
+
+
+LabelledFuncCollector::LabelledFuncCollector(
+    DescriptorRef descriptor, std::set<std::string> labels,
+    LabelledValuesFunc func
+) : invalid_(0) {
+  this->descriptor_ = std::move(descriptor);
+  this->func_ = std::move(func);
+  this->labels_ = std::move(labels);
+  this->invalid_descriptor_ = DescriptorRef(new Descriptor(
+      "promclient_invalid_label_sets_total", "counter",
+      "Label sets dropped by callback metrics for invalid labels",
+      {"metric"}
+  ));
+}
+
+MetricsList LabelledFuncCollector::collect() {
+  LabelledValues values = this->func_();
+  std::vector<Sample> samples;
+  samples.reserve(values.size());
+
+  for (auto& pair : values) {
+    if (this->valid(pair.first)) {
+      samples.emplace_back("", pair.second, pair.first);
+    } else {
+      this->invalid_ += 1;
+    }
+  }
+
+  MetricsList metrics;
+  metrics.push_back(Metric(this->descriptor_, std::move(samples)));
+  metrics.push_back(Metric(this->invalid_descriptor_, {Sample(
+      "", static_cast<double>(this->invalid_.load()),
+      {{"metric", this->descriptor_->name()}}
+  )}));
+  return metrics;
+}
+
+DescriptorsList LabelledFuncCollector::describe() {
+  return DescriptorsList({this->descriptor_, this->invalid_descriptor_});
+}
+
+bool LabelledFuncCollector::valid(
+    const std::map<std::string, std::string>& labels
+) const {
+  // Label sets must have exactly the collector labels.
+  if (labels.size() != this->labels_.size()) {
+    return false;
+  }
+  auto expected = this->labels_.begin();
+  for (const auto& label : labels) {
+    if (label.first != *expected || !IsUtf8(label.second)) {
+      return false;
+    }
+    expected++;
+  }
+  return true;
+}
+
+
+LabelledCounterFunc::LabelledCounterFunc(
+    std::string name, std::string help,
+    std::set<std::string> labels, LabelledValuesFunc func
+) : LabelledFuncCollector(
+      DescriptorRef(new Descriptor(name, "counter", help, labels)),
+      labels, std::move(func)
+    ) {
+  // Noop.
+}
+
+LabelledGaugeFunc::LabelledGaugeFunc(
+    std::string name, std::string help,
+    std::set<std::string> labels, LabelledValuesFunc func
+) : LabelledFuncCollector(
+      DescriptorRef(new Descriptor(name, "gauge", help, labels)),
+      labels, std::move(func)
+    ) {
+  // Noop.
+}
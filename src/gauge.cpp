@@ -1,26 +1,48 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/gauge.h"
 
+#include <set>
+#include <string>
+#include <utility>
+
+#include "promclient/internal/clock.h"
+#include "promclient/internal/timer.h"
+
 using promclient::Gauge;
 using promclient::LabelledGauge;
 
 using promclient::DescriptorsList;
 using promclient::MetricsList;
 
+using promclient::internal::Clock;
+using promclient::internal::Timer;
+
 
 Gauge::Gauge(std::string name, std::string help, double initial)
-  : value_(initial) {
-  this->help_ = help;
-  this->name_ = name;
-  this->descriptor_ = DescriptorRef(new Descriptor(
-      this->name_, "gauge", this->help_, {}
-  ));
+  : Gauge(DescriptorRef(new Descriptor(name, "gauge", help, {})), initial) {
+  // Noop.
+}
+
+Gauge::Gauge(DescriptorRef descriptor, double initial) : local_(initial) {
+  this->value_ = &this->local_;
+  this->descriptor_ = std::move(descriptor);
 }
 
+Gauge::Gauge(
+    std::string name, std::string help,
+    internal::AtomicDouble* value
+) : Gauge(DescriptorRef(new Descriptor(name, "gauge", help, {})), value) {
+  // Noop.
+}
+
+Gauge::Gauge(DescriptorRef descriptor, internal::AtomicDouble* value) {
+  this->value_ = value;
+  this->descriptor_ = std::move(descriptor);
+}
 
 MetricsList Gauge::collect() {
   MetricsList metrics;
-  Sample sample("", this->value_, {});
+  Sample sample("", this->value_->load(), {});
   metrics.push_back(Metric(this->descriptor_, {sample}));
   return metrics;
 }
@@ -33,24 +55,43 @@ DescriptorsList Gauge::describe() {
 
 
 void Gauge::dec(double value) {
-  this->update(-value);
+  this->value_->add(-value);
 }
 
 void Gauge::inc(double value) {
-  this->update(value);
+  this->value_->add(value);
 }
 
 void Gauge::set(double value) {
-  this->value_.store(value);
+  this->value_->store(value);
 }
 
+void Gauge::setToCurrentTime() {
+  this->set(Clock::WallTime());
+}
+
+Timer<Gauge> Gauge::time() {
+  return Timer<Gauge>(this, &Gauge::set);
+}
+
+Gauge::InProgress Gauge::trackInProgress() {
+  return Gauge::InProgress(this);
+}
+
+
+Gauge::InProgress::InProgress(Gauge* gauge) {
+  this->gauge_ = gauge;
+  this->gauge_->inc();
+}
+
+Gauge::InProgress::InProgress(Gauge::InProgress&& other) {
+  this->gauge_ = other.gauge_;
+  other.gauge_ = nullptr;
+}
 
-void Gauge::update(double value) {
-  // Perform a read-modify-write in a loop to eventually update
-  // the stored value without conflicts with other treads.
-  double stored = this->value_.load();
-  while (!value_.compare_exchange_weak(stored, stored + value)) {
-    // Noop.
+Gauge::InProgress::~InProgress() {
+  if (this->gauge_) {
+    this->gauge_->dec();
   }
 }
 
@@ -58,11 +99,12 @@ void Gauge::update(double value) {
 LabelledGauge::LabelledGauge(
     std::string name, std::string help,
     std::set<std::string> labels
-) : LabelledCollector<Gauge>(labels) {
-  this->help_ = help;
-  this->name_ = name;
+) : LabelledCollector<Gauge>(std::move(labels), {
+      DescriptorRef(new Descriptor(name, "gauge", help, {}))
+    }) {
+  // Noop.
 }
 
 LabelledGauge::Ref LabelledGauge::makeChild() {
-  return LabelledGauge::Ref(new Gauge(this->name_, this->help_));
+  return LabelledGauge::Ref(new Gauge(this->child_descriptors_[0]));
 }
@@ -0,0 +1,61 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using promclient::internal::Arena;
+
+
+Arena::Arena(std::size_t block_size) {
+  this->block_size_ = block_size;
+  this->cursor_ = nullptr;
+  this->end_ = nullptr;
+}
+
+Arena::~Arena() {
+  for (auto block : this->blocks_) {
+    delete[] block.data;
+  }
+}
+
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+  std::uintptr_t cursor = reinterpret_cast<std::uintptr_t>(this->cursor_);
+  std::uintptr_t aligned = (cursor + alignment - 1) & ~(alignment - 1);
+  std::uintptr_t end = reinterpret_cast<std::uintptr_t>(this->end_);
+
+  if (this->cursor_ == nullptr || aligned + size > end) {
+    this->grow(size + alignment);
+    cursor = reinterpret_cast<std::uintptr_t>(this->cursor_);
+    aligned = (cursor + alignment - 1) & ~(alignment - 1);
+  }
+
+  this->cursor_ = reinterpret_cast<char*>(aligned + size);
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::reset() {
+  if (this->blocks_.size() == 0) {
+    return;
+  }
+
+  // Keep the first block around for the next round of allocations.
+  for (std::size_t idx = 1; idx < this->blocks_.size(); idx++) {
+    delete[] this->blocks_[idx].data;
+  }
+  this->blocks_.resize(1);
+  this->cursor_ = this->blocks_[0].data;
+  this->end_ = this->blocks_[0].data + this->blocks_[0].size;
+}
+
+
+void Arena::grow(std::size_t size) {
+  Block block;
+  block.size = size > this->block_size_ ? size : this->block_size_;
+  block.data = new char[block.size];
+  this->blocks_.push_back(block);
+  this->cursor_ = block.data;
+  this->end_ = block.data + block.size;
+}
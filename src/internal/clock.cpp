@@ -0,0 +1,118 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/clock.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define PROMCLIENT_HAS_TSC 1
+#endif
+
+using promclient::internal::Clock;
+
+
+//! Source used by Now(), published after the TSC rate is measured.
+static std::atomic<int> CLOCK_SOURCE(Clock::Source::STEADY);
+
+//! Seconds per time stamp counter tick.
+static double TSC_SECONDS = 0;
+
+
+//! Nanoseconds of the steady clock.
+static std::uint64_t SteadyNow() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+#ifdef CLOCK_MONOTONIC_COARSE
+//! Nanoseconds of the coarse monotonic clock.
+static std::uint64_t CoarseNow() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return static_cast<std::uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+#endif
+
+#ifdef PROMCLIENT_HAS_TSC
+//! Checks the CPU advertises an invariant time stamp counter.
+static bool InvariantTsc() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1 << 8)) != 0;
+}
+
+//! Measures the time stamp counter rate against the steady clock.
+static double MeasureTsc() {
+  std::uint64_t steady_start = SteadyNow();
+  std::uint64_t tsc_start = __rdtsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::uint64_t steady_end = SteadyNow();
+  std::uint64_t tsc_end = __rdtsc();
+  double seconds = (steady_end - steady_start) / 1e9;
+  return seconds / static_cast<double>(tsc_end - tsc_start);
+}
+#endif
+
+
+Clock::Source Clock::Configure(Clock::Source source) {
+  Clock::Source selected = Clock::Source::STEADY;
+#ifdef CLOCK_MONOTONIC_COARSE
+  if (source == Clock::Source::COARSE) {
+    selected = Clock::Source::COARSE;
+  }
+#endif
+#ifdef PROMCLIENT_HAS_TSC
+  if (source == Clock::Source::TSC && InvariantTsc()) {
+    TSC_SECONDS = MeasureTsc();
+    selected = Clock::Source::TSC;
+  }
+#endif
+  CLOCK_SOURCE.store(selected, std::memory_order_release);
+  return selected;
+}
+
+Clock::Source Clock::Current() {
+  return static_cast<Clock::Source>(
+      CLOCK_SOURCE.load(std::memory_order_acquire)
+  );
+}
+
+double Clock::Elapsed(std::uint64_t start, std::uint64_t end) {
+  double ticks = static_cast<double>(end - start);
+  if (end < start) {
+    ticks = -static_cast<double>(start - end);
+  }
+  if (Clock::Current() == Clock::Source::TSC) {
+    return ticks * TSC_SECONDS;
+  }
+  return ticks / 1e9;
+}
+
+std::uint64_t Clock::Now() {
+  switch (CLOCK_SOURCE.load(std::memory_order_relaxed)) {
+#ifdef PROMCLIENT_HAS_TSC
+    case Clock::Source::TSC:
+      return __rdtsc();
+#endif
+#ifdef CLOCK_MONOTONIC_COARSE
+    case Clock::Source::COARSE:
+      return CoarseNow();
+#endif
+    default:
+      return SteadyNow();
+  }
+}
+
+double Clock::WallTime() {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(now).count();
+}
@@ -0,0 +1,59 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/exception_tracking.h"
+
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <typeinfo>
+
+#if defined(__GLIBCXX__) || defined(_LIBCPPABI_VERSION)
+#include <cxxabi.h>
+#define PROMCLIENT_HAS_CXXABI 1
+#endif
+
+
+#ifdef PROMCLIENT_HAS_CXXABI
+//! Layout of the Itanium C++ ABI per-thread exception globals.
+/*!
+ * The structure is opaque in cxxabi.h but its layout is part of the ABI.
+ */
+struct ExceptionGlobals {
+  void* caught_exceptions;
+  unsigned int uncaught_exceptions;
+};
+#endif
+
+
+const std::type_info* promclient::internal::CurrentExceptionType() {
+#ifdef PROMCLIENT_HAS_CXXABI
+  return abi::__cxa_current_exception_type();
+#else
+  return nullptr;
+#endif
+}
+
+std::string promclient::internal::TypeName(const std::type_info& type) {
+#ifdef PROMCLIENT_HAS_CXXABI
+  int status = 0;
+  char* name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  if (status == 0 && name != nullptr) {
+    std::string demangled(name);
+    std::free(name);
+    return demangled;
+  }
+#endif
+  return type.name();
+}
+
+int promclient::internal::UncaughtExceptions() {
+#if defined(__cpp_lib_uncaught_exceptions)
+  return std::uncaught_exceptions();
+#elif defined(PROMCLIENT_HAS_CXXABI)
+  ExceptionGlobals* globals = reinterpret_cast<ExceptionGlobals*>(
+      abi::__cxa_get_globals()
+  );
+  return static_cast<int>(globals->uncaught_exceptions);
+#else
+  return std::uncaught_exception() ? 1 : 0;
+#endif
+}
@@ -0,0 +1,155 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/exemplar_slot.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+
+using promclient::Exemplar;
+using promclient::ExemplarRef;
+using promclient::InvalidExemplar;
+using promclient::internal::ExemplarSlot;
+
+
+const std::size_t ExemplarSlot::MAX_LABELS_LENGTH;
+const std::size_t ExemplarSlot::DATA_SIZE;
+const std::size_t ExemplarSlot::WORDS;
+
+
+static std::uint64_t DoubleBits(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double BitsDouble(std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+ExemplarSlot* ExemplarSlot::Install(std::atomic<ExemplarSlot*>* slot) {
+  ExemplarSlot* current = slot->load(std::memory_order_acquire);
+  if (current != nullptr) {
+    return current;
+  }
+
+  ExemplarSlot* created = new ExemplarSlot();
+  if (slot->compare_exchange_strong(
+        current, created, std::memory_order_acq_rel
+  )) {
+    return created;
+  }
+  delete created;
+  return current;
+}
+
+
+ExemplarSlot::ExemplarSlot()
+  : sequence_(0), size_(0), timestamp_(0), value_(0) {
+  for (std::size_t idx = 0; idx < WORDS; idx++) {
+    this->words_[idx].store(0, std::memory_order_relaxed);
+  }
+}
+
+bool ExemplarSlot::store(
+    const std::map<std::string, std::string>& labels,
+    double value, double timestamp
+) {
+  // Encode labels on the stack before touching the slot.
+  char buffer[DATA_SIZE];
+  std::size_t length = 0;
+  std::size_t size = 0;
+  for (const auto& pair : labels) {
+    length += pair.first.size() + pair.second.size();
+    std::size_t needed = size + 2 + pair.first.size() + pair.second.size();
+    if (length > MAX_LABELS_LENGTH || needed > DATA_SIZE) {
+      throw InvalidExemplar("Exemplar labels are too long");
+    }
+
+    buffer[size++] = static_cast<char>(pair.first.size());
+    std::memcpy(buffer + size, pair.first.data(), pair.first.size());
+    size += pair.first.size();
+    buffer[size++] = static_cast<char>(pair.second.size());
+    std::memcpy(buffer + size, pair.second.data(), pair.second.size());
+    size += pair.second.size();
+  }
+
+  // Acquire the sequence lock or give up if another store holds it.
+  std::uint64_t sequence = this->sequence_.load(std::memory_order_relaxed);
+  if ((sequence & 1) || !this->sequence_.compare_exchange_strong(
+        sequence, sequence + 1, std::memory_order_relaxed
+  )) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::size_t words = (size + 7) / 8;
+  for (std::size_t idx = 0; idx < words; idx++) {
+    std::uint64_t word = 0;
+    std::size_t chunk = size - idx * 8 < 8 ? size - idx * 8 : 8;
+    std::memcpy(&word, buffer + idx * 8, chunk);
+    this->words_[idx].store(word, std::memory_order_relaxed);
+  }
+  this->size_.store(size, std::memory_order_relaxed);
+  this->timestamp_.store(DoubleBits(timestamp), std::memory_order_relaxed);
+  this->value_.store(DoubleBits(value), std::memory_order_relaxed);
+  this->sequence_.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+ExemplarRef ExemplarSlot::load() const {
+  char buffer[DATA_SIZE];
+  std::size_t size;
+  std::uint64_t timestamp;
+  std::uint64_t value;
+
+  while (true) {
+    std::uint64_t sequence = this->sequence_.load(std::memory_order_acquire);
+    if (sequence == 0) {
+      return nullptr;
+    }
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    size = this->size_.load(std::memory_order_relaxed);
+    size = size > DATA_SIZE ? DATA_SIZE : size;
+    timestamp = this->timestamp_.load(std::memory_order_relaxed);
+    value = this->value_.load(std::memory_order_relaxed);
+    for (std::size_t idx = 0; idx < (size + 7) / 8; idx++) {
+      std::uint64_t word = this->words_[idx].load(std::memory_order_relaxed);
+      std::memcpy(buffer + idx * 8, &word, 8);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->sequence_.load(std::memory_order_relaxed) == sequence) {
+      break;
+    }
+  }
+
+  // Decode labels from the consistent copy.
+  std::map<std::string, std::string> labels;
+  std::size_t offset = 0;
+  while (offset < size) {
+    std::size_t name_size = static_cast<unsigned char>(buffer[offset++]);
+    std::string name(buffer + offset, name_size);
+    offset += name_size;
+    std::size_t value_size = static_cast<unsigned char>(buffer[offset++]);
+    labels[name] = std::string(buffer + offset, value_size);
+    offset += value_size;
+  }
+  return std::make_shared<Exemplar>(
+      std::move(labels), BitsDouble(value), BitsDouble(timestamp)
+  );
+}
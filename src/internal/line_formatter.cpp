@@ -0,0 +1,201 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/line_formatter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+#include "promclient/internal/clock.h"
+#include "promclient/internal/registry_metrics.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::DescriptorRef;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::Clock;
+using promclient::internal::LineFormatBridge;
+using promclient::internal::LineFormatter;
+using promclient::internal::ScrapeTimer;
+
+
+//! Formats a value with the fewest digits that read back the same.
+static std::string FormatValue(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+  if (std::strtod(buffer, nullptr) != value) {
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+  }
+  return buffer;
+}
+
+//! Returns value with the `reserved` characters replaced by `_`.
+static std::string Replace(std::string value, const char* reserved) {
+  for (std::size_t pos = value.find_first_of(reserved);
+       pos != std::string::npos;
+       pos = value.find_first_of(reserved, pos + 1)) {
+    value[pos] = '_';
+  }
+  return value;
+}
+
+//! Returns value with the `reserved` characters escaped by a backslash.
+static std::string Escape(const std::string& value, const char* reserved) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\n') {
+      c = '_';
+    } else if (std::strchr(reserved, c) != nullptr) {
+      escaped.push_back('\\');
+    }
+    escaped.push_back(c);
+  }
+  return escaped;
+}
+
+
+LineFormatBridge::LineFormatBridge(
+    CollectorRegistry* registry, LineFormatter::Protocol protocol
+) : formatter(protocol) {
+  this->registry_ = registry;
+  this->strategy_ = CollectorRegistry::CollectStrategy::SORTED;
+}
+
+void LineFormatBridge::collect() {
+  static const char* const FORMATS[] = {"statsd", "graphite", "influx"};
+  ScrapeTimer timer(this->registry_, FORMATS[this->formatter.protocol()]);
+  this->formatter.discard();
+  MetricsList metrics = this->registry_->collect(this->strategy_);
+  std::int64_t timestamp = static_cast<std::int64_t>(Clock::WallTime() * 1000);
+  timer.collected();
+
+  for (const auto& metric : metrics) {
+    for (const auto& sample : metric.samples()) {
+      std::string line = this->formatter.line(
+          metric.descriptor(), sample, timestamp
+      );
+      if (line != "") {
+        timer.writing();
+        this->write(line);
+        timer.written(line.size());
+      }
+    }
+  }
+  timer.done();
+}
+
+void LineFormatBridge::commit() {
+  this->formatter.commit();
+}
+
+
+LineFormatter::LineFormatter(LineFormatter::Protocol protocol) {
+  this->protocol_ = protocol;
+}
+
+std::string LineFormatter::line(
+    const DescriptorRef& descriptor, const Sample& sample,
+    std::int64_t timestamp
+) {
+  if (!std::isfinite(sample.value())) {
+    return "";
+  }
+  std::string name = descriptor->name();
+  if (sample.role() != "") {
+    name += "_" + sample.role();
+  }
+
+  switch (this->protocol_) {
+    case LineFormatter::Protocol::GRAPHITE:
+      return this->graphite(name, sample, timestamp);
+    case LineFormatter::Protocol::INFLUX:
+      return this->influx(name, sample, timestamp);
+    default:
+      return this->statsd(name, descriptor->type(), sample);
+  }
+}
+
+void LineFormatter::commit() {
+  this->counters_.swap(this->pending_);
+  this->pending_.clear();
+}
+
+void LineFormatter::discard() {
+  this->pending_.clear();
+}
+
+LineFormatter::Protocol LineFormatter::protocol() const {
+  return this->protocol_;
+}
+
+
+std::string LineFormatter::graphite(
+    const std::string& name, const Sample& sample, std::int64_t timestamp
+) {
+  std::string line = Replace(name, " ;");
+  for (const auto& label : sample.labels()) {
+    // Tags can't have empty values or values starting with `~`.
+    if (label.second == "") {
+      continue;
+    }
+    std::string value = Replace(label.second, " ;\n");
+    if (value[0] == '~') {
+      value[0] = '_';
+    }
+    line += ";" + label.first + "=" + value;
+  }
+  line += " " + FormatValue(sample.value());
+  line += " " + std::to_string(timestamp / 1000) + "\n";
+  return line;
+}
+
+std::string LineFormatter::influx(
+    const std::string& name, const Sample& sample, std::int64_t timestamp
+) {
+  std::string line = Escape(name, ", ");
+  for (const auto& label : sample.labels()) {
+    // Tags with empty values are not allowed.
+    if (label.second != "") {
+      line += "," + label.first + "=" + Escape(label.second, ",= ");
+    }
+  }
+  line += " value=" + FormatValue(sample.value());
+  line += " " + std::to_string(timestamp) + "000000\n";
+  return line;
+}
+
+std::string LineFormatter::statsd(
+    const std::string& name, const std::string& type, const Sample& sample
+) {
+  std::string tags;
+  for (const auto& label : sample.labels()) {
+    tags += tags == "" ? "|#" : ",";
+    tags += label.first + ":" + Replace(label.second, "|,#\n");
+  }
+  std::string prefix = Replace(name, ":|@#") + ":";
+  double value = sample.value();
+
+  if (type == "counter" && sample.role() == "") {
+    // Send increments, or the whole value after a counter reset.
+    std::string series = prefix + tags;
+    auto committed = this->counters_.find(series);
+    double last = committed != this->counters_.end() ? committed->second : 0;
+    double increment = value >= last ? value - last : value;
+    this->pending_[series] = value;
+    return prefix + FormatValue(increment) + "|c" + tags + "\n";
+  }
+
+  // Signed gauge values are changes, negative gauges are set from 0.
+  std::string line;
+  if (value < 0) {
+    line = prefix + "0|g" + tags + "\n";
+  }
+  return line + prefix + FormatValue(value) + "|g" + tags + "\n";
+}
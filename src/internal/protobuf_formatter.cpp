@@ -0,0 +1,361 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/protobuf_formatter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_writer.h"
+#include "promclient/internal/registry_metrics.h"
+#include "promclient/internal/utils.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::DescriptorRef;
+using promclient::ExemplarRef;
+using promclient::Metric;
+using promclient::NativeBucketsRef;
+using promclient::Sample;
+
+using promclient::internal::MediaRange;
+using promclient::internal::ProtobufFormatBridge;
+using promclient::internal::ProtobufFormatter;
+using promclient::internal::ProtobufWriter;
+using promclient::internal::ScrapeTimer;
+
+using promclient::internal::ParseAccept;
+
+
+typedef std::map<std::string, std::string> Labels;
+
+//! MetricType values of MetricFamily messages.
+enum MetricType {
+  COUNTER = 0,
+  GAUGE = 1,
+  SUMMARY = 2,
+  UNTYPED = 3,
+  HISTOGRAM = 4
+};
+
+//! Samples of a summary or histogram with the same labels.
+struct SampleGroup {
+  Labels labels;
+  std::vector<const Sample*> samples;
+};
+
+
+//! Returns the MetricType of a descriptor type.
+static MetricType TypeOf(const std::string& type) {
+  if (type == "counter") {
+    return MetricType::COUNTER;
+  } else if (type == "gauge") {
+    return MetricType::GAUGE;
+  } else if (type == "summary") {
+    return MetricType::SUMMARY;
+  } else if (type == "histogram") {
+    return MetricType::HISTOGRAM;
+  }
+  return MetricType::UNTYPED;
+}
+
+//! Returns a non-negative double as an integer count.
+static std::uint64_t CountOf(double value) {
+  return value > 0 ? static_cast<std::uint64_t>(value) : 0;
+}
+
+//! Writes repeated LabelPair messages.
+static void WriteLabels(
+    ProtobufWriter* message, int field, const Labels& labels
+) {
+  for (const auto& pair : labels) {
+    ProtobufWriter label;
+    label.stringField(1, pair.first);
+    label.stringField(2, pair.second);
+    message->message(field, label);
+  }
+}
+
+//! Writes an Exemplar message.
+static void WriteExemplar(
+    ProtobufWriter* message, int field, const ExemplarRef& exemplar
+) {
+  double whole;
+  double fraction = std::modf(exemplar->timestamp(), &whole);
+  ProtobufWriter timestamp;
+  timestamp.intField(1, static_cast<std::int64_t>(whole));
+  timestamp.intField(2, static_cast<std::int32_t>(fraction * 1e9));
+
+  ProtobufWriter encoded;
+  WriteLabels(&encoded, 1, exemplar->labels());
+  encoded.doubleField(2, exemplar->value());
+  encoded.message(3, timestamp);
+  message->message(field, encoded);
+}
+
+//! Writes BucketSpan messages and count deltas for native buckets.
+static void WriteNativeBuckets(
+    ProtobufWriter* histogram, int span_field, int delta_field,
+    const std::map<int, std::uint64_t>& buckets
+) {
+  // Consecutive buckets share a span, spans start relative to the last.
+  std::vector<std::pair<int, std::uint32_t>> spans;
+  int last = 0;
+  for (const auto& bucket : buckets) {
+    if (spans.size() == 0) {
+      spans.push_back(std::make_pair(bucket.first, 0));
+    } else if (bucket.first != last + 1) {
+      spans.push_back(std::make_pair(bucket.first - last - 1, 0));
+    }
+    spans.back().second += 1;
+    last = bucket.first;
+  }
+
+  for (const auto& span : spans) {
+    ProtobufWriter encoded;
+    encoded.sintField(1, span.first);
+    encoded.intField(2, span.second);
+    histogram->message(span_field, encoded);
+  }
+
+  // Counts are deltas from the previous bucket.
+  std::int64_t previous = 0;
+  for (const auto& bucket : buckets) {
+    std::int64_t count = static_cast<std::int64_t>(bucket.second);
+    histogram->sintField(delta_field, count - previous);
+    previous = count;
+  }
+}
+
+//! Writes a Histogram message for a group of histogram samples.
+static void WriteHistogram(ProtobufWriter* metric, const SampleGroup& group) {
+  std::uint64_t count = 0;
+  double sum = 0;
+  NativeBucketsRef native;
+  std::vector<std::pair<double, const Sample*>> buckets;
+
+  for (const Sample* sample : group.samples) {
+    if (sample->role() == "count") {
+      count = CountOf(sample->value());
+    } else if (sample->role() == "sum") {
+      sum = sample->value();
+    } else if (sample->role() == "bucket") {
+      auto le = sample->labels().find("le");
+      if (le != sample->labels().end()) {
+        double bound = std::strtod(le->second.c_str(), nullptr);
+        buckets.push_back(std::make_pair(bound, sample));
+      }
+    }
+    if (sample->native()) {
+      native = sample->native();
+    }
+  }
+
+  ProtobufWriter histogram;
+  histogram.intField(1, count);
+  histogram.doubleField(2, sum);
+
+  // Bucket labels sort as strings, bounds must be in numeric order.
+  std::stable_sort(
+      buckets.begin(), buckets.end(),
+      [](const std::pair<double, const Sample*>& lhs,
+         const std::pair<double, const Sample*>& rhs) {
+        return lhs.first < rhs.first;
+      }
+  );
+  for (const auto& bucket : buckets) {
+    ProtobufWriter encoded;
+    encoded.intField(1, CountOf(bucket.second->value()));
+    encoded.doubleField(2, bucket.first);
+    if (bucket.second->exemplar()) {
+      WriteExemplar(&encoded, 3, bucket.second->exemplar());
+    }
+    histogram.message(3, encoded);
+  }
+
+  if (native) {
+    histogram.sintField(5, native->schema());
+    histogram.doubleField(6, native->zeroThreshold());
+    histogram.intField(7, native->zeroCount());
+    WriteNativeBuckets(&histogram, 9, 10, native->negative());
+    WriteNativeBuckets(&histogram, 12, 13, native->positive());
+
+    // An empty span marks histograms without observations as native.
+    bool empty = native->negative().size() == 0 &&
+      native->positive().size() == 0;
+    if (empty && native->zeroThreshold() == 0 && native->zeroCount() == 0) {
+      ProtobufWriter span;
+      span.sintField(1, 0);
+      span.intField(2, 0);
+      histogram.message(12, span);
+    }
+
+    for (const auto& bucket : buckets) {
+      if (bucket.second->exemplar()) {
+        WriteExemplar(&histogram, 16, bucket.second->exemplar());
+      }
+    }
+  }
+  metric->message(7, histogram);
+}
+
+//! Writes a Summary message for a group of summary samples.
+static void WriteSummary(ProtobufWriter* metric, const SampleGroup& group) {
+  ProtobufWriter summary;
+  for (const Sample* sample : group.samples) {
+    auto quantile = sample->labels().find("quantile");
+    if (sample->role() == "count") {
+      summary.intField(1, CountOf(sample->value()));
+    } else if (sample->role() == "sum") {
+      summary.doubleField(2, sample->value());
+    } else if (quantile != sample->labels().end()) {
+      ProtobufWriter encoded;
+      encoded.doubleField(1, std::strtod(quantile->second.c_str(), nullptr));
+      encoded.doubleField(2, sample->value());
+      summary.message(3, encoded);
+    }
+  }
+  metric->message(4, summary);
+}
+
+
+const char* const ProtobufFormatter::CONTENT_TYPE =
+  "application/vnd.google.protobuf; "
+  "proto=io.prometheus.client.MetricFamily; encoding=delimited";
+
+bool ProtobufFormatter::Accepts(const std::string& accept) {
+  double protobuf = 0;
+  double text = 0;
+  for (const MediaRange& range : ParseAccept(accept)) {
+    const std::string& type = range.type;
+    if (type == "application/vnd.google.protobuf") {
+      auto proto = range.params.find("proto");
+      auto encoding = range.params.find("encoding");
+      bool family = proto != range.params.end() &&
+        proto->second == "io.prometheus.client.MetricFamily";
+      bool delimited = encoding != range.params.end() &&
+        encoding->second == "delimited";
+      if (family && delimited) {
+        protobuf = std::max(protobuf, range.quality);
+      }
+    } else if (
+        type == "application/openmetrics-text" || type == "text/plain" ||
+        type == "text/*" || type == "*/*"
+    ) {
+      text = std::max(text, range.quality);
+    }
+  }
+  return protobuf > 0 && protobuf >= text;
+}
+
+
+std::string ProtobufFormatter::family(const Metric& metric) {
+  const DescriptorRef& descriptor = metric.descriptor();
+  MetricType type = TypeOf(descriptor->type());
+  this->family_.clear();
+  this->family_.stringField(1, descriptor->name());
+  if (descriptor->help() != "") {
+    this->family_.stringField(2, descriptor->help());
+  }
+  this->family_.intField(3, type);
+
+  // Summaries and histograms have one message for all samples
+  // with the same labels (other then the quantile or bucket).
+  std::vector<SampleGroup> groups;
+  std::map<Labels, std::size_t> group_index;
+  bool grouped = type == MetricType::SUMMARY || type == MetricType::HISTOGRAM;
+  for (const Sample& sample : metric.samples()) {
+    Labels labels = sample.labels();
+    if (!grouped) {
+      groups.push_back(SampleGroup{std::move(labels), {&sample}});
+      continue;
+    }
+
+    labels.erase(type == MetricType::SUMMARY ? "quantile" : "le");
+    auto index = group_index.find(labels);
+    if (index == group_index.end()) {
+      group_index[labels] = groups.size();
+      groups.push_back(SampleGroup{std::move(labels), {&sample}});
+    } else {
+      groups[index->second].samples.push_back(&sample);
+    }
+  }
+
+  for (const SampleGroup& group : groups) {
+    this->metric_.clear();
+    WriteLabels(&this->metric_, 1, group.labels);
+
+    const Sample* sample = group.samples[0];
+    ProtobufWriter value;
+    switch (type) {
+      case MetricType::COUNTER:
+        value.doubleField(1, sample->value());
+        if (sample->exemplar()) {
+          WriteExemplar(&value, 2, sample->exemplar());
+        }
+        this->metric_.message(3, value);
+        break;
+
+      case MetricType::GAUGE:
+        value.doubleField(1, sample->value());
+        this->metric_.message(2, value);
+        break;
+
+      case MetricType::SUMMARY:
+        WriteSummary(&this->metric_, group);
+        break;
+
+      case MetricType::HISTOGRAM:
+        WriteHistogram(&this->metric_, group);
+        break;
+
+      default:
+        value.doubleField(1, sample->value());
+        this->metric_.message(5, value);
+    }
+    this->family_.message(4, this->metric_);
+  }
+
+  // Families are delimited by their length.
+  ProtobufWriter delimited;
+  delimited.varint(this->family_.buffer().size());
+  return delimited.buffer() + this->family_.buffer();
+}
+
+
+ProtobufFormatBridge::ProtobufFormatBridge(CollectorRegistry* registry) {
+  this->registry_ = registry;
+  this->strategy_ = CollectorRegistry::CollectStrategy::SORTED;
+}
+
+void ProtobufFormatBridge::collect() {
+  ScrapeTimer timer(this->registry_, "protobuf");
+  MetricsList metrics = this->names_.size() == 0 ?
+    this->registry_->collect(this->strategy_) :
+    this->registry_->collect(this->names_, this->strategy_);
+  timer.collected();
+
+  for (const auto& metric : metrics) {
+    std::string family = this->formatter.family(metric);
+    this->starting(metric.descriptor());
+    timer.writing();
+    this->write(family);
+    timer.written(family.size());
+  }
+  timer.done();
+}
+
+void ProtobufFormatBridge::filter(std::set<std::string> names) {
+  this->names_ = std::move(names);
+}
+
+void ProtobufFormatBridge::starting(const DescriptorRef& descriptor) {
+  // Noop.
+}
@@ -0,0 +1,67 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/protobuf_writer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using promclient::internal::ProtobufWriter;
+
+
+std::uint64_t ProtobufWriter::ZigZag(std::int64_t value) {
+  std::uint64_t bits = static_cast<std::uint64_t>(value);
+  return (bits << 1) ^ (value < 0 ? ~std::uint64_t(0) : 0);
+}
+
+
+const std::string& ProtobufWriter::buffer() const {
+  return this->buffer_;
+}
+
+void ProtobufWriter::clear() {
+  this->buffer_.clear();
+}
+
+void ProtobufWriter::doubleField(int field, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  this->tag(field, WireType::FIXED64);
+
+  // Fixed size values are little endian.
+  char bytes[8];
+  for (int idx = 0; idx < 8; idx++) {
+    bytes[idx] = static_cast<char>(bits >> (idx * 8));
+  }
+  this->buffer_.append(bytes, 8);
+}
+
+void ProtobufWriter::intField(int field, std::uint64_t value) {
+  this->tag(field, WireType::VARINT);
+  this->varint(value);
+}
+
+void ProtobufWriter::message(int field, const ProtobufWriter& message) {
+  this->stringField(field, message.buffer());
+}
+
+void ProtobufWriter::sintField(int field, std::int64_t value) {
+  this->intField(field, ProtobufWriter::ZigZag(value));
+}
+
+void ProtobufWriter::stringField(int field, const std::string& value) {
+  this->tag(field, WireType::LENGTH);
+  this->varint(value.size());
+  this->buffer_.append(value);
+}
+
+void ProtobufWriter::tag(int field, ProtobufWriter::WireType type) {
+  this->varint((static_cast<std::uint64_t>(field) << 3) | type);
+}
+
+void ProtobufWriter::varint(std::uint64_t value) {
+  while (value >= 0x80) {
+    this->buffer_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  this->buffer_.push_back(static_cast<char>(value));
+}
@@ -0,0 +1,231 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/registry_metrics.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+#include "promclient/internal/clock.h"
+
+using promclient::CollectorRef;
+using promclient::CollectorRegistry;
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::LabelledCache;
+using promclient::LabelledCacheStats;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::Clock;
+using promclient::internal::RegistryMetrics;
+using promclient::internal::ScrapeTimer;
+
+
+bool RegistryMetrics::PerScrape(const std::string& name) {
+  return name == "promclient_collector_duration_seconds" ||
+    name == "promclient_scrape_bytes" ||
+    name == "promclient_scrape_duration_seconds" ||
+    name == "promclient_scrape_series" ||
+    name == "promclient_scrapes_total";
+}
+
+
+RegistryMetrics::RegistryMetrics(CollectorRegistry* registry) {
+  this->registry_ = registry;
+  this->bytes_ = 0;
+  this->series_ = 0;
+
+  this->collector_duration_ = DescriptorRef(new Descriptor(
+      "promclient_collector_duration_seconds", "gauge",
+      "Duration of the latest collection of each collector", {"collector"}
+  ));
+  this->labelled_children_ = DescriptorRef(new Descriptor(
+      "promclient_labelled_children", "gauge",
+      "Children cached by labelled collectors", {"metric"}
+  ));
+  this->labelled_lookups_ = DescriptorRef(new Descriptor(
+      "promclient_labelled_lookups_total", "counter",
+      "Children lookups by labelled collectors", {"metric", "result"}
+  ));
+  this->scrape_bytes_ = DescriptorRef(new Descriptor(
+      "promclient_scrape_bytes", "gauge",
+      "Bytes exposed by the latest scrape", {}
+  ));
+  this->scrape_duration_ = DescriptorRef(new Descriptor(
+      "promclient_scrape_duration_seconds", "gauge",
+      "Duration of each phase of the latest scrape", {"phase"}
+  ));
+  this->scrape_series_ = DescriptorRef(new Descriptor(
+      "promclient_scrape_series", "gauge",
+      "Series collected by the latest collection", {}
+  ));
+  this->scrapes_ = DescriptorRef(new Descriptor(
+      "promclient_scrapes_total", "counter",
+      "Scrapes by exposition format", {"format"}
+  ));
+}
+
+MetricsList RegistryMetrics::collect() {
+  // Cache stats are read outside our lock to avoid lock nesting.
+  std::vector<Sample> children;
+  std::vector<Sample> lookups;
+  for (const CollectorRef& collector : *this->registry_->snapshot()) {
+    LabelledCache* cache = dynamic_cast<LabelledCache*>(collector.get());
+    if (cache == nullptr) {
+      continue;
+    }
+    LabelledCacheStats stats = cache->cacheStats();
+    children.emplace_back(
+        "", stats.children, std::map<std::string, std::string>({
+          {"metric", stats.name}
+        })
+    );
+    lookups.emplace_back(
+        "", stats.hits, std::map<std::string, std::string>({
+          {"metric", stats.name}, {"result", "hit"}
+        })
+    );
+    lookups.emplace_back(
+        "", stats.misses, std::map<std::string, std::string>({
+          {"metric", stats.name}, {"result", "miss"}
+        })
+    );
+  }
+
+  std::vector<Sample> durations;
+  std::vector<Sample> phases;
+  std::vector<Sample> scrapes;
+  std::lock_guard<std::mutex> lock(this->lock_);
+  for (const auto& pair : this->collector_durations_) {
+    durations.emplace_back(
+        "", pair.second, std::map<std::string, std::string>({
+          {"collector", pair.first}
+        })
+    );
+  }
+  for (const auto& pair : this->phases_) {
+    phases.emplace_back(
+        "", pair.second, std::map<std::string, std::string>({
+          {"phase", pair.first}
+        })
+    );
+  }
+  for (const auto& pair : this->scrapes_by_format_) {
+    scrapes.emplace_back(
+        "", pair.second, std::map<std::string, std::string>({
+          {"format", pair.first}
+        })
+    );
+  }
+
+  MetricsList metrics;
+  metrics.emplace_back(this->collector_duration_, std::move(durations));
+  metrics.emplace_back(this->labelled_children_, std::move(children));
+  metrics.emplace_back(this->labelled_lookups_, std::move(lookups));
+  metrics.emplace_back(this->scrape_bytes_, std::vector<Sample>({
+      Sample("", this->bytes_, {})
+  }));
+  metrics.emplace_back(this->scrape_duration_, std::move(phases));
+  metrics.emplace_back(this->scrape_series_, std::vector<Sample>({
+      Sample("", this->series_, {})
+  }));
+  metrics.emplace_back(this->scrapes_, std::move(scrapes));
+  return metrics;
+}
+
+DescriptorsList RegistryMetrics::describe() {
+  return DescriptorsList({
+      this->collector_duration_, this->labelled_children_,
+      this->labelled_lookups_, this->scrape_bytes_,
+      this->scrape_duration_, this->scrape_series_, this->scrapes_
+  });
+}
+
+void RegistryMetrics::collected(
+    const std::vector<CollectorRef>& collectors,
+    const std::vector<MetricsList>& metrics,
+    const std::vector<double>& durations, bool full
+) {
+  std::uint64_t series = 0;
+  for (const MetricsList& list : metrics) {
+    for (const Metric& metric : list) {
+      series += metric.samples().size();
+    }
+  }
+
+  // Described names are stable, unlike the first metric collected.
+  std::map<std::string, double> collector_durations;
+  if (full) {
+    for (std::size_t idx = 0; idx < collectors.size(); idx++) {
+      DescriptorsList descriptors = collectors[idx]->describe();
+      if (descriptors.size() != 0) {
+        collector_durations[descriptors[0]->name()] += durations[idx];
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(this->lock_);
+  if (full) {
+    this->collector_durations_.swap(collector_durations);
+  }
+  this->series_ = series;
+}
+
+void RegistryMetrics::scraped(
+    const std::string& format, double collect, double formatting,
+    double write, std::uint64_t bytes
+) {
+  std::lock_guard<std::mutex> lock(this->lock_);
+  this->bytes_ = bytes;
+  this->phases_["collect"] = collect;
+  this->phases_["format"] = formatting;
+  this->phases_["write"] = write;
+  this->scrapes_by_format_[format] += 1;
+}
+
+
+ScrapeTimer::ScrapeTimer(CollectorRegistry* registry, const char* format) {
+  this->metrics_ = registry->instrumentation();
+  this->format_ = format;
+  this->bytes_ = 0;
+  this->collect_ = 0;
+  this->write_ = 0;
+  this->write_start_ = 0;
+  this->start_ = this->metrics_ ? Clock::Now() : 0;
+}
+
+void ScrapeTimer::collected() {
+  if (this->metrics_) {
+    this->collect_ = Clock::Elapsed(this->start_, Clock::Now());
+  }
+}
+
+void ScrapeTimer::done() {
+  if (this->metrics_) {
+    double total = Clock::Elapsed(this->start_, Clock::Now());
+    double formatting = total - this->collect_ - this->write_;
+    this->metrics_->scraped(
+        this->format_, this->collect_, formatting, this->write_, this->bytes_
+    );
+  }
+}
+
+void ScrapeTimer::writing() {
+  if (this->metrics_) {
+    this->write_start_ = Clock::Now();
+  }
+}
+
+void ScrapeTimer::written(std::size_t bytes) {
+  if (this->metrics_) {
+    this->write_ += Clock::Elapsed(this->write_start_, Clock::Now());
+    this->bytes_ += bytes;
+  }
+}
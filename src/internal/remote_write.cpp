@@ -0,0 +1,67 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/remote_write.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_writer.h"
+
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::ProtobufWriter;
+using promclient::internal::RemoteSeries;
+using promclient::internal::RemoteSeriesList;
+
+
+RemoteSeriesList promclient::internal::RemoteSeriesOf(
+    const MetricsList& metrics, std::int64_t timestamp
+) {
+  RemoteSeriesList series;
+  for (const auto& metric : metrics) {
+    const std::string& name = metric.descriptor()->name();
+    for (const Sample& sample : metric.samples()) {
+      // Labels must be sorted by name, `__name__` included.
+      std::map<std::string, std::string> labels = sample.labels();
+      labels["__name__"] = name;
+      if (sample.role() != "") {
+        labels["__name__"] += "_" + sample.role();
+      }
+
+      RemoteSeries remote;
+      remote.labels.assign(labels.begin(), labels.end());
+      remote.value = sample.value();
+      remote.timestamp = timestamp;
+      series.push_back(std::move(remote));
+    }
+  }
+  return series;
+}
+
+void promclient::internal::EncodeWriteRequest(
+    const RemoteSeriesList& series, ProtobufWriter* request
+) {
+  ProtobufWriter timeseries;
+  ProtobufWriter label;
+  ProtobufWriter sample;
+  request->clear();
+
+  for (const RemoteSeries& remote : series) {
+    timeseries.clear();
+    for (const auto& pair : remote.labels) {
+      label.clear();
+      label.stringField(1, pair.first);
+      label.stringField(2, pair.second);
+      timeseries.message(1, label);
+    }
+
+    sample.clear();
+    sample.doubleField(1, remote.value);
+    sample.intField(2, static_cast<std::uint64_t>(remote.timestamp));
+    timeseries.message(2, sample);
+    request->message(1, timeseries);
+  }
+}
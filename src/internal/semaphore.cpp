@@ -0,0 +1,40 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/semaphore.h"
+
+#include <chrono>
+#include <mutex>
+
+using promclient::internal::Semaphore;
+
+
+Semaphore::Semaphore(std::size_t permits) {
+  this->available_ = permits;
+  this->permits_ = permits;
+}
+
+bool Semaphore::acquire(std::chrono::milliseconds timeout) {
+  if (this->permits_ == 0) {
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(this->lock_);
+  bool acquired = this->released_.wait_for(lock, timeout, [this]() {
+    return this->available_ > 0;
+  });
+  if (acquired) {
+    this->available_ -= 1;
+  }
+  return acquired;
+}
+
+void Semaphore::release() {
+  if (this->permits_ == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->available_ += 1;
+  }
+  this->released_.notify_one();
+}
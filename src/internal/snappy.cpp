@@ -0,0 +1,240 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/snappy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+//! Input is compressed in blocks so offsets fit in two bytes.
+static const std::size_t BLOCK_SIZE = 1 << 16;
+
+//! Number of entries in the table of recently seen positions.
+static const int HASH_BITS = 14;
+
+//! Tag types of snappy elements.
+enum ElementType {
+  LITERAL = 0,
+  COPY_1 = 1,
+  COPY_2 = 2,
+  COPY_4 = 3
+};
+
+
+//! Reads four bytes at a position.
+static std::uint32_t Load32(const char* data) {
+  std::uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+//! Hashes four bytes into a table index.
+static std::uint32_t Hash(std::uint32_t bytes) {
+  return (bytes * 0x1E35A7BD) >> (32 - HASH_BITS);
+}
+
+//! Emits the uncompressed length preamble.
+static void EmitVarint(std::string* output, std::uint64_t value) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+//! Emits bytes that are not compressed.
+static void EmitLiteral(
+    std::string* output, const char* data, std::size_t size
+) {
+  std::size_t n = size - 1;
+  if (n < 60) {
+    output->push_back(static_cast<char>(n << 2 | ElementType::LITERAL));
+  } else {
+    // Longer lengths follow the tag in 1 to 4 little endian bytes.
+    int bytes = 0;
+    for (std::size_t rest = n; rest > 0; rest >>= 8) {
+      bytes += 1;
+    }
+    output->push_back(static_cast<char>((59 + bytes) << 2));
+    for (int idx = 0; idx < bytes; idx++) {
+      output->push_back(static_cast<char>(n >> (idx * 8)));
+    }
+  }
+  output->append(data, size);
+}
+
+//! Emits a copy of at most 64 bytes.
+static void EmitShortCopy(
+    std::string* output, std::size_t offset, std::size_t length
+) {
+  if (length < 12 && offset < 2048) {
+    output->push_back(static_cast<char>(
+        ElementType::COPY_1 | ((length - 4) << 2) | ((offset >> 8) << 5)
+    ));
+    output->push_back(static_cast<char>(offset));
+  } else {
+    output->push_back(static_cast<char>(
+        ElementType::COPY_2 | ((length - 1) << 2)
+    ));
+    output->push_back(static_cast<char>(offset));
+    output->push_back(static_cast<char>(offset >> 8));
+  }
+}
+
+//! Emits a copy of earlier output.
+static void EmitCopy(
+    std::string* output, std::size_t offset, std::size_t length
+) {
+  // Split long copies without leaving a copy shorter then 4 bytes.
+  while (length >= 68) {
+    EmitShortCopy(output, offset, 64);
+    length -= 64;
+  }
+  if (length > 64) {
+    EmitShortCopy(output, offset, 60);
+    length -= 60;
+  }
+  EmitShortCopy(output, offset, length);
+}
+
+//! Compresses a block of at most BLOCK_SIZE bytes.
+static void CompressBlock(
+    const char* block, std::size_t size, std::string* output
+) {
+  std::uint16_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  std::size_t literal = 0;
+  std::size_t pos = 1;
+  std::size_t skip = 32;
+  while (size >= 4 && pos + 4 <= size) {
+    std::uint32_t bytes = Load32(block + pos);
+    std::uint32_t hash = Hash(bytes);
+    std::size_t candidate = table[hash];
+    table[hash] = static_cast<std::uint16_t>(pos);
+    if (candidate >= pos || Load32(block + candidate) != bytes) {
+      // Step faster through data that does not compress.
+      pos += skip++ >> 5;
+      continue;
+    }
+
+    if (literal < pos) {
+      EmitLiteral(output, block + literal, pos - literal);
+    }
+    std::size_t length = 4;
+    while (pos + length < size &&
+        block[candidate + length] == block[pos + length]) {
+      length += 1;
+    }
+    EmitCopy(output, pos - candidate, length);
+    pos += length;
+    literal = pos;
+    skip = 32;
+  }
+
+  if (literal < size) {
+    EmitLiteral(output, block + literal, size - literal);
+  }
+}
+
+
+void promclient::internal::SnappyCompress(
+    const std::string& input, std::string* output
+) {
+  output->clear();
+  EmitVarint(output, input.size());
+  for (std::size_t start = 0; start < input.size(); start += BLOCK_SIZE) {
+    std::size_t size = std::min(BLOCK_SIZE, input.size() - start);
+    CompressBlock(input.data() + start, size, output);
+  }
+}
+
+std::string promclient::internal::SnappyUncompress(const std::string& input) {
+  const unsigned char* data =
+    reinterpret_cast<const unsigned char*>(input.data());
+  std::size_t size = input.size();
+  std::size_t pos = 0;
+
+  // Uncompressed length.
+  std::uint64_t length = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (pos >= size || shift > 63) {
+      throw std::runtime_error("Invalid snappy length");
+    }
+    length |= static_cast<std::uint64_t>(data[pos] & 0x7F) << shift;
+    if ((data[pos++] & 0x80) == 0) {
+      break;
+    }
+  }
+
+  std::string output;
+  output.reserve(length);
+  while (pos < size) {
+    unsigned char tag = data[pos++];
+    std::size_t element = tag >> 2;
+    std::size_t offset = 0;
+    std::size_t extra = 0;
+
+    switch (tag & 0x03) {
+      case ElementType::LITERAL:
+        if (element >= 60) {
+          extra = element - 59;
+          if (pos + extra > size) {
+            throw std::runtime_error("Invalid snappy literal");
+          }
+          element = 0;
+          for (std::size_t idx = 0; idx < extra; idx++) {
+            element |= static_cast<std::size_t>(data[pos++]) << (idx * 8);
+          }
+        }
+        element += 1;
+        if (pos + element > size || output.size() + element > length) {
+          throw std::runtime_error("Invalid snappy literal");
+        }
+        output.append(input, pos, element);
+        pos += element;
+        continue;
+
+      case ElementType::COPY_1:
+        extra = 1;
+        element = 4 + (element & 0x07);
+        break;
+
+      case ElementType::COPY_2:
+        extra = 2;
+        element += 1;
+        break;
+
+      default:
+        extra = 4;
+        element += 1;
+    }
+
+    if (pos + extra > size) {
+      throw std::runtime_error("Invalid snappy copy");
+    }
+    for (std::size_t idx = 0; idx < extra; idx++) {
+      offset |= static_cast<std::size_t>(data[pos++]) << (idx * 8);
+    }
+    if ((tag & 0x03) == ElementType::COPY_1) {
+      offset |= static_cast<std::size_t>(tag >> 5) << 8;
+    }
+    if (offset == 0 || offset > output.size() ||
+        output.size() + element > length) {
+      throw std::runtime_error("Invalid snappy copy");
+    }
+
+    // Copies can overlap the bytes they produce.
+    std::size_t from = output.size() - offset;
+    for (std::size_t idx = 0; idx < element; idx++) {
+      output.push_back(output[from + idx]);
+    }
+  }
+
+  if (output.size() != length) {
+    throw std::runtime_error("Invalid snappy length");
+  }
+  return output;
+}
@@ -0,0 +1,67 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/socket.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+
+int promclient::internal::Connect(
+    const std::string& host, const std::string& port, int type,
+    std::chrono::milliseconds timeout
+) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = type;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    return -1;
+  }
+
+  struct timeval limit;
+  limit.tv_sec = timeout.count() / 1000;
+  limit.tv_usec = (timeout.count() % 1000) * 1000;
+
+  int fd = -1;
+  for (auto address = addresses; address; address = address->ai_next) {
+    fd = socket(
+        address->ai_family, address->ai_socktype | SOCK_CLOEXEC,
+        address->ai_protocol
+    );
+    if (fd == -1) {
+      continue;
+    }
+    // Linux also applies the send timeout to connect.
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+bool promclient::internal::SendAll(
+    int fd, const char* data, std::size_t size
+) {
+  std::size_t sent = 0;
+  while (sent < size) {
+    ssize_t result = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      return false;
+    }
+    sent += static_cast<std::size_t>(result);
+  }
+  return true;
+}
@@ -0,0 +1,86 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/internal/sparse_buckets.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+using promclient::internal::SparseBuckets;
+
+
+const std::int64_t SparseBuckets::EMPTY =
+  std::numeric_limits<std::int64_t>::min();
+
+
+SparseBuckets::SparseBuckets(std::size_t capacity) : size_(0) {
+  // Keep the table at most three quarters full to bound probes.
+  std::size_t slots = 16;
+  while (slots * 3 < capacity * 4) {
+    slots *= 2;
+  }
+  this->mask_ = slots - 1;
+  this->entries_.reset(new Entry[slots]);
+  this->clear();
+}
+
+bool SparseBuckets::add(
+    std::int64_t key, std::uint64_t count, std::size_t limit
+) {
+  // Fibonacci hashing spreads consecutive keys across the table.
+  std::uint64_t hash = static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15;
+  std::size_t slot = static_cast<std::size_t>(hash >> 32) & this->mask_;
+
+  for (std::size_t probe = 0; probe <= this->mask_; probe++) {
+    Entry& entry = this->entries_[(slot + probe) & this->mask_];
+    std::int64_t current = entry.key.load(std::memory_order_acquire);
+
+    // Claim the empty slot for key, unless the limit is reached.
+    if (current == SparseBuckets::EMPTY) {
+      if (this->size_.load(std::memory_order_relaxed) >= limit) {
+        return false;
+      }
+      if (entry.key.compare_exchange_strong(
+            current, key, std::memory_order_acq_rel
+      )) {
+        this->size_.fetch_add(1, std::memory_order_relaxed);
+        current = key;
+      }
+    }
+
+    // The slot is ours or another writer claimed it (maybe for key).
+    if (current == key) {
+      entry.count.fetch_add(count, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t SparseBuckets::capacity() const {
+  return this->mask_ + 1;
+}
+
+void SparseBuckets::clear() {
+  for (std::size_t idx = 0; idx <= this->mask_; idx++) {
+    this->entries_[idx].key.store(
+        SparseBuckets::EMPTY, std::memory_order_relaxed
+    );
+    this->entries_[idx].count.store(0, std::memory_order_relaxed);
+  }
+  this->size_.store(0);
+}
+
+void SparseBuckets::copy(std::map<std::int64_t, std::uint64_t>* counts) const {
+  for (std::size_t idx = 0; idx <= this->mask_; idx++) {
+    const Entry& entry = this->entries_[idx];
+    std::int64_t key = entry.key.load(std::memory_order_relaxed);
+    if (key != SparseBuckets::EMPTY) {
+      (*counts)[key] += entry.count.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+std::size_t SparseBuckets::size() const {
+  return this->size_.load(std::memory_order_relaxed);
+}
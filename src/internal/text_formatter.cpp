@@ -1,58 +1,207 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/internal/text_formatter.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <limits>
+#include <map>
 #include <regex>
+#include <set>
 #include <sstream>
+#include <string>
+#include <utility>
 
 #include "promclient/collector_registry.h"
 #include "promclient/metric.h"
+#include "promclient/internal/registry_metrics.h"
+#include "promclient/internal/utils.h"
 
 
 using promclient::CollectorRegistry;
 using promclient::DescriptorRef;
+using promclient::ExemplarRef;
 using promclient::Sample;
 
+using promclient::internal::BufferTextBridge;
+using promclient::internal::MediaRange;
+using promclient::internal::ScrapeTimer;
 using promclient::internal::TextFormatBridge;
 using promclient::internal::TextFormatter;
 
+using promclient::internal::ParseAccept;
+
 
 std::regex NEW_LINE_RE = std::regex("\n");
 std::regex QUOTE_RE = std::regex("\"");
 std::regex SLASH_RE = std::regex("\\\\");
 
+const std::string COUNTER_SUFFIX = "_total";
+
+
+//! Escape and write a set of labels, if any.
+static void WriteLabels(
+    std::ostream& line, const std::map<std::string, std::string>& labels
+) {
+  if (labels.size() == 0) {
+    return;
+  }
+
+  std::size_t count = labels.size();
+  std::size_t index = 0;
+  line << '{';
+
+  for (const auto& pair : labels) {
+    const std::string& name = pair.first;
+    std::string value = pair.second;
+
+    // Escape label value.
+    value = std::regex_replace(value, SLASH_RE, "\\\\");
+    value = std::regex_replace(value, NEW_LINE_RE, "\\n");
+    value = std::regex_replace(value, QUOTE_RE, "\\\"");
+
+    line << name << "=\"" << value << '"';
+    index += 1;
+    if (index != count) {
+      line << ',';
+    }
+  }
+
+  line << '}';
+}
+
+//! Returns true if name ends with suffix.
+static bool EndsWith(const std::string& name, const std::string& suffix) {
+  return name.size() >= suffix.size() && std::equal(
+      suffix.rbegin(), suffix.rend(), name.rbegin()
+  );
+}
+
 
-TextFormatBridge::TextFormatBridge(CollectorRegistry* registry) {
+TextFormatBridge::TextFormatBridge(
+    CollectorRegistry* registry, TextFormatter::Format format
+) : formatter(format) {
   this->registry_ = registry;
   this->strategy_ = CollectorRegistry::CollectStrategy::SORTED;
 }
 
 void TextFormatBridge::collect() {
-  MetricsList metrics = this->registry_->collect(this->strategy_);
-  for (auto metric : metrics) {
-    DescriptorRef descriptor = metric.descriptor();
+  bool openmetrics = formatter.format() == TextFormatter::Format::OPENMETRICS;
+  ScrapeTimer timer(this->registry_, openmetrics ? "openmetrics" : "text");
+  MetricsList metrics = this->names_.size() == 0 ?
+    this->registry_->collect(this->strategy_) :
+    this->registry_->collect(this->names_, this->strategy_);
+  timer.collected();
+
+  for (const auto& metric : metrics) {
+    const DescriptorRef& descriptor = metric.descriptor();
     std::string desc = formatter.describe(descriptor);
-    std::string name = descriptor->name();
+    std::string name = formatter.sampleName(descriptor);
+    this->starting(descriptor);
+    timer.writing();
     this->write(desc);
+    timer.written(desc.size());
 
-    for (Sample sample : metric.samples()) {
+    for (const auto& sample : metric.samples()) {
       std::string line = formatter.sample(name, sample);
+      timer.writing();
       this->write(line);
+      timer.written(line.size());
     }
   }
+
+  std::string end = formatter.end();
+  if (end != "") {
+    timer.writing();
+    this->write(end);
+    timer.written(end.size());
+  }
+  timer.done();
+}
+
+void TextFormatBridge::filter(std::set<std::string> names) {
+  this->names_ = std::move(names);
+}
+
+void TextFormatBridge::starting(const DescriptorRef& descriptor) {
+  // Noop.
 }
 
 
-std::string TextFormatter::describe(DescriptorRef descriptor) {
-  std::string help = descriptor->help();
+BufferTextBridge::BufferTextBridge(
+    CollectorRegistry* registry, std::string* buffer,
+    TextFormatter::Format format
+) : TextFormatBridge(registry, format) {
+  this->buffer_ = buffer;
+}
+
+const char* BufferTextBridge::contentType() const {
+  return this->formatter.contentType();
+}
+
+void BufferTextBridge::write(std::string line) {
+  this->buffer_->append(line);
+}
+
+
+TextFormatter::Format TextFormatter::Negotiate(const std::string& accept) {
+  double openmetrics = 0;
+  double prometheus = 0;
+  for (const MediaRange& range : ParseAccept(accept)) {
+    const std::string& type = range.type;
+    if (type == "application/openmetrics-text") {
+      openmetrics = std::max(openmetrics, range.quality);
+    } else if (type == "text/plain" || type == "text/*" || type == "*/*") {
+      prometheus = std::max(prometheus, range.quality);
+    }
+  }
+
+  if (openmetrics > 0 && openmetrics >= prometheus) {
+    return TextFormatter::Format::OPENMETRICS;
+  }
+  return TextFormatter::Format::PROMETHEUS;
+}
+
+
+TextFormatter::TextFormatter(TextFormatter::Format format) {
+  this->format_ = format;
+}
+
+TextFormatter::Format TextFormatter::format() const {
+  return this->format_;
+}
+
+const char* TextFormatter::contentType() const {
+  if (this->format_ == TextFormatter::Format::OPENMETRICS) {
+    return "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  }
+  return "text/plain; version=0.0.4";
+}
+
+
+std::string TextFormatter::describe(const DescriptorRef& descriptor) {
+  const std::string& help = descriptor->help();
   std::string name = descriptor->name();
   std::string type = descriptor->type();
+  bool openmetrics = this->format_ == TextFormatter::Format::OPENMETRICS;
+
+  // OpenMetrics counter families do not have the _total suffix.
+  if (openmetrics) {
+    if (type == "counter" && EndsWith(name, COUNTER_SUFFIX)) {
+      name = name.substr(0, name.size() - COUNTER_SUFFIX.size());
+    } else if (type == "untyped") {
+      type = "unknown";
+    }
+  }
 
   std::stringstream desc;
   if (help != "") {
     std::string help_ = help;
     help_ = std::regex_replace(help_, SLASH_RE, "\\\\");
     help_ = std::regex_replace(help_, NEW_LINE_RE, "\\n");
+    if (openmetrics) {
+      help_ = std::regex_replace(help_, QUOTE_RE, "\\\"");
+    }
     desc << "# HELP " << name << " " << help_ << '\n';
   }
 
@@ -60,7 +209,9 @@ std::string TextFormatter::describe(DescriptorRef descriptor) {
   return desc.str();
 }
 
-std::string TextFormatter::sample(std::string name, Sample sample) {
+std::string TextFormatter::sample(
+    const std::string& name, const Sample& sample
+) {
   // Start the line with the metric name.
   std::stringstream line;
   line << name;
@@ -71,46 +222,55 @@ std::string TextFormatter::sample(std::string name, Sample sample) {
   }
   
   // Add labels, if any.
-  std::map<std::string, std::string> labels = sample.labels();
-  if (labels.size() != 0) {
-    std::size_t count = labels.size();
-    std::size_t index = 0;
-    line << '{';
-
-    for (auto pair : labels) {
-      std::string name = pair.first;
-      std::string value = pair.second;
-
-      // Escape label value.
-      value = std::regex_replace(value, SLASH_RE, "\\\\");
-      value = std::regex_replace(value, NEW_LINE_RE, "\\n");
-      value = std::regex_replace(value, QUOTE_RE, "\\\"");
-
-      line << name << "=\"" << value << '"';
-      index += 1;
-      if (index != count) {
-        line << ',';
-      }
+  WriteLabels(line, sample.labels());
+  line << ' ';
+  this->value(line, sample.value());
+
+  // Add the exemplar, if any and supported.
+  const ExemplarRef& exemplar = sample.exemplar();
+  bool openmetrics = this->format_ == TextFormatter::Format::OPENMETRICS;
+  if (openmetrics && exemplar) {
+    line << " # ";
+    WriteLabels(line, exemplar->labels());
+    if (exemplar->labels().size() == 0) {
+      line << "{}";
     }
+    line << ' ';
+    this->value(line, exemplar->value());
+    line << ' ';
+    this->value(line, exemplar->timestamp());
+  }
+
+  line << '\n';
+  return line.str();
+}
 
-    line << '}';
+std::string TextFormatter::end() {
+  if (this->format_ == TextFormatter::Format::OPENMETRICS) {
+    return "# EOF\n";
   }
+  return "";
+}
 
-  // Format value.
-  double value = sample.value();
-  if (isinf(value) && value > 0) {
-    line << " +Inf\n";
-  } else if(isinf(value) && value < 0) {
-    line << " -Inf\n";
-  } else if(isnan(value)) {
-    line << " NaN\n";
+std::string TextFormatter::sampleName(const DescriptorRef& descriptor) {
+  const std::string& name = descriptor->name();
+  bool openmetrics = this->format_ == TextFormatter::Format::OPENMETRICS;
+  bool counter = descriptor->type() == "counter";
+  if (openmetrics && counter && !EndsWith(name, COUNTER_SUFFIX)) {
+    return name + COUNTER_SUFFIX;
+  }
+  return name;
+}
+
+void TextFormatter::value(std::ostream& line, double value) {
+  if (std::isinf(value) && value > 0) {
+    line << "+Inf";
+  } else if (std::isinf(value) && value < 0) {
+    line << "-Inf";
+  } else if (std::isnan(value)) {
+    line << "NaN";
   } else {
     auto digits = std::numeric_limits<double>::digits10 + 1;
-    line << ' '
-      << std::setprecision(digits)
-      << std::scientific
-      << value << '\n';
+    line << std::setprecision(digits) << std::scientific << value;
   }
-
-  return line.str();
 }
@@ -1,11 +1,36 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/internal/utils.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+using promclient::internal::MediaRange;
+using promclient::internal::ResponsePlan;
+
+
+//! Removes whitespace from value and returns it.
+static std::string Strip(std::string value) {
+  value.erase(
+      std::remove_if(value.begin(), value.end(), ::isspace), value.end()
+  );
+  return value;
+}
+
+//! Returns a lowercase copy of value.
+static std::string Lower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+  return value;
+}
+
 
 // From boost implementation of hash_combine.
 // https://github.com/boostorg/functional/blob/boost-1.63.0/include/boost/functional/hash/hash.hpp#L210
@@ -19,13 +44,224 @@ std::size_t promclient::internal::CombineHashes(
   return combined;
 }
 
+
+// Adapted from wyhash final version 4 (released in the public domain).
+// https://github.com/wangyi-fudan/wyhash
+namespace {
+
+  const std::uint64_t WY_SECRET[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+  };
+
+  //! 64x64 -> 128 bits multiply, returns the low and high halves in a, b.
+  inline void WyMum(std::uint64_t* a, std::uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<std::uint64_t>(r);
+    *b = static_cast<std::uint64_t>(r >> 64);
+#else
+    std::uint64_t ha = *a >> 32, hb = *b >> 32;
+    std::uint64_t la = static_cast<std::uint32_t>(*a);
+    std::uint64_t lb = static_cast<std::uint32_t>(*b);
+    std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    std::uint64_t t = rl + (rm0 << 32);
+    std::uint64_t c = t < rl;
+    std::uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+  }
+
+  inline std::uint64_t WyMix(std::uint64_t a, std::uint64_t b) {
+    WyMum(&a, &b);
+    return a ^ b;
+  }
+
+  inline std::uint64_t WyRead8(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  inline std::uint64_t WyRead4(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+  }
+
+  inline std::uint64_t WyRead3(const unsigned char* p, std::size_t k) {
+    return (static_cast<std::uint64_t>(p[0]) << 16) |
+      (static_cast<std::uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+  }
+
+}  // namespace
+
+
+std::string promclient::internal::ETag(const std::string& body) {
+  static const char DIGITS[] = "0123456789abcdef";
+  std::uint64_t hash = HashBytes(body.data(), body.size());
+  std::string etag(18, '"');
+  for (int idx = 16; idx > 0; idx--) {
+    etag[idx] = DIGITS[hash & 0xF];
+    hash >>= 4;
+  }
+  return etag;
+}
+
+std::string promclient::internal::ETag(
+    const std::string& body,
+    const std::vector<std::pair<std::size_t, std::size_t>>& skip
+) {
+  if (skip.size() == 0) {
+    return ETag(body);
+  }
+  std::string kept;
+  kept.reserve(body.size());
+  std::size_t start = 0;
+  for (const auto& range : skip) {
+    kept.append(body, start, range.first - start);
+    start = range.second;
+  }
+  kept.append(body, start, std::string::npos);
+  return ETag(kept);
+}
+
+std::uint64_t promclient::internal::HashBytes(
+    const char* data, std::size_t size, std::uint64_t seed
+) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  const std::uint64_t* s = WY_SECRET;
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+  seed ^= WyMix(seed ^ s[0], s[1]);
+
+  if (size <= 16) {
+    if (size >= 4) {
+      std::size_t skip = (size >> 3) << 2;
+      a = (WyRead4(p) << 32) | WyRead4(p + skip);
+      b = (WyRead4(p + size - 4) << 32) | WyRead4(p + size - 4 - skip);
+    } else if (size > 0) {
+      a = WyRead3(p, size);
+    }
+  } else {
+    std::size_t i = size;
+    if (i > 48) {
+      std::uint64_t see1 = seed;
+      std::uint64_t see2 = seed;
+      do {
+        seed = WyMix(WyRead8(p) ^ s[1], WyRead8(p + 8) ^ seed);
+        see1 = WyMix(WyRead8(p + 16) ^ s[2], WyRead8(p + 24) ^ see1);
+        see2 = WyMix(WyRead8(p + 32) ^ s[3], WyRead8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = WyMix(WyRead8(p) ^ s[1], WyRead8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = WyRead8(p + i - 16);
+    b = WyRead8(p + i - 8);
+  }
+
+  a ^= s[1];
+  b ^= seed;
+  WyMum(&a, &b);
+  return WyMix(a ^ s[0] ^ size, b ^ s[1]);
+}
+
 std::size_t promclient::internal::HashLabels(
     const std::map<std::string, std::string>& labels
 ) {
-  std::vector<std::size_t> hashes;
-  for (auto pair : labels) {
-    hashes.push_back(std::hash<std::string>()(pair.first));
-    hashes.push_back(std::hash<std::string>()(pair.second));
+  // Each string is hashed with the hash so far as the seed.
+  // HashBytes mixes in the size of each string so ("ab", "c")
+  // and ("a", "bc") do not trivially collide.
+  std::uint64_t hash = labels.size();
+  for (const auto& pair : labels) {
+    hash = HashBytes(pair.first.data(), pair.first.size(), hash);
+    hash = HashBytes(pair.second.data(), pair.second.size(), hash);
+  }
+  return static_cast<std::size_t>(hash);
+}
+
+
+bool promclient::internal::MatchETag(
+    const std::string& if_none_match, const std::string& etag
+) {
+  std::stringstream tags(if_none_match);
+  std::string tag;
+  while (std::getline(tags, tag, ',')) {
+    tag = Strip(tag);
+    if (tag.compare(0, 2, "W/") == 0) {
+      tag = tag.substr(2);
+    }
+    if (tag == "*" || tag == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+std::vector<MediaRange> promclient::internal::ParseAccept(
+    const std::string& accept
+) {
+  std::vector<MediaRange> media;
+  std::stringstream ranges(accept);
+  std::string range;
+
+  while (std::getline(ranges, range, ',')) {
+    // Split the media type from its parameters.
+    std::stringstream parts(range);
+    std::string type;
+    std::getline(parts, type, ';');
+
+    MediaRange media_range;
+    media_range.type = Lower(Strip(type));
+    media_range.quality = 1;
+    if (media_range.type == "") {
+      continue;
+    }
+
+    std::string param;
+    while (std::getline(parts, param, ';')) {
+      param = Strip(param);
+      std::size_t equal = param.find('=');
+      if (equal == std::string::npos) {
+        continue;
+      }
+      std::string name = Lower(param.substr(0, equal));
+      std::string value = param.substr(equal + 1);
+      if (name == "q") {
+        media_range.quality = std::strtod(value.c_str(), nullptr);
+      } else {
+        media_range.params[name] = value;
+      }
+    }
+    media.push_back(media_range);
+  }
+  return media;
+}
+
+
+ResponsePlan promclient::internal::PlanResponse(
+    std::size_t size, const std::string& etag,
+    const char* if_none_match, bool head
+) {
+  ResponsePlan plan;
+  plan.length = size;
+  if (if_none_match && MatchETag(if_none_match, etag)) {
+    plan.code = 304;
+    plan.send_body = false;
+  } else {
+    plan.code = 200;
+    plan.send_body = !head;
   }
-  return promclient::internal::CombineHashes(hashes);
+  return plan;
 }
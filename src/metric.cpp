@@ -1,12 +1,13 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include "promclient/metric.h"
 
-#include <functional>
+#include <cstdint>
 #include <map>
 #include <numeric>
 #include <regex>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "promclient/exceptions.h"
@@ -14,51 +15,53 @@
 
 using promclient::Descriptor;
 using promclient::DescriptorRef;
+using promclient::Exemplar;
+using promclient::ExemplarRef;
 
 using promclient::InvalidMetricLabel;
 using promclient::InvalidMetricName;
 
 using promclient::Metric;
+using promclient::NativeBuckets;
+using promclient::NativeBucketsRef;
 using promclient::Sample;
 
-using promclient::internal::CombineHashes;
+using promclient::internal::HashBytes;
 
 
 Descriptor::Descriptor(
     std::string name, std::string type,
     std::string help, std::set<std::string> labels
 ) {
-  this->labels_ = labels;
-  this->help_ = help;
-  this->name_ = name;
-  this->type_ = type;
-
-  // Build descriptor hash once.
-  std::vector<std::size_t> hashes;
-  hashes.push_back(std::hash<std::string>()(this->name_));
-  hashes.push_back(std::hash<std::string>()(this->type_));
-  hashes.push_back(std::hash<std::string>()(this->help_));
-
-  for (auto label : this->labels_) {
-    std::size_t chunk = std::hash<std::string>()(label);
-    hashes.push_back(chunk);
+  this->labels_ = std::move(labels);
+  this->help_ = std::move(help);
+  this->name_ = std::move(name);
+  this->type_ = std::move(type);
+
+  // Build descriptor hash once, streaming all fields.
+  std::uint64_t hash = this->labels_.size();
+  hash = HashBytes(this->name_.data(), this->name_.size(), hash);
+  hash = HashBytes(this->type_.data(), this->type_.size(), hash);
+  hash = HashBytes(this->help_.data(), this->help_.size(), hash);
+  for (const auto& label : this->labels_) {
+    hash = HashBytes(label.data(), label.size(), hash);
   }
-  this->hash_ = CombineHashes(hashes);
+  this->hash_ = static_cast<std::size_t>(hash);
 }
 
-std::set<std::string> Descriptor::labels() const {
+const std::set<std::string>& Descriptor::labels() const {
   return this->labels_;
 }
 
-std::string Descriptor::help() const {
+const std::string& Descriptor::help() const {
   return this->help_;
-};
+}
 
-std::string Descriptor::name() const {
+const std::string& Descriptor::name() const {
   return this->name_;
 }
 
-std::string Descriptor::type() const {
+const std::string& Descriptor::type() const {
   return this->type_;
 }
 
@@ -98,53 +101,116 @@ void Metric::ValidateType(std::string type) {
 
 
 Metric::Metric(DescriptorRef descriptor, std::vector<Sample> samples) {
-  this->descriptor_ = descriptor;
-  this->samples_ = samples;
+  this->descriptor_ = std::move(descriptor);
+  this->samples_ = std::move(samples);
 }
 
-DescriptorRef Metric::descriptor() const {
+const DescriptorRef& Metric::descriptor() const {
   return this->descriptor_;
 }
 
-std::vector<Sample> Metric::samples() const {
+const std::vector<Sample>& Metric::samples() const & {
   return this->samples_;
 }
 
+std::vector<Sample> Metric::samples() && {
+  return std::move(this->samples_);
+}
+
 
-bool Sample::Compare::operator()(const Sample& lhs, const Sample& rhs) {
+bool Sample::Compare::operator()(
+    const Sample& lhs, const Sample& rhs
+) const {
   // Complare roles first.
-  if (lhs.role() < rhs.role()) {
-    return true;
+  if (lhs.role() != rhs.role()) {
+    return lhs.role() < rhs.role();
   }
 
-  // Compare labels next.
-  // We assume that samples have the same labels.
-  std::map<std::string, std::string> rhs_labels = rhs.labels();
-  for (auto pair : lhs.labels()) {
-    if (pair.second < rhs_labels[pair.first]) {
-      return true;
-    }
-  }
+  // Compare labels next, lexicographically by name and value.
+  return lhs.labels() < rhs.labels();
+}
+
+
+Exemplar::Exemplar(
+    std::map<std::string, std::string> labels,
+    double value, double timestamp
+) {
+  this->labels_ = std::move(labels);
+  this->timestamp_ = timestamp;
+  this->value_ = value;
+}
+
+const std::map<std::string, std::string>& Exemplar::labels() const {
+  return this->labels_;
+}
+
+double Exemplar::timestamp() const {
+  return this->timestamp_;
+}
+
+double Exemplar::value() const {
+  return this->value_;
+}
+
 
-  // Seems like !(lhs < rhs).
-  return false;
+NativeBuckets::NativeBuckets(
+    int schema, double zero_threshold, std::uint64_t zero_count,
+    std::map<int, std::uint64_t> positive,
+    std::map<int, std::uint64_t> negative
+) {
+  this->negative_ = std::move(negative);
+  this->positive_ = std::move(positive);
+  this->schema_ = schema;
+  this->zero_count_ = zero_count;
+  this->zero_threshold_ = zero_threshold;
+}
+
+const std::map<int, std::uint64_t>& NativeBuckets::negative() const {
+  return this->negative_;
+}
+
+const std::map<int, std::uint64_t>& NativeBuckets::positive() const {
+  return this->positive_;
+}
+
+int NativeBuckets::schema() const {
+  return this->schema_;
+}
+
+std::uint64_t NativeBuckets::zeroCount() const {
+  return this->zero_count_;
+}
+
+double NativeBuckets::zeroThreshold() const {
+  return this->zero_threshold_;
 }
 
 
 Sample::Sample(
     std::string role, double value,
-    std::map<std::string, std::string> labels
+    std::map<std::string, std::string> labels,
+    ExemplarRef exemplar, NativeBucketsRef native
 ) {
-  this->labels_ = labels;
-  this->role_ = role;
+  this->exemplar_ = std::move(exemplar);
+  this->labels_ = std::move(labels);
+  this->native_ = std::move(native);
+  this->role_ = std::move(role);
   this->value_ = value;
 }
 
-std::map<std::string, std::string> Sample::labels() const {
+const ExemplarRef& Sample::exemplar() const {
+  return this->exemplar_;
+}
+
+const std::map<std::string, std::string>& Sample::labels() const {
   return this->labels_;
 }
 
-std::string Sample::role() const {
+const NativeBucketsRef& Sample::native() const {
+  return this->native_;
+}
+
+const std::string& Sample::role() const {
   return this->role_;
 }
 
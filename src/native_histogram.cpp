@@ -0,0 +1,373 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/native_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+#include "promclient/internal/clock.h"
+#include "promclient/internal/timer.h"
+
+using promclient::LabelledNativeHistogram;
+using promclient::NativeHistogram;
+
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::ExemplarRef;
+using promclient::InvalidHistogram;
+
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::NativeBuckets;
+using promclient::NativeBucketsRef;
+using promclient::Sample;
+
+using promclient::internal::Clock;
+using promclient::internal::ExemplarSlot;
+using promclient::internal::Phaser;
+using promclient::internal::Timer;
+
+
+const std::size_t NativeHistogram::DEFAULT_MAX_BUCKETS;
+const int NativeHistogram::DEFAULT_SCHEMA;
+const double NativeHistogram::DEFAULT_ZERO_THRESHOLD = 2.938735877055719e-39;
+const int NativeHistogram::MAX_SCHEMA;
+const int NativeHistogram::MIN_SCHEMA;
+
+typedef std::map<std::string, std::string> Labels;
+
+//! Minimum table size, enough for all possible buckets at MIN_SCHEMA.
+static const std::size_t MIN_CAPACITY = 300;
+
+
+//! Returns value / divisor (divisor > 0) rounded up.
+static int CeilDiv(int value, int divisor) {
+  if (value >= 0) {
+    return (value + divisor - 1) / divisor;
+  }
+  return -(-value / divisor);
+}
+
+//! Lower bounds of the buckets in each power of 2 for positive schemas.
+static std::vector<std::vector<double>> BuildBounds() {
+  std::vector<std::vector<double>> bounds(NativeHistogram::MAX_SCHEMA + 1);
+  for (int schema = 1; schema <= NativeHistogram::MAX_SCHEMA; schema++) {
+    int count = 1 << schema;
+    for (int idx = 0; idx < count; idx++) {
+      double power = static_cast<double>(idx) / count;
+      bounds[schema].push_back(std::exp2(power) / 2);
+    }
+  }
+  return bounds;
+}
+
+
+int NativeHistogram::BucketIndex(double value, int schema) {
+  // Infinity belongs to the last bucket, which has no upper bound.
+  if (std::isinf(value)) {
+    value = std::numeric_limits<double>::max();
+  }
+
+  // value = fraction * 2^exponent with fraction in [0.5, 1).
+  int exponent;
+  double fraction = std::frexp(value, &exponent);
+  if (schema > 0) {
+    static const std::vector<std::vector<double>> bounds = BuildBounds();
+    const std::vector<double>& powers = bounds[schema];
+    int index = std::lower_bound(
+        powers.begin(), powers.end(), fraction
+    ) - powers.begin();
+    return index + (exponent - 1) * static_cast<int>(powers.size());
+  }
+
+  // Exact powers of 2 are the upper bound of the previous bucket.
+  int index = exponent;
+  if (fraction == 0.5) {
+    index -= 1;
+  }
+  return CeilDiv(index, 1 << -schema);
+}
+
+void NativeHistogram::Validate(
+    int schema, std::size_t max_buckets, double zero_threshold
+) {
+  if (schema < NativeHistogram::MIN_SCHEMA) {
+    throw InvalidHistogram("Native histogram schema is too low");
+  }
+  if (schema > NativeHistogram::MAX_SCHEMA) {
+    throw InvalidHistogram("Native histogram schema is too high");
+  }
+  if (max_buckets == 0) {
+    throw InvalidHistogram("Native histograms need at least one bucket");
+  }
+  if (!(zero_threshold >= 0)) {
+    throw InvalidHistogram("Native histogram zero threshold is negative");
+  }
+}
+
+
+std::int64_t NativeHistogram::Key(int index, bool negative) {
+  return static_cast<std::int64_t>(index) * 2 + (negative ? 1 : 0);
+}
+
+std::int64_t NativeHistogram::ReduceKey(std::int64_t key, int levels) {
+  std::int64_t sign = static_cast<std::uint64_t>(key) & 1;
+  int index = static_cast<int>((key - sign) / 2);
+  for (int level = 0; level < levels; level++) {
+    index = CeilDiv(index, 2);
+  }
+  return NativeHistogram::Key(index, sign == 1);
+}
+
+
+NativeHistogram::Shard::Shard(std::size_t capacity)
+  : schema(0), count(0), zero_count(0), buckets(capacity) {
+  // Noop.
+}
+
+
+NativeHistogram::NativeHistogram(
+    std::string name, std::string help, int schema,
+    std::size_t max_buckets, double zero_threshold
+) : NativeHistogram(
+      DescriptorRef(new Descriptor(name, "histogram", help, {})),
+      schema, max_buckets, zero_threshold
+    ) {
+  // Noop.
+}
+
+NativeHistogram::NativeHistogram(
+    DescriptorRef descriptor, int schema,
+    std::size_t max_buckets, double zero_threshold
+) : exemplar_(nullptr) {
+  NativeHistogram::Validate(schema, max_buckets, zero_threshold);
+  this->descriptor_ = std::move(descriptor);
+  this->max_buckets_ = max_buckets;
+  this->zero_threshold_ = zero_threshold;
+
+  // Leave room for the buckets carried over when writers switch shard.
+  std::size_t capacity = std::max(max_buckets * 2, MIN_CAPACITY);
+  for (int idx = 0; idx < 2; idx++) {
+    this->shards_[idx].reset(new Shard(capacity));
+    this->shards_[idx]->schema.store(schema);
+  }
+  this->active_ = Phaser::Phase(0);
+}
+
+NativeHistogram::~NativeHistogram() {
+  delete this->exemplar_.load();
+}
+
+MetricsList NativeHistogram::collect() {
+  Totals totals;
+  int schema;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    schema = this->shards_[this->active_]->schema.load();
+    totals = this->rotate(schema);
+
+    // A scrape may find more buckets then the limit (when writers add
+    // new buckets while old ones are carried over).
+    while (
+        schema > NativeHistogram::MIN_SCHEMA &&
+        totals.buckets.size() > this->max_buckets_
+    ) {
+      schema -= 1;
+      totals = this->rotate(schema);
+    }
+  }
+
+  std::map<int, std::uint64_t> positive;
+  std::map<int, std::uint64_t> negative;
+  for (const auto& bucket : totals.buckets) {
+    std::int64_t sign = static_cast<std::uint64_t>(bucket.first) & 1;
+    int index = static_cast<int>((bucket.first - sign) / 2);
+    if (sign) {
+      negative[index] = bucket.second;
+    } else {
+      positive[index] = bucket.second;
+    }
+  }
+  NativeBucketsRef native(new NativeBuckets(
+      schema, this->zero_threshold_, totals.zero_count,
+      std::move(positive), std::move(negative)
+  ));
+
+  ExemplarRef exemplar;
+  ExemplarSlot* slot = this->exemplar_.load(std::memory_order_acquire);
+  if (slot) {
+    exemplar = slot->load();
+  }
+
+  // Text formats only see the +Inf bucket of the native histogram.
+  double count = static_cast<double>(totals.count);
+  std::vector<Sample> samples;
+  samples.emplace_back("bucket", count, Labels({{"le", "+Inf"}}), exemplar);
+  samples.emplace_back("count", count, Labels(), nullptr, native);
+  samples.emplace_back("sum", totals.sum, Labels());
+
+  MetricsList metrics;
+  metrics.emplace_back(this->descriptor_, std::move(samples));
+  return metrics;
+}
+
+DescriptorsList NativeHistogram::describe() {
+  return DescriptorsList({this->descriptor_});
+}
+
+void NativeHistogram::observe(double value) {
+  while (true) {
+    std::int64_t token = this->phaser_.enter();
+    Shard* shard = this->shards_[Phaser::Phase(token)].get();
+    bool recorded = this->record(shard, value);
+    this->phaser_.exit(token);
+
+    // Reduce the schema as soon as the limit is exceeded.
+    bool reducible = shard->schema.load() > NativeHistogram::MIN_SCHEMA;
+    if (reducible && shard->buckets.size() > this->max_buckets_) {
+      this->reduce();
+    }
+    if (recorded) {
+      return;
+    }
+  }
+}
+
+void NativeHistogram::observe(
+    double value, const std::map<std::string, std::string>& labels
+) {
+  // Record the exemplar first so invalid labels leave the histogram as is.
+  ExemplarSlot* slot = ExemplarSlot::Install(&this->exemplar_);
+  slot->store(labels, value, Clock::WallTime());
+  this->observe(value);
+}
+
+Timer<NativeHistogram> NativeHistogram::time() {
+  void (NativeHistogram::*observe)(double) = &NativeHistogram::observe;
+  return Timer<NativeHistogram>(this, observe);
+}
+
+int NativeHistogram::schema() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  return this->shards_[this->active_]->schema.load();
+}
+
+
+std::size_t NativeHistogram::populated() const {
+  return this->shards_[this->active_]->buckets.size() + this->pending_.size();
+}
+
+bool NativeHistogram::record(NativeHistogram::Shard* shard, double value) {
+  // NaNs are counted (and poison the sum) but have no bucket.
+  double magnitude = std::fabs(value);
+  if (magnitude <= this->zero_threshold_) {
+    shard->zero_count.fetch_add(1, std::memory_order_relaxed);
+  } else if (!std::isnan(value)) {
+    // Buckets past the limit are only allowed while they can be merged
+    // with a lower schema, and only one at a time.
+    int schema = shard->schema.load(std::memory_order_relaxed);
+    std::size_t limit = this->max_buckets_ + 1;
+    if (schema == NativeHistogram::MIN_SCHEMA) {
+      limit = shard->buckets.capacity();
+    }
+
+    int index = NativeHistogram::BucketIndex(magnitude, schema);
+    std::int64_t key = NativeHistogram::Key(index, value < 0);
+    if (!shard->buckets.add(key, 1, limit)) {
+      return false;
+    }
+  }
+
+  shard->count.fetch_add(1, std::memory_order_relaxed);
+  shard->sum.add(value);
+  return true;
+}
+
+void NativeHistogram::reduce() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  int schema = this->shards_[this->active_]->schema.load();
+
+  // Another writer may have reduced the schema already.
+  while (
+      schema > NativeHistogram::MIN_SCHEMA &&
+      this->populated() > this->max_buckets_
+  ) {
+    schema -= 1;
+    this->rotate(schema);
+  }
+}
+
+NativeHistogram::Totals NativeHistogram::rotate(int schema) {
+  // Writers must find the new schema as soon as they switch shard.
+  int next = 1 - this->active_;
+  Shard* target = this->shards_[next].get();
+  target->schema.store(schema);
+  int ended = this->phaser_.flip();
+  this->active_ = next;
+
+  // Read and reset the shard writers left (no writer can access it).
+  Shard* source = this->shards_[ended].get();
+  Totals totals;
+  totals.count = source->count.exchange(0);
+  totals.sum = source->sum.load();
+  totals.zero_count = source->zero_count.exchange(0);
+  source->sum.store(0);
+
+  std::map<std::int64_t, std::uint64_t> buckets;
+  buckets.swap(this->pending_);
+  source->buckets.copy(&buckets);
+  source->buckets.clear();
+
+  // Merge buckets for the new schema, if it changed.
+  int levels = source->schema.load() - schema;
+  if (levels == 0) {
+    totals.buckets = std::move(buckets);
+  } else {
+    for (const auto& bucket : buckets) {
+      std::int64_t key = NativeHistogram::ReduceKey(bucket.first, levels);
+      totals.buckets[key] += bucket.second;
+    }
+  }
+
+  // Carry the totals over to the shard writers moved to.
+  target->count.fetch_add(totals.count);
+  target->sum.add(totals.sum);
+  target->zero_count.fetch_add(totals.zero_count);
+  for (const auto& bucket : totals.buckets) {
+    if (!target->buckets.add(bucket.first, bucket.second)) {
+      this->pending_[bucket.first] += bucket.second;
+    }
+  }
+  return totals;
+}
+
+
+LabelledNativeHistogram::LabelledNativeHistogram(
+    std::string name, std::string help,
+    std::set<std::string> labels, int schema,
+    std::size_t max_buckets, double zero_threshold
+) : LabelledCollector<NativeHistogram>(std::move(labels), {
+      DescriptorRef(new Descriptor(name, "histogram", help, {}))
+    }) {
+  NativeHistogram::Validate(schema, max_buckets, zero_threshold);
+  this->max_buckets_ = max_buckets;
+  this->schema_ = schema;
+  this->zero_threshold_ = zero_threshold;
+}
+
+LabelledNativeHistogram::Ref LabelledNativeHistogram::makeChild() {
+  return LabelledNativeHistogram::Ref(new NativeHistogram(
+      this->child_descriptors_[0], this->schema_,
+      this->max_buckets_, this->zero_threshold_
+  ));
+}
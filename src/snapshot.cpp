@@ -0,0 +1,174 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include "promclient/snapshot.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+
+using promclient::SnapshotCounter;
+using promclient::SnapshotCounterRef;
+using promclient::SnapshotGauge;
+using promclient::SnapshotGaugeRef;
+using promclient::SnapshotGroup;
+using promclient::SnapshotMetric;
+using promclient::SnapshotUpdate;
+
+using promclient::CounterDecrease;
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::InvalidCollector;
+
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::Phaser;
+
+
+SnapshotUpdate::SnapshotUpdate(const SnapshotGroup& group) {
+  this->phaser_ = group.phaser_.get();
+  this->token_ = this->phaser_->enter();
+}
+
+SnapshotUpdate::~SnapshotUpdate() {
+  this->phaser_->exit(this->token_);
+}
+
+
+SnapshotMetric::SnapshotMetric(
+    DescriptorRef descriptor, std::shared_ptr<Phaser> phaser
+) {
+  this->descriptor_ = std::move(descriptor);
+  this->phaser_ = std::move(phaser);
+  this->total_ = 0;
+}
+
+void SnapshotMetric::add(double value) {
+  std::int64_t token = this->phaser_->enter();
+  this->slots_[Phaser::Phase(token)].add(value);
+  this->phaser_->exit(token);
+}
+
+void SnapshotMetric::add(const SnapshotUpdate& update, double value) {
+  this->slots_[Phaser::Phase(update.token_)].add(value);
+}
+
+double SnapshotMetric::absorb(int phase) {
+  this->total_ += this->slots_[phase].load();
+  this->slots_[phase].store(0);
+  return this->total_;
+}
+
+
+SnapshotCounter::SnapshotCounter(
+    DescriptorRef descriptor, std::shared_ptr<Phaser> phaser
+) : SnapshotMetric(std::move(descriptor), std::move(phaser)) {
+  // Noop.
+}
+
+void SnapshotCounter::inc(double value) {
+  if (value < 0) {
+    throw CounterDecrease(this->descriptor_->name());
+  }
+  this->add(value);
+}
+
+void SnapshotCounter::inc(const SnapshotUpdate& update, double value) {
+  if (value < 0) {
+    throw CounterDecrease(this->descriptor_->name());
+  }
+  this->add(update, value);
+}
+
+
+SnapshotGauge::SnapshotGauge(
+    DescriptorRef descriptor, std::shared_ptr<Phaser> phaser
+) : SnapshotMetric(std::move(descriptor), std::move(phaser)) {
+  // Noop.
+}
+
+void SnapshotGauge::dec(double value) {
+  this->add(-value);
+}
+
+void SnapshotGauge::dec(const SnapshotUpdate& update, double value) {
+  this->add(update, -value);
+}
+
+void SnapshotGauge::inc(double value) {
+  this->add(value);
+}
+
+void SnapshotGauge::inc(const SnapshotUpdate& update, double value) {
+  this->add(update, value);
+}
+
+
+SnapshotGroup::SnapshotGroup() : phaser_(std::make_shared<Phaser>()) {
+  // Noop.
+}
+
+MetricsList SnapshotGroup::collect() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+
+  // Once the phase is flipped the ended slots are no longer written.
+  int ended = this->phaser_->flip();
+  MetricsList metrics;
+  metrics.reserve(this->metrics_.size());
+  for (const auto& metric : this->metrics_) {
+    double value = metric->absorb(ended);
+    metrics.emplace_back(
+        metric->descriptor_, std::vector<Sample>({Sample("", value, {})})
+    );
+  }
+  return metrics;
+}
+
+DescriptorsList SnapshotGroup::describe() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  DescriptorsList descriptors;
+  descriptors.reserve(this->metrics_.size());
+  for (const auto& metric : this->metrics_) {
+    descriptors.push_back(metric->descriptor_);
+  }
+  return descriptors;
+}
+
+SnapshotCounterRef SnapshotGroup::counter(std::string name, std::string help) {
+  Metric::ValidateName(name);
+  DescriptorRef descriptor(new Descriptor(
+      std::move(name), "counter", std::move(help), {}
+  ));
+  SnapshotCounterRef counter(new SnapshotCounter(descriptor, this->phaser_));
+  this->add(counter);
+  return counter;
+}
+
+SnapshotGaugeRef SnapshotGroup::gauge(std::string name, std::string help) {
+  Metric::ValidateName(name);
+  DescriptorRef descriptor(new Descriptor(
+      std::move(name), "gauge", std::move(help), {}
+  ));
+  SnapshotGaugeRef gauge(new SnapshotGauge(descriptor, this->phaser_));
+  this->add(gauge);
+  return gauge;
+}
+
+void SnapshotGroup::add(std::shared_ptr<SnapshotMetric> metric) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  for (const auto& known : this->metrics_) {
+    if (known->descriptor_->name() == metric->descriptor_->name()) {
+      throw InvalidCollector(
+          "Metric " + known->descriptor_->name() +
+          " already declared in the snapshot group"
+      );
+    }
+  }
+  this->metrics_.push_back(std::move(metric));
+}
@@ -0,0 +1,70 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/metric.h"
+
+using promclient::CollectorRegistry;
+using promclient::LabelledCounter;
+using promclient::MetricsList;
+
+
+// Count heap allocations performed by the test binary.
+// Allocation tests are linked in their own binary so the replaced
+// operators do not affect the main test suite.
+static std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+  allocations++;
+  void* ptr = std::malloc(size ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+
+class AllocationsTest : public ::testing::Test {
+ public:
+  //! Returns the allocations performed by a scrape of `series` series.
+  std::size_t scrape(std::size_t series) {
+    CollectorRegistry registry;
+    std::shared_ptr<LabelledCounter> counter(new LabelledCounter(
+        "test_total", "Allocations test", {"idx"}
+    ));
+    for (std::size_t idx = 0; idx < series; idx++) {
+      counter->labels({{"idx", std::to_string(idx)}})->inc();
+    }
+    registry.registr(counter);
+
+    // Warm up per-thread and lazily initialised state.
+    registry.collect();
+    std::size_t before = allocations.load();
+    MetricsList metrics = registry.collect();
+    std::size_t after = allocations.load();
+    EXPECT_EQ(series, metrics[0].samples().size());
+    return after - before;
+  }
+};
+
+TEST_F(AllocationsTest, ConstantAllocationsPerSeries) {
+  std::size_t small = this->scrape(100);
+  std::size_t large = this->scrape(1100);
+  std::size_t per_series = (large - small) / 1000;
+  ASSERT_LE(per_series, static_cast<std::size_t>(8));
+}
@@ -0,0 +1,123 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "promclient/bound.h"
+#include "promclient/collector_registry.h"
+#include "promclient/metric.h"
+
+
+using promclient::BoundCounter;
+using promclient::BoundCounterArray;
+using promclient::BoundGauge;
+using promclient::BoundGaugeArray;
+using promclient::CollectorRegistry;
+using promclient::ScopedBinding;
+
+using promclient::DescriptorsList;
+using promclient::MetricsList;
+
+typedef std::atomic<std::uint64_t> AtomicStat;
+
+
+TEST(BoundCounter, Describe) {
+  AtomicStat requests(0);
+  BoundCounter<AtomicStat> counter("requests", "Test", &requests);
+  DescriptorsList descriptors = counter.describe();
+  ASSERT_EQ(1u, descriptors.size());
+  ASSERT_EQ("requests", descriptors[0]->name());
+  ASSERT_EQ("counter", descriptors[0]->type());
+}
+
+TEST(BoundCounter, ReadsAtomic) {
+  AtomicStat requests(0);
+  BoundCounter<AtomicStat> counter("requests", "Test", &requests);
+  requests += 3;
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(3, metrics[0].samples()[0].value());
+  requests += 2;
+  metrics = counter.collect();
+  ASSERT_EQ(5, metrics[0].samples()[0].value());
+}
+
+TEST(BoundGauge, ReadsPlainValue) {
+  int connections = 7;
+  BoundGauge<int> gauge("connections", "Test", &connections);
+  connections = -2;
+  MetricsList metrics = gauge.collect();
+  ASSERT_EQ("gauge", metrics[0].descriptor()->type());
+  ASSERT_EQ(-2, metrics[0].samples()[0].value());
+}
+
+TEST(BoundGauge, UnbindStopsCollection) {
+  int connections = 7;
+  BoundGauge<int> gauge("connections", "Test", &connections);
+  gauge.unbind();
+  ASSERT_EQ(0u, gauge.collect().size());
+}
+
+
+TEST(BoundArray, CollectsLabelledValues) {
+  AtomicStat stats[3];
+  stats[0] = 1;
+  stats[1] = 2;
+  stats[2] = 3;
+  BoundCounterArray<AtomicStat> counter(
+      "errors", "Test", "kind", {"io", "parse", "timeout"}, stats
+  );
+
+  std::set<std::string> labels = {"kind"};
+  ASSERT_EQ(labels, counter.describe()[0]->labels());
+
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(1u, metrics.size());
+  ASSERT_EQ(3u, metrics[0].samples().size());
+  ASSERT_EQ("parse", metrics[0].samples()[1].labels().at("kind"));
+  ASSERT_EQ(2, metrics[0].samples()[1].value());
+}
+
+TEST(BoundArray, Gauge) {
+  double values[] = {0.5, 1.5};
+  BoundGaugeArray<double> gauge("load", "Test", "cpu", {"0", "1"}, values);
+  MetricsList metrics = gauge.collect();
+  ASSERT_EQ("gauge", metrics[0].descriptor()->type());
+  ASSERT_EQ(1.5, metrics[0].samples()[1].value());
+}
+
+
+TEST(ScopedBinding, RegistersUntilDestroyed) {
+  CollectorRegistry registry;
+  std::shared_ptr<BoundGauge<int>> gauge;
+  {
+    int connections = 4;
+    gauge.reset(new BoundGauge<int>("connections", "Test", &connections));
+    ScopedBinding binding(gauge, &registry);
+    MetricsList metrics = registry.collect();
+    ASSERT_EQ(1u, metrics.size());
+    ASSERT_EQ(4, metrics[0].samples()[0].value());
+  }
+  ASSERT_EQ(0u, registry.collect().size());
+  ASSERT_EQ(0u, gauge->collect().size());
+}
+
+TEST(ScopedBinding, Moved) {
+  CollectorRegistry registry;
+  int connections = 4;
+  std::shared_ptr<BoundGauge<int>> gauge(
+      new BoundGauge<int>("connections", "Test", &connections)
+  );
+  {
+    ScopedBinding moved(gauge, &registry);
+    {
+      ScopedBinding binding(std::move(moved));
+    }
+    ASSERT_EQ(0u, registry.collect().size());
+  }
+  ASSERT_EQ(0u, registry.collect().size());
+}
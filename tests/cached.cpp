@@ -0,0 +1,175 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "promclient/cached.h"
+#include "promclient/collector.h"
+#include "promclient/metric.h"
+
+
+using promclient::CachedCollector;
+using promclient::Collector;
+using promclient::CollectorRef;
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+
+class SlowCollector : public Collector {
+ public:
+  std::atomic<int> calls;
+  std::atomic<bool> fail;
+  double value;
+  std::shared_future<void> release;
+
+  SlowCollector() : calls(0), fail(false), value(1) {
+    std::promise<void> ready;
+    ready.set_value();
+    this->release = ready.get_future().share();
+  }
+
+  MetricsList collect() {
+    this->release.wait();
+    this->calls += 1;
+    if (this->fail) {
+      throw std::runtime_error("collect failed");
+    }
+    Sample sample("", this->value, {});
+    return MetricsList({Metric(this->descriptor(), {sample})});
+  }
+
+  DescriptorsList describe() {
+    return DescriptorsList({this->descriptor()});
+  }
+
+  DescriptorRef descriptor() {
+    return DescriptorRef(new Descriptor("slow", "gauge", "Slow gauge", {}));
+  }
+};
+
+
+class CachedCollectorTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<SlowCollector> inner;
+
+  CachedCollectorTest() : inner(new SlowCollector()) {
+    // Noop.
+  }
+
+  double valueOf(const MetricsList& metrics) {
+    return metrics[0].samples()[0].value();
+  }
+
+  //! Waits (up to a second) for the cache to refresh `count` times.
+  void waitForRefreshes(CachedCollector* cached, std::uint64_t count) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+      auto stats = cached->stats();
+      if (stats.refreshes + stats.failures >= count) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+};
+
+
+TEST_F(CachedCollectorTest, Describe) {
+  CachedCollector cached(this->inner, std::chrono::hours(1));
+  DescriptorsList descriptors = cached.describe();
+  ASSERT_EQ(1u, descriptors.size());
+  ASSERT_EQ("slow", descriptors[0]->name());
+  ASSERT_EQ(0, this->inner->calls);
+}
+
+TEST_F(CachedCollectorTest, ColdCollectWaits) {
+  CachedCollector cached(this->inner, std::chrono::hours(1));
+  MetricsList metrics = cached.collect();
+  ASSERT_EQ(1, this->inner->calls);
+  ASSERT_EQ(1, this->valueOf(metrics));
+  ASSERT_EQ(1u, cached.stats().misses);
+  ASSERT_EQ(1u, cached.stats().refreshes);
+}
+
+TEST_F(CachedCollectorTest, ColdCollectThrows) {
+  CachedCollector cached(this->inner, std::chrono::hours(1));
+  this->inner->fail = true;
+  ASSERT_THROW(cached.collect(), std::runtime_error);
+  ASSERT_EQ(1u, cached.stats().failures);
+
+  this->inner->fail = false;
+  ASSERT_EQ(1, this->valueOf(cached.collect()));
+  ASSERT_EQ(2, this->inner->calls);
+}
+
+TEST_F(CachedCollectorTest, FreshCollectIsCached) {
+  CachedCollector cached(this->inner, std::chrono::hours(1));
+  cached.collect();
+  this->inner->value = 2;
+  MetricsList metrics = cached.collect();
+  ASSERT_EQ(1, this->inner->calls);
+  ASSERT_EQ(1, this->valueOf(metrics));
+  ASSERT_EQ(1u, cached.stats().hits);
+}
+
+TEST_F(CachedCollectorTest, RefreshReplacesMetrics) {
+  CachedCollector cached(this->inner, std::chrono::hours(1));
+  cached.refresh();
+  this->inner->value = 2;
+  ASSERT_EQ(2, this->valueOf(cached.refresh()));
+  ASSERT_EQ(2, this->valueOf(cached.collect()));
+  ASSERT_EQ(0u, cached.stats().misses);
+  ASSERT_EQ(2, this->inner->calls);
+}
+
+TEST_F(CachedCollectorTest, StaleCollectDoesNotWait) {
+  CachedCollector cached(this->inner, std::chrono::milliseconds(1));
+  cached.collect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  // Block the background refresh until the stale metrics are returned.
+  std::promise<void> release;
+  this->inner->release = release.get_future().share();
+  this->inner->value = 2;
+  MetricsList metrics = cached.collect();
+  ASSERT_EQ(1, this->valueOf(metrics));
+  ASSERT_EQ(1u, cached.stats().stale);
+
+  release.set_value();
+  this->waitForRefreshes(&cached, 2);
+  ASSERT_EQ(2, this->inner->calls);
+  ASSERT_EQ(2, this->valueOf(cached.collect()));
+}
+
+TEST_F(CachedCollectorTest, StaleFailureKeepsMetrics) {
+  CachedCollector cached(this->inner, std::chrono::milliseconds(1));
+  cached.collect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  this->inner->fail = true;
+  ASSERT_EQ(1, this->valueOf(cached.collect()));
+  this->waitForRefreshes(&cached, 2);
+  ASSERT_EQ(1u, cached.stats().failures);
+  ASSERT_EQ(1, this->valueOf(cached.collect()));
+}
+
+TEST_F(CachedCollectorTest, DestroyWhileRefreshing) {
+  std::promise<void> release;
+  {
+    CachedCollector cached(this->inner, std::chrono::milliseconds(1));
+    cached.collect();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    this->inner->release = release.get_future().share();
+    cached.collect();
+    release.set_value();
+  }
+  ASSERT_GE(this->inner->calls, 1);
+}
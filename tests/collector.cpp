@@ -1,10 +1,13 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <thread>
 #include <vector>
 
 #include "promclient/collector.h"
 #include "promclient/exceptions.h"
+#include "promclient/internal/utils.h"
 
 using promclient::Collector;
 using promclient::Descriptor;
@@ -58,6 +61,44 @@ class TestCollector : public LabelledCollector<ConstCollector> {
 };
 
 
+class DescribedCollector : public LabelledCollector<ConstCollector> {
+ public:
+  DescribedCollector(std::set<std::string> labels) :
+    LabelledCollector<ConstCollector>(labels, ConstCollector().describe()) {
+    this->children_made = 0;
+  }
+
+  int children_made;
+
+ protected:
+  std::shared_ptr<ConstCollector> makeChild() {
+    this->children_made += 1;
+    return std::shared_ptr<ConstCollector>(new ConstCollector());
+  }
+};
+
+
+class CollidingCollector : public TestCollector {
+ public:
+  CollidingCollector(std::set<std::string> labels) : TestCollector(labels) {
+    // Noop.
+  }
+
+  //! Cache a child for `labels` in the hash bucket of `bucket`.
+  Ref collide(
+      std::map<std::string, std::string> labels,
+      std::map<std::string, std::string> bucket
+  ) {
+    Child child;
+    child.collector = this->makeChild();
+    child.labels = labels;
+    std::size_t hash = promclient::internal::HashLabels(bucket);
+    this->children_.insert(std::make_pair(hash, child));
+    return child.collector;
+  }
+};
+
+
 TEST(LabelledCollector, DescribeDecoratesChildCollector) {
   TestCollector test({"lb1", "lb2"});
   DescriptorsList descs = test.describe();
@@ -78,6 +119,16 @@ TEST(LabelledCollector, DescribeIsCached) {
   ASSERT_EQ(descs1[0], descs2[0]);
 }
 
+TEST(LabelledCollector, DescribeKnownDescriptorsWithoutChild) {
+  DescribedCollector test({"lb1", "lb2"});
+  DescriptorsList descs = test.describe();
+  std::set<std::string> labels = {"lb0", "lb1", "lb2"};
+  ASSERT_EQ(static_cast<std::size_t>(1), descs.size());
+  ASSERT_EQ("test", descs[0]->name());
+  ASSERT_EQ(labels, descs[0]->labels());
+  ASSERT_EQ(0, test.children_made);
+}
+
 TEST(LabelledCollector, CollectLabeledMetrics) {
   TestCollector test({"lb1", "lb2"});
   TestCollector::Ref collector1 = test.labels({
@@ -190,3 +241,128 @@ TEST(LabelledCollector, ClearChildren) {
   ASSERT_NE(collector1, collector3);
   ASSERT_NE(collector2, collector4);
 }
+
+TEST(LabelledCollector, CardinalityRoutesToOverflow) {
+  TestCollector test({"lb1"});
+  test.cardinality(2);
+  TestCollector::Ref collector1 = test.labels({{"lb1", "val1"}});
+  TestCollector::Ref collector2 = test.labels({{"lb1", "val2"}});
+  TestCollector::Ref overflow1 = test.labels({{"lb1", "val3"}});
+  TestCollector::Ref overflow2 = test.labels({{"lb1", "val4"}});
+
+  ASSERT_NE(collector1, collector2);
+  ASSERT_NE(collector1, overflow1);
+  ASSERT_NE(collector2, overflow1);
+  ASSERT_EQ(overflow1, overflow2);
+  ASSERT_EQ(collector1, test.labels({{"lb1", "val1"}}));
+}
+
+TEST(LabelledCollector, CardinalityStillValidatesLabels) {
+  TestCollector test({"lb1"});
+  test.cardinality(1);
+  test.labels({{"lb1", "val1"}});
+  ASSERT_THROW(test.labels({}), UndefinedLabel);
+  ASSERT_THROW(test.labels({
+      {"lb1", "val2"},
+      {"lb2", "val2"}
+  }), UnexpectedLabel);
+}
+
+TEST(LabelledCollector, CardinalityCollectsOverflowAndDropped) {
+  TestCollector test({"lb1"});
+  test.cardinality(1);
+  test.labels({{"lb1", "val1"}});
+  test.labels({{"lb1", "val2"}});
+  test.labels({{"lb1", "val3"}});
+
+  std::map<std::string, std::string> overflow_labels = {
+    {"lb0", "val0"},
+    {"lb1", TestCollector::OVERFLOW_VALUE}
+  };
+  std::map<std::string, std::string> dropped_labels = {{"metric", "test"}};
+
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(3), metrics.size());
+  ASSERT_EQ(overflow_labels, metrics[1].samples()[0].labels());
+  ASSERT_EQ(
+      "promclient_dropped_label_sets_total",
+      metrics[2].descriptor()->name()
+  );
+  ASSERT_EQ(2, metrics[2].samples()[0].value());
+  ASSERT_EQ(dropped_labels, metrics[2].samples()[0].labels());
+}
+
+TEST(LabelledCollector, CardinalityDescribesDropped) {
+  TestCollector test({"lb1"});
+  test.cardinality(10);
+  DescriptorsList descs = test.describe();
+  ASSERT_EQ(static_cast<std::size_t>(2), descs.size());
+  ASSERT_EQ("test", descs[0]->name());
+  ASSERT_EQ("promclient_dropped_label_sets_total", descs[1]->name());
+}
+
+TEST(LabelledCollector, TtlExpiresIdleChildren) {
+  TestCollector test({"lb1"});
+  test.ttl(std::chrono::milliseconds(1));
+  test.labels({{"lb1", "val1"}});
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(0), metrics.size());
+}
+
+TEST(LabelledCollector, TtlKeepsReferencedChildren) {
+  TestCollector test({"lb1"});
+  test.ttl(std::chrono::milliseconds(1));
+  TestCollector::Ref collector = test.labels({{"lb1", "val1"}});
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  test.expire();
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ(collector, test.labels({{"lb1", "val1"}}));
+}
+
+TEST(LabelledCollector, TtlKeepsActiveChildren) {
+  TestCollector test({"lb1"});
+  test.ttl(std::chrono::hours(1));
+  test.labels({{"lb1", "val1"}});
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+}
+
+TEST(LabelledCollector, HashCollisionsDoNotAlias) {
+  CollidingCollector test({"lb1"});
+  TestCollector::Ref collider = test.collide(
+      {{"lb1", "val1"}}, {{"lb1", "val2"}}
+  );
+  TestCollector::Ref collector = test.labels({{"lb1", "val2"}});
+  ASSERT_NE(collider, collector);
+  ASSERT_EQ(collector, test.labels({{"lb1", "val2"}}));
+
+  test.remove({{"lb1", "val2"}});
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+}
+
+TEST(LabelledCollector, RemoveUnknownChild) {
+  TestCollector test({"lb1"});
+  test.labels({{"lb1", "val1"}});
+  test.remove({{"lb1", "val2"}});
+  MetricsList metrics = test.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+}
+
+TEST(LabelledCollector, CacheStats) {
+  TestCollector test({"lb1"});
+  test.labels({{"lb1", "val1"}});
+  test.labels({{"lb1", "val1"}});
+  test.labels({{"lb1", "val2"}});
+  ASSERT_THROW(test.labels({{"lb2", "val1"}}), UndefinedLabel);
+
+  promclient::LabelledCacheStats stats = test.cacheStats();
+  ASSERT_EQ("test", stats.name);
+  ASSERT_EQ(2u, stats.children);
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(2u, stats.misses);
+}
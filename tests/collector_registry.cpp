@@ -1,10 +1,12 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include <gtest/gtest.h>
 
+#include <string>
 #include <vector>
 
 #include "promclient/collector.h"
 #include "promclient/collector_registry.h"
+#include "promclient/counter.h"
 #include "promclient/exceptions.h"
 #include "promclient/metric.h"
 
@@ -142,6 +144,23 @@ TEST_F(RegisterTest, MetricsWithSameNameHaveSameLabels) {
   this->registry.registr(collector4);
 }
 
+TEST_F(RegisterTest, RejectedCollectorIsNotRecorded) {
+  this->registry.registr(CollectorRef(new MockCollector({
+      this->descriptor("counter", {})
+  })));
+
+  DescriptorRef other(new Descriptor("other", "counter", "", {}));
+  CollectorRef rejected(new MockCollector({
+      other, this->descriptor("gauge", {})
+  }));
+  ASSERT_THROW(this->registry.registr(rejected), InvalidCollector);
+  ASSERT_EQ(1, this->registry.countCollectors());
+
+  DescriptorRef other_gauge(new Descriptor("other", "gauge", "", {}));
+  this->registry.registr(CollectorRef(new MockCollector({other_gauge})));
+  ASSERT_EQ(2, this->registry.countCollectors());
+}
+
 TEST_F(RegisterTest, RemoveCollector) {
   CollectorRef collector(new MockCollector({
       this->descriptor("counter", {})
@@ -154,6 +173,31 @@ TEST_F(RegisterTest, RemoveCollector) {
   ASSERT_EQ(0, this->registry.countCollectors());
 }
 
+TEST_F(RegisterTest, RemoveUnknownCollector) {
+  CollectorRef collector(new MockCollector({
+      this->descriptor("counter", {})
+  }));
+  ASSERT_FALSE(this->registry.unregister(collector));
+}
+
+TEST_F(RegisterTest, RemoveKeepsOtherCollectors) {
+  CollectorRef collector1(new MockCollector({
+      this->descriptor("counter", {})
+  }));
+  CollectorRef collector2(new MockCollector({
+      this->descriptor("counter", {})
+  }));
+  this->registry.registr(collector1);
+  this->registry.registr(collector2);
+  this->registry.registr(collector1);
+
+  ASSERT_TRUE(this->registry.unregister(collector1));
+  ASSERT_EQ(1, this->registry.countCollectors());
+  ASSERT_FALSE(this->registry.unregister(collector1));
+  ASSERT_TRUE(this->registry.unregister(collector2));
+  ASSERT_EQ(0, this->registry.countCollectors());
+}
+
 
 class CollectTest : public CollectorRegistryTest {
  public:
@@ -186,6 +230,17 @@ class SortedCollectTest : public CollectTest {
   }
 };
 
+TEST_F(SortedCollectTest, CollectSeesRegistrationChanges) {
+  CollectorRef collector(new FixedCollector("abc", {Sample("", 1, {})}));
+  ASSERT_EQ(static_cast<std::size_t>(0), this->collect().size());
+
+  this->registry.registr(collector);
+  ASSERT_EQ(static_cast<std::size_t>(1), this->collect().size());
+
+  this->registry.unregister(collector);
+  ASSERT_EQ(static_cast<std::size_t>(0), this->collect().size());
+}
+
 TEST_F(SortedCollectTest, SortsMetricsByName) {
   this->addCollector("def");
   this->addCollector("abc");
@@ -254,3 +309,136 @@ TEST_F(SortedCollectTest, SortsMetricsByLabelsDifferentCollectors) {
   ASSERT_EQ(1, samples[0].value());
   ASSERT_EQ(2, samples[1].value());
 }
+
+TEST_F(SortedCollectTest, SortsMetricsByRoleThenLabels) {
+  this->addCollector("abc", {
+      Sample("role2", 1, {{"lb1", "val1"}}),
+      Sample("role1", 2, {{"lb1", "val2"}}),
+      Sample("role1", 3, {{"lb1", "val1"}})
+  });
+  MetricsList metrics = this->collect();
+  std::vector<Sample> samples = metrics[0].samples();
+  ASSERT_EQ(static_cast<std::size_t>(3), samples.size());
+  ASSERT_EQ(3, samples[0].value());
+  ASSERT_EQ(2, samples[1].value());
+  ASSERT_EQ(1, samples[2].value());
+}
+
+TEST_F(SortedCollectTest, FirstDuplicateSampleWins) {
+  this->addCollector("abc", {Sample("role1", 1, {{"lb1", "val1"}})});
+  this->addCollector("abc", {Sample("role1", 2, {{"lb1", "val1"}})});
+  MetricsList metrics = this->collect();
+  std::vector<Sample> samples = metrics[0].samples();
+  ASSERT_EQ(static_cast<std::size_t>(1), samples.size());
+  ASSERT_EQ(1, samples[0].value());
+}
+
+TEST_F(SortedCollectTest, RepeatedCollections) {
+  this->addCollector("def", {Sample("", 1, {})});
+  this->addCollector("abc", {Sample("", 2, {})});
+  for (int idx = 0; idx < 3; idx++) {
+    MetricsList metrics = this->collect();
+    ASSERT_EQ(static_cast<std::size_t>(2), metrics.size());
+    ASSERT_EQ("abc", metrics[0].descriptor()->name());
+    ASSERT_EQ(2, metrics[0].samples()[0].value());
+  }
+}
+
+
+class FilteredCollectTest : public CollectTest {
+ public:
+  //! Collector exporting two metrics that counts its collections.
+  class PairCollector : public MockCollector {
+   public:
+    PairCollector(std::string first, std::string second) {
+      this->collections = 0;
+      this->descriptors_.push_back(DescriptorRef(
+          new Descriptor(first, "untyped", "", {})
+      ));
+      this->descriptors_.push_back(DescriptorRef(
+          new Descriptor(second, "untyped", "", {})
+      ));
+      this->metrics_.push_back(Metric(
+          this->descriptors_[0], {Sample("", 1, {})}
+      ));
+      this->metrics_.push_back(Metric(
+          this->descriptors_[1], {Sample("", 2, {})}
+      ));
+    }
+
+    MetricsList collect() {
+      this->collections += 1;
+      return this->metrics_;
+    }
+
+    int collections;
+  };
+};
+
+TEST_F(FilteredCollectTest, OnlyCallsMatchingCollectors) {
+  std::shared_ptr<PairCollector> first(new PairCollector("abc", "def"));
+  std::shared_ptr<PairCollector> second(new PairCollector("ghi", "jkl"));
+  this->registry.registr(first);
+  this->registry.registr(second);
+
+  MetricsList metrics = this->registry.collect({"def"});
+  ASSERT_EQ(1, first->collections);
+  ASSERT_EQ(0, second->collections);
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ("def", metrics[0].descriptor()->name());
+  ASSERT_EQ(2, metrics[0].samples()[0].value());
+}
+
+TEST_F(FilteredCollectTest, MergesMetricsAcrossCollectors) {
+  this->addCollector("abc", {Sample("role2", 1, {})});
+  this->addCollector("abc", {Sample("role1", 2, {})});
+  this->addCollector("def");
+  MetricsList metrics = this->registry.collect({"abc", "unknown"});
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ(static_cast<std::size_t>(2), metrics[0].samples().size());
+  ASSERT_EQ("role1", metrics[0].samples()[0].role());
+}
+
+TEST_F(FilteredCollectTest, UnknownNamesCollectNothing) {
+  this->addCollector("abc");
+  ASSERT_EQ(
+      static_cast<std::size_t>(0), this->registry.collect({"def"}).size()
+  );
+}
+
+TEST_F(FilteredCollectTest, DynamicCollectorsAreAlwaysCalled) {
+  class DynamicCollector : public PairCollector {
+   public:
+    DynamicCollector() : PairCollector("abc", "def") {
+      this->descriptors_.pop_back();
+    }
+
+    bool dynamic() {
+      return true;
+    }
+  };
+  std::shared_ptr<PairCollector> collector(new DynamicCollector());
+  this->registry.registr(collector);
+
+  MetricsList metrics = this->registry.collect({"def"});
+  ASSERT_EQ(1, collector->collections);
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ("def", metrics[0].descriptor()->name());
+
+  this->registry.unregister(collector);
+  ASSERT_EQ(
+      static_cast<std::size_t>(0), this->registry.collect({"def"}).size()
+  );
+  ASSERT_EQ(1, collector->collections);
+}
+
+TEST_F(FilteredCollectTest, UnregisteredCollectorsAreNotCalled) {
+  std::shared_ptr<PairCollector> collector(new PairCollector("abc", "def"));
+  this->registry.registr(collector);
+  this->registry.registr(collector);
+  this->registry.unregister(collector);
+  ASSERT_EQ(
+      static_cast<std::size_t>(0), this->registry.collect({"abc"}).size()
+  );
+  ASSERT_EQ(0, collector->collections);
+}
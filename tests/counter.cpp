@@ -3,6 +3,7 @@
 
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -15,12 +16,33 @@ using promclient::Counter;
 using promclient::CounterDecrease;
 using promclient::DescriptorRef;
 using promclient::DescriptorsList;
+using promclient::ExemplarRef;
+using promclient::InvalidExemplar;
+using promclient::LabelledCounter;
 
 using promclient::Metric;
 using promclient::MetricsList;
 using promclient::Sample;
 
 
+//! Distinct exception types to fill the exception names cache.
+template<int N>
+struct NumberedError {};
+
+//! Counts one exception for each type from NumberedError<0> to <N>.
+template<int N>
+void ThrowNumbered(LabelledCounter* counter) {
+  ThrowNumbered<N - 1>(counter);
+  auto fail = []() { throw NumberedError<N>(); };
+  ASSERT_THROW(counter->countExceptions("type", fail), NumberedError<N>);
+}
+
+template<>
+void ThrowNumbered<-1>(LabelledCounter* counter) {
+  // Noop.
+}
+
+
 TEST(Counter, DescribeOneCounterType) {
   DescriptorsList all_descs;
   std::set<std::string> labels;
@@ -110,3 +132,153 @@ TEST(Counter, NegativeIncrementFails) {
   Sample sample = metrics[0].samples()[0];
   ASSERT_EQ(0, sample.value());
 }
+
+
+TEST(LabelledCounter, ChildrenShareDescriptor) {
+  LabelledCounter counter("test", "Test counter", {"lb"});
+  DescriptorsList first = counter.labels({{"lb", "a"}})->describe();
+  DescriptorsList second = counter.labels({{"lb", "b"}})->describe();
+  ASSERT_EQ(first[0], second[0]);
+  ASSERT_EQ("counter", first[0]->type());
+}
+
+
+TEST(Counter, IncrementWithExemplar) {
+  Counter counter("test", "Test counter");
+  counter.inc(2, {{"trace_id", "abc"}});
+
+  MetricsList metrics = counter.collect();
+  const Sample& sample = metrics[0].samples()[0];
+  ASSERT_EQ(2, sample.value());
+  ExemplarRef exemplar = sample.exemplar();
+  ASSERT_NE(nullptr, exemplar);
+  ASSERT_EQ("abc", exemplar->labels().at("trace_id"));
+  ASSERT_EQ(2, exemplar->value());
+  ASSERT_LT(0, exemplar->timestamp());
+}
+
+TEST(Counter, NoExemplarByDefault) {
+  Counter counter("test", "Test counter");
+  counter.inc();
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(nullptr, metrics[0].samples()[0].exemplar());
+}
+
+TEST(Counter, InvalidExemplarDoesNotIncrement) {
+  Counter counter("test", "Test counter");
+  std::string trace(200, 'a');
+  ASSERT_THROW(counter.inc(1, {{"trace_id", trace}}), InvalidExemplar);
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(0, metrics[0].samples()[0].value());
+}
+
+TEST(LabelledCounter, CollectsExemplars) {
+  LabelledCounter counter("test", "Test counter", {"lb"});
+  counter.labels({{"lb", "a"}})->inc(1, {{"trace_id", "abc"}});
+  MetricsList metrics = counter.collect();
+  ExemplarRef exemplar = metrics[0].samples()[0].exemplar();
+  ASSERT_NE(nullptr, exemplar);
+  ASSERT_EQ("abc", exemplar->labels().at("trace_id"));
+}
+
+
+TEST(Counter, CountExceptionsGuard) {
+  Counter counter("test", "Test counter");
+  {
+    Counter::ExceptionGuard guard = counter.countExceptions();
+  }
+  try {
+    Counter::ExceptionGuard guard = counter.countExceptions();
+    throw std::runtime_error("test");
+  } catch (const std::runtime_error&) {
+    // Noop.
+  }
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+}
+
+TEST(Counter, CountExceptionsGuardCreatedDuringUnwind) {
+  Counter counter("test", "Test counter");
+  struct Cleanup {
+    Counter* counter;
+    ~Cleanup() {
+      // Created while unwinding but not destroyed by the exception.
+      Counter::ExceptionGuard guard = this->counter->countExceptions();
+    }
+  };
+  try {
+    Cleanup cleanup{&counter};
+    throw std::runtime_error("test");
+  } catch (const std::runtime_error&) {
+    // Noop.
+  }
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(0, metrics[0].samples()[0].value());
+}
+
+TEST(Counter, CountExceptionsCall) {
+  Counter counter("test", "Test counter");
+  ASSERT_EQ(42, counter.countExceptions([]() { return 42; }));
+  ASSERT_THROW(
+      counter.countExceptions([]() { throw 42; }), int
+  );
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+}
+
+TEST(Counter, CountExceptionsFiltered) {
+  Counter counter("test", "Test counter");
+  auto invalid = []() { throw std::invalid_argument("test"); };
+  auto range = []() { throw std::range_error("test"); };
+  ASSERT_THROW(
+      counter.countExceptions<std::logic_error>(invalid),
+      std::invalid_argument
+  );
+  ASSERT_THROW(
+      counter.countExceptions<std::logic_error>(range), std::range_error
+  );
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+}
+
+TEST(LabelledCounter, CountExceptionsByType) {
+  LabelledCounter counter("test", "Test counter", {"lb", "type"});
+  auto invalid = []() { throw std::invalid_argument("test"); };
+  for (int idx = 0; idx < 2; idx++) {
+    ASSERT_THROW(
+        counter.countExceptions("type", invalid, {{"lb", "a"}}),
+        std::invalid_argument
+    );
+  }
+  ASSERT_THROW(
+      counter.countExceptions("type", []() { throw 42; }, {{"lb", "a"}}),
+      int
+  );
+
+  std::map<std::string, double> values;
+  for (const Metric& metric : counter.collect()) {
+    Sample sample = metric.samples()[0];
+    ASSERT_EQ("a", sample.labels().at("lb"));
+    values[sample.labels().at("type")] = sample.value();
+  }
+  std::map<std::string, double> expected = {
+    {"int", 1}, {"std::invalid_argument", 2}
+  };
+  ASSERT_EQ(expected, values);
+}
+
+TEST(LabelledCounter, CountExceptionsBoundsTypes) {
+  LabelledCounter counter("test", "Test counter", {"type"});
+  ThrowNumbered<LabelledCounter::MAX_EXCEPTION_TYPES + 1>(&counter);
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(LabelledCounter::MAX_EXCEPTION_TYPES + 1, metrics.size());
+
+  double other = 0;
+  for (const Metric& metric : metrics) {
+    Sample sample = metric.samples()[0];
+    if (sample.labels().at("type") == LabelledCounter::OTHER_EXCEPTION) {
+      other = sample.value();
+    }
+  }
+  ASSERT_EQ(2, other);
+}
@@ -0,0 +1,195 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/features/line_protocol.h"
+#include "promclient/internal/builder_counter.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::LabelledCounterRef;
+
+using promclient::features::LineExporter;
+using promclient::features::LineExporterOptions;
+using promclient::features::LineExporterStats;
+using promclient::internal::LineFormatter;
+
+
+//! Stand-in line receiver bound to a local port.
+class LineReceiver {
+ public:
+  explicit LineReceiver(int type) {
+    this->fd_ = socket(AF_INET, type, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+    socklen_t size = sizeof(address);
+    EXPECT_EQ(0, bind(this->fd_, addr, size));
+    EXPECT_EQ(0, getsockname(this->fd_, addr, &size));
+    this->port_ = std::to_string(ntohs(address.sin_port));
+    if (type == SOCK_STREAM) {
+      EXPECT_EQ(0, listen(this->fd_, 1));
+    }
+
+    struct timeval timeout = {5, 0};
+    setsockopt(
+        this->fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)
+    );
+  }
+
+  ~LineReceiver() {
+    close(this->fd_);
+  }
+
+  //! Accepts a TCP connection and reads `size` bytes from it.
+  std::string accept(std::size_t size) {
+    int client = ::accept(this->fd_, nullptr, nullptr);
+    std::string data;
+    char buffer[4096];
+    while (client != -1 && data.size() < size) {
+      ssize_t read = recv(client, buffer, sizeof(buffer), 0);
+      if (read <= 0) {
+        break;
+      }
+      data.append(buffer, read);
+    }
+    close(client);
+    return data;
+  }
+
+  //! Receives `count` datagrams.
+  std::vector<std::string> datagrams(std::size_t count) {
+    std::vector<std::string> datagrams;
+    char buffer[65536];
+    while (datagrams.size() < count) {
+      ssize_t read = recv(this->fd_, buffer, sizeof(buffer), 0);
+      if (read < 0) {
+        break;
+      }
+      datagrams.emplace_back(buffer, read);
+    }
+    return datagrams;
+  }
+
+  std::string port() {
+    return this->port_;
+  }
+
+ protected:
+  int fd_;
+  std::string port_;
+};
+
+
+class LineExporterTest : public ::testing::Test {
+ public:
+  LineExporterTest() {
+    this->counter_ = promclient::CounterBuilder()
+      .name("test_metric")
+      .help("used for tests")
+      .labels({"index"})
+      .registr(&this->registry_);
+    for (int idx = 0; idx < 20; idx++) {
+      this->counter_->labels({{"index", std::to_string(idx)}})->inc(idx);
+    }
+    this->options_.interval = std::chrono::hours(1);
+  }
+
+ protected:
+  LabelledCounterRef counter_;
+  LineExporterOptions options_;
+  CollectorRegistry registry_;
+};
+
+
+TEST_F(LineExporterTest, InvalidHost) {
+  LineExporter exporter(
+      "host.invalid", "8125", LineFormatter::STATSD, &this->registry_,
+      this->options_
+  );
+  ASSERT_THROW(exporter.push(), std::runtime_error);
+  LineExporterStats stats = exporter.stats();
+  ASSERT_EQ(0u, stats.pushes);
+  ASSERT_EQ(1u, stats.errors);
+}
+
+TEST_F(LineExporterTest, PacksDatagramsToMtu) {
+  LineReceiver receiver(SOCK_DGRAM);
+  this->options_.mtu = 100;
+  LineExporter exporter(
+      "127.0.0.1", receiver.port(), LineFormatter::STATSD,
+      &this->registry_, this->options_
+  );
+  exporter.push();
+  LineExporterStats stats = exporter.stats();
+  ASSERT_EQ(1u, stats.pushes);
+  ASSERT_LT(1u, stats.packets);
+  ASSERT_GT(20u, stats.packets);
+
+  std::string lines;
+  for (const auto& datagram : receiver.datagrams(stats.packets)) {
+    ASSERT_GE(100u, datagram.size());
+    ASSERT_EQ('\n', datagram.back());
+    lines += datagram;
+  }
+  ASSERT_EQ(stats.bytes, lines.size());
+  ASSERT_NE(std::string::npos, lines.find("test_metric:0|c|#index:0\n"));
+  ASSERT_NE(std::string::npos, lines.find("test_metric:19|c|#index:19\n"));
+
+  // Counters are sent as increments.
+  this->counter_->labels({{"index", "3"}})->inc(2);
+  exporter.push();
+  std::size_t packets = exporter.stats().packets - stats.packets;
+  lines = "";
+  for (const auto& datagram : receiver.datagrams(packets)) {
+    lines += datagram;
+  }
+  ASSERT_NE(std::string::npos, lines.find("test_metric:2|c|#index:3\n"));
+  ASSERT_NE(std::string::npos, lines.find("test_metric:0|c|#index:4\n"));
+}
+
+TEST_F(LineExporterTest, GraphiteOverTcp) {
+  LineReceiver receiver(SOCK_STREAM);
+  this->options_.tcp = true;
+  LineExporter exporter(
+      "127.0.0.1", receiver.port(), LineFormatter::GRAPHITE,
+      &this->registry_, this->options_
+  );
+  exporter.push();
+  LineExporterStats stats = exporter.stats();
+  ASSERT_EQ(1u, stats.packets);
+
+  std::string lines = receiver.accept(stats.bytes);
+  ASSERT_EQ(stats.bytes, lines.size());
+  ASSERT_EQ(0u, lines.find("test_metric;index=0 0 "));
+  ASSERT_NE(std::string::npos, lines.find("\ntest_metric;index=19 19 "));
+}
+
+TEST_F(LineExporterTest, StartStop) {
+  LineReceiver receiver(SOCK_DGRAM);
+  this->options_.interval = std::chrono::milliseconds(1);
+  LineExporter exporter(
+      "127.0.0.1", receiver.port(), LineFormatter::INFLUX,
+      &this->registry_, this->options_
+  );
+  exporter.start();
+  ASSERT_THROW(exporter.start(), std::runtime_error);
+  std::vector<std::string> datagrams = receiver.datagrams(1);
+  exporter.stop();
+
+  ASSERT_EQ(1u, datagrams.size());
+  ASSERT_EQ(0u, datagrams[0].find("test_metric,index=0 value=0 "));
+  ASSERT_LE(1u, exporter.stats().pushes);
+}
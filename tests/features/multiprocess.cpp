@@ -0,0 +1,250 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/features/multiprocess.h"
+#include "promclient/metric.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::CounterRef;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::features::LabelledMultiProcessCounterRef;
+using promclient::features::LabelledMultiProcessGaugeRef;
+using promclient::features::MarkProcessDead;
+using promclient::features::MultiProcessCollector;
+using promclient::features::MultiProcessCounterBuilder;
+using promclient::features::MultiProcessGauge;
+using promclient::features::MultiProcessGaugeRef;
+using promclient::features::MultiProcessGaugeBuilder;
+using promclient::features::MultiProcessStore;
+
+
+class MultiProcessTest : public ::testing::Test {
+ public:
+  MultiProcessTest() {
+    char path[] = "/tmp/promclient-mp-XXXXXX";
+    this->directory_ = mkdtemp(path);
+    MultiProcessStore::Configure(this->directory_);
+  }
+
+  ~MultiProcessTest() {
+    std::string command = "rm -rf " + this->directory_;
+    EXPECT_EQ(0, system(command.c_str()));
+  }
+
+  //! Run a function in a child process and wait for it.
+  template<typename Function>
+  pid_t inChild(Function function) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      function();
+      _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_EQ(0, status);
+    return pid;
+  }
+
+ protected:
+  std::string directory_;
+};
+
+
+TEST_F(MultiProcessTest, CollectsFilesMetric) {
+  MultiProcessCollector collector(this->directory_);
+  MetricsList metrics = collector.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ(
+      "promclient_multiprocess_files",
+      metrics[0].descriptor()->name()
+  );
+  ASSERT_EQ(0, metrics[0].samples()[0].value());
+}
+
+TEST_F(MultiProcessTest, AggregatesCounters) {
+  CounterRef counter = MultiProcessCounterBuilder()
+    .name("requests_total")
+    .help("Requests served")
+    .build();
+  counter->inc(2);
+
+  this->inChild([]() {
+    CounterRef counter = MultiProcessCounterBuilder()
+      .name("requests_total")
+      .help("Requests served")
+      .build();
+    counter->inc(3.5);
+  });
+
+  MultiProcessCollector collector(this->directory_);
+  MetricsList metrics = collector.collect();
+  ASSERT_EQ(static_cast<std::size_t>(2), metrics.size());
+  ASSERT_EQ("promclient_multiprocess_files", metrics[1].descriptor()->name());
+  ASSERT_EQ(2, metrics[1].samples()[0].value());
+
+  ASSERT_EQ("requests_total", metrics[0].descriptor()->name());
+  ASSERT_EQ("counter", metrics[0].descriptor()->type());
+  ASSERT_EQ("Requests served", metrics[0].descriptor()->help());
+  ASSERT_EQ(5.5, metrics[0].samples()[0].value());
+}
+
+TEST_F(MultiProcessTest, CollectsByName) {
+  CounterRef counter = MultiProcessCounterBuilder()
+    .name("requests_total")
+    .help("Requests served")
+    .build();
+  counter->inc(2);
+
+  CollectorRegistry registry;
+  registry.registr(std::make_shared<MultiProcessCollector>(this->directory_));
+  MetricsList metrics = registry.collect({"requests_total"});
+  ASSERT_EQ(1u, metrics.size());
+  ASSERT_EQ("requests_total", metrics[0].descriptor()->name());
+  ASSERT_EQ(2, metrics[0].samples()[0].value());
+}
+
+TEST_F(MultiProcessTest, AggregatesLabelledMetrics) {
+  LabelledMultiProcessCounterRef counters = MultiProcessCounterBuilder()
+    .name("events_total")
+    .help("")
+    .labels({"kind"})
+    .build();
+  counters->labels({{"kind", "a"}})->inc();
+  counters->describe();
+
+  this->inChild([&counters]() {
+    counters->labels({{"kind", "a"}})->inc();
+    counters->labels({{"kind", "b"}})->inc(4);
+  });
+
+  MultiProcessCollector collector(this->directory_);
+  MetricsList metrics = collector.collect();
+  ASSERT_EQ(static_cast<std::size_t>(2), metrics.size());
+
+  std::map<std::string, std::string> labels_a = {{"kind", "a"}};
+  std::map<std::string, std::string> labels_b = {{"kind", "b"}};
+  std::vector<Sample> samples = metrics[0].samples();
+  ASSERT_EQ(static_cast<std::size_t>(2), samples.size());
+  ASSERT_EQ(labels_a, samples[0].labels());
+  ASSERT_EQ(2, samples[0].value());
+  ASSERT_EQ(labels_b, samples[1].labels());
+  ASSERT_EQ(4, samples[1].value());
+}
+
+TEST_F(MultiProcessTest, GaugesDefaultToOneSeriesPerProcess) {
+  MultiProcessGaugeRef gauge = MultiProcessGaugeBuilder()
+    .name("in_progress")
+    .help("")
+    .build();
+  gauge->set(3);
+
+  pid_t child = this->inChild([]() {
+    MultiProcessGaugeRef gauge = MultiProcessGaugeBuilder()
+      .name("in_progress")
+      .help("")
+      .build();
+    gauge->set(4);
+  });
+
+  MultiProcessCollector collector(this->directory_);
+  MetricsList metrics = collector.collect();
+  ASSERT_EQ("gauge", metrics[0].descriptor()->type());
+  ASSERT_EQ(1u, metrics[0].descriptor()->labels().count("pid"));
+
+  std::map<std::string, double> values;
+  for (const auto& sample : metrics[0].samples()) {
+    values[sample.labels().at("pid")] = sample.value();
+  }
+  std::map<std::string, double> expected = {
+    {std::to_string(getpid()), 3}, {std::to_string(child), 4}
+  };
+  ASSERT_EQ(expected, values);
+}
+
+TEST_F(MultiProcessTest, GaugeModes) {
+  std::map<MultiProcessGauge::Mode, std::string> names = {
+    {MultiProcessGauge::LIVESUM, "live_sum"},
+    {MultiProcessGauge::MAX, "max"},
+    {MultiProcessGauge::MIN, "min"},
+    {MultiProcessGauge::SUM, "sum"}
+  };
+  auto set = [&names](double value) {
+    for (const auto& pair : names) {
+      MultiProcessGaugeBuilder()
+        .name(pair.second)
+        .help("")
+        .mode(pair.first)
+        .build()->set(value);
+    }
+  };
+  set(3);
+  this->inChild([&set]() { set(4); });
+
+  MultiProcessCollector collector(this->directory_);
+  std::map<std::string, double> values;
+  for (const auto& metric : collector.collect()) {
+    values[metric.descriptor()->name()] = metric.samples()[0].value();
+  }
+  ASSERT_EQ(7, values["live_sum"]);
+  ASSERT_EQ(4, values["max"]);
+  ASSERT_EQ(3, values["min"]);
+  ASSERT_EQ(7, values["sum"]);
+}
+
+TEST_F(MultiProcessTest, MarkProcessDeadDropsLiveGauges) {
+  auto builder = MultiProcessGaugeBuilder()
+    .name("pool_size")
+    .help("")
+    .mode(MultiProcessGauge::LIVESUM)
+    .labels({"pool"});
+  builder.build()->labels({{"pool", "db"}})->set(2);
+  pid_t child = this->inChild([&builder]() {
+    builder.build()->labels({{"pool", "db"}})->set(5);
+  });
+
+  MultiProcessCollector collector(this->directory_);
+  ASSERT_EQ(7, collector.collect()[0].samples()[0].value());
+
+  MarkProcessDead(child);
+  std::string live = this->directory_ + "/promclient_live_" +
+    std::to_string(child) + ".db";
+  ASSERT_NE(0, access(live.c_str(), F_OK));
+  MetricsList metrics = collector.collect();
+  ASSERT_EQ("pool_size", metrics[0].descriptor()->name());
+  ASSERT_EQ(2, metrics[0].samples()[0].value());
+}
+
+TEST_F(MultiProcessTest, ReusedPidContinuesFile) {
+  std::string path = this->directory_ + "/promclient_1.db";
+  {
+    MultiProcessStore store(path, 2);
+    store.value("requests_total", "counter", "", {})->add(3);
+  }
+
+  MultiProcessStore store(path, 4);
+  ASSERT_EQ(3, store.value("requests_total", "counter", "", {})->load());
+  store.value("requests_total", "counter", "", {})->add(1);
+  store.value("errors_total", "counter", "", {})->add(2);
+  store.value("retries_total", "counter", "", {})->add(1);
+
+  std::map<std::string, double> values;
+  MultiProcessCollector collector(this->directory_);
+  for (const auto& metric : collector.collect()) {
+    values[metric.descriptor()->name()] = metric.samples()[0].value();
+  }
+  ASSERT_EQ(4, values["requests_total"]);
+  ASSERT_EQ(2, values["errors_total"]);
+  ASSERT_EQ(1, values["retries_total"]);
+}
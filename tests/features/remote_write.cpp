@@ -0,0 +1,274 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/features/remote_write.h"
+#include "promclient/internal/builder_counter.h"
+#include "promclient/internal/snappy.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::CounterRef;
+
+using promclient::features::RemoteWriteExporter;
+using promclient::features::RemoteWriteOptions;
+using promclient::features::RemoteWriteStats;
+using promclient::internal::SnappyUncompress;
+
+
+//! Stand-in remote write receiver on a local port.
+/*!
+ * Replies to each request with the next queued status (204 when
+ * there are none) and keeps the requests it received.
+ */
+class Receiver {
+ public:
+  Receiver() {
+    this->fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+    socklen_t size = sizeof(address);
+    EXPECT_EQ(0, bind(this->fd_, addr, size));
+    EXPECT_EQ(0, listen(this->fd_, 16));
+    EXPECT_EQ(0, getsockname(this->fd_, addr, &size));
+    this->port_ = ntohs(address.sin_port);
+    this->server_ = std::thread(&Receiver::serve, this);
+  }
+
+  ~Receiver() {
+    shutdown(this->fd_, SHUT_RDWR);
+    this->server_.join();
+    close(this->fd_);
+  }
+
+  //! Queues the status of a future response.
+  void reply(int status) {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->statuses_.push_back(status);
+  }
+
+  //! Waits (up to 5 seconds) for `count` requests and returns them all.
+  std::vector<std::string> requests(std::size_t count) {
+    std::unique_lock<std::mutex> lock(this->lock_);
+    this->received_.wait_for(lock, std::chrono::seconds(5), [&]() {
+      return this->requests_.size() >= count;
+    });
+    return this->requests_;
+  }
+
+  std::string url() {
+    return "http://127.0.0.1:" + std::to_string(this->port_) + "/write";
+  }
+
+ protected:
+  int fd_;
+  int port_;
+  std::thread server_;
+
+  std::mutex lock_;
+  std::condition_variable received_;
+  std::vector<std::string> requests_;
+  std::deque<int> statuses_;
+
+  void serve() {
+    while (true) {
+      int client = accept(this->fd_, nullptr, nullptr);
+      if (client == -1) {
+        return;
+      }
+      std::string request = this->read(client);
+      int status = 204;
+      {
+        std::lock_guard<std::mutex> lock(this->lock_);
+        if (!this->statuses_.empty()) {
+          status = this->statuses_.front();
+          this->statuses_.pop_front();
+        }
+        this->requests_.push_back(request);
+      }
+      this->received_.notify_all();
+
+      std::string response = "HTTP/1.1 " + std::to_string(status) +
+        " Status\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      EXPECT_EQ(
+          static_cast<ssize_t>(response.size()),
+          write(client, response.data(), response.size())
+      );
+      close(client);
+    }
+  }
+
+  //! Reads the headers and the Content-Length bytes of the body.
+  std::string read(int client) {
+    std::string request;
+    char buffer[4096];
+    std::size_t end = std::string::npos;
+    std::size_t length = 0;
+    while (end == std::string::npos || request.size() < end + 4 + length) {
+      ssize_t size = recv(client, buffer, sizeof(buffer), 0);
+      if (size <= 0) {
+        break;
+      }
+      request.append(buffer, size);
+      if (end == std::string::npos) {
+        end = request.find("\r\n\r\n");
+        std::size_t header = request.find("Content-Length: ");
+        if (end != std::string::npos && header != std::string::npos) {
+          length = std::strtoul(request.c_str() + header + 16, nullptr, 10);
+        }
+      }
+    }
+    return request;
+  }
+};
+
+
+class RemoteWriteTest : public ::testing::Test {
+ public:
+  RemoteWriteTest() {
+    this->counter_ = promclient::CounterBuilder()
+      .name("test_metric")
+      .help("used for tests")
+      .registr(&this->registry_);
+    this->counter_->inc(2);
+
+    // Do not wait on snapshots or backoff in tests.
+    this->options_.interval = std::chrono::hours(1);
+    this->options_.min_backoff = std::chrono::milliseconds(1);
+    this->options_.timeout = std::chrono::seconds(5);
+  }
+
+ protected:
+  CounterRef counter_;
+  RemoteWriteOptions options_;
+  Receiver receiver_;
+  CollectorRegistry registry_;
+
+  //! Returns the uncompressed body of a request.
+  std::string body(const std::string& request) {
+    return SnappyUncompress(request.substr(request.find("\r\n\r\n") + 4));
+  }
+};
+
+
+TEST_F(RemoteWriteTest, InvalidUrl) {
+  ASSERT_THROW(
+      RemoteWriteExporter("https://example.com/write", &this->registry_),
+      std::runtime_error
+  );
+  ASSERT_THROW(
+      RemoteWriteExporter("http:///write", &this->registry_),
+      std::runtime_error
+  );
+}
+
+TEST_F(RemoteWriteTest, PushSendsWriteRequest) {
+  RemoteWriteExporter exporter(
+      this->receiver_.url(), &this->registry_, this->options_
+  );
+  exporter.start();
+  exporter.push();
+  std::vector<std::string> requests = this->receiver_.requests(1);
+  exporter.stop();
+
+  ASSERT_EQ(1u, requests.size());
+  const std::string& request = requests[0];
+  ASSERT_EQ(0u, request.find("POST /write HTTP/1.1\r\n"));
+  ASSERT_NE(std::string::npos, request.find("Content-Encoding: snappy\r\n"));
+  ASSERT_NE(
+      std::string::npos,
+      request.find("X-Prometheus-Remote-Write-Version: 0.1.0\r\n")
+  );
+
+  std::string body = this->body(request);
+  ASSERT_EQ('\x0a', body[0]);
+  ASSERT_NE(std::string::npos, body.find("__name__"));
+  ASSERT_NE(std::string::npos, body.find("test_metric"));
+
+  RemoteWriteStats stats = exporter.stats();
+  ASSERT_EQ(1u, stats.sent);
+  ASSERT_EQ(0u, stats.failed);
+}
+
+TEST_F(RemoteWriteTest, BatchesBySize) {
+  this->options_.max_samples_per_send = 1;
+  promclient::CounterBuilder()
+    .name("other_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+
+  RemoteWriteExporter exporter(
+      this->receiver_.url(), &this->registry_, this->options_
+  );
+  exporter.push();
+  exporter.start();
+  std::vector<std::string> requests = this->receiver_.requests(2);
+  exporter.stop();
+  ASSERT_EQ(2u, requests.size());
+  ASSERT_EQ(2u, exporter.stats().sent);
+}
+
+TEST_F(RemoteWriteTest, RetriesServerErrors) {
+  this->receiver_.reply(503);
+  this->receiver_.reply(429);
+  RemoteWriteExporter exporter(
+      this->receiver_.url(), &this->registry_, this->options_
+  );
+  exporter.start();
+  exporter.push();
+  std::vector<std::string> requests = this->receiver_.requests(3);
+  exporter.stop();
+
+  ASSERT_EQ(3u, requests.size());
+  RemoteWriteStats stats = exporter.stats();
+  ASSERT_EQ(1u, stats.sent);
+  ASSERT_EQ(2u, stats.retries);
+}
+
+TEST_F(RemoteWriteTest, DropsClientErrors) {
+  this->receiver_.reply(400);
+  RemoteWriteExporter exporter(
+      this->receiver_.url(), &this->registry_, this->options_
+  );
+  exporter.start();
+  exporter.push();
+  this->receiver_.requests(1);
+  exporter.stop();
+
+  RemoteWriteStats stats = exporter.stats();
+  ASSERT_EQ(0u, stats.sent);
+  ASSERT_EQ(1u, stats.failed);
+  ASSERT_EQ(0u, stats.retries);
+}
+
+TEST_F(RemoteWriteTest, QueueCapacity) {
+  this->options_.capacity = 1;
+  promclient::CounterBuilder()
+    .name("other_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+
+  RemoteWriteExporter exporter(
+      this->receiver_.url(), &this->registry_, this->options_
+  );
+  exporter.push();
+  ASSERT_EQ(1u, exporter.stats().dropped);
+}
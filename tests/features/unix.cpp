@@ -0,0 +1,175 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/features/unix.h"
+#include "promclient/internal/builder_counter.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::CounterRef;
+
+using promclient::features::TextFileExporter;
+using promclient::features::UnixSocketExporter;
+
+
+class UnixExportersTest : public ::testing::Test {
+ public:
+  UnixExportersTest() {
+    char path[] = "/tmp/promclient-unix-XXXXXX";
+    this->directory_ = mkdtemp(path);
+    this->counter_ = promclient::CounterBuilder()
+      .name("test_metric")
+      .help("used for tests")
+      .registr(&this->registry_);
+    this->counter_->inc(2);
+  }
+
+  ~UnixExportersTest() {
+    std::string command = "rm -rf " + this->directory_;
+    EXPECT_EQ(0, system(command.c_str()));
+  }
+
+ protected:
+  CounterRef counter_;
+  std::string directory_;
+  CollectorRegistry registry_;
+
+  std::string expected(double value) {
+    std::stringstream expected;
+    expected << "# HELP test_metric used for tests\n";
+    expected << "# TYPE test_metric counter\n";
+    expected << "test_metric " << value << ".0000000000000000e+00\n";
+    return expected.str();
+  }
+
+  //! Reads the whole content of a file.
+  std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  //! Connects to a Unix socket and reads until it is closed.
+  std::string readSocket(const std::string& path) {
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+    EXPECT_EQ(0, connect(fd, addr, sizeof(address)));
+
+    std::string content;
+    char buffer[1024];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+      content.append(buffer, size);
+    }
+    close(fd);
+    return content;
+  }
+};
+
+
+TEST_F(UnixExportersTest, SocketServesClients) {
+  std::string path = this->directory_ + "/metrics.sock";
+  UnixSocketExporter exporter(path, &this->registry_);
+  exporter.mount();
+  ASSERT_EQ(path, exporter.endpoint());
+  std::thread server([&exporter]() { exporter.listen(); });
+
+  ASSERT_EQ(this->expected(2), this->readSocket(path));
+  this->counter_->inc();
+  ASSERT_EQ(this->expected(3), this->readSocket(path));
+
+  exporter.stop();
+  server.join();
+}
+
+TEST_F(UnixExportersTest, SocketDropsStuckClients) {
+  // Large enough to fill the socket buffers of a client not reading.
+  auto labelled = promclient::CounterBuilder()
+    .name("test_large")
+    .help("used for tests")
+    .labels({"index"})
+    .registr(&this->registry_);
+  for (int idx = 0; idx < 20000; idx++) {
+    labelled->labels({{"index", std::to_string(idx)}})->inc();
+  }
+
+  std::string path = this->directory_ + "/metrics.sock";
+  UnixSocketExporter exporter(
+      path, &this->registry_,
+      promclient::internal::TextFormatter::Format::PROMETHEUS,
+      std::chrono::milliseconds(50)
+  );
+  exporter.mount();
+  std::thread server([&exporter]() { exporter.listen(); });
+
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  int stuck = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&address);
+  ASSERT_EQ(0, connect(stuck, addr, sizeof(address)));
+
+  std::string content = this->readSocket(path);
+  ASSERT_NE(std::string::npos, content.find("test_large{index=\"19999\"}"));
+  close(stuck);
+  exporter.stop();
+  server.join();
+}
+
+TEST_F(UnixExportersTest, SocketNeedsMount) {
+  UnixSocketExporter exporter(this->directory_ + "/metrics.sock");
+  ASSERT_THROW(exporter.listen(), std::runtime_error);
+}
+
+TEST_F(UnixExportersTest, TextFileWrite) {
+  std::string path = this->directory_ + "/metrics.prom";
+  TextFileExporter exporter(path, &this->registry_);
+  exporter.write();
+  ASSERT_EQ(this->expected(2), this->readFile(path));
+  ASSERT_NE(0, access((path + ".tmp").c_str(), F_OK));
+}
+
+TEST_F(UnixExportersTest, TextFileWriteFails) {
+  TextFileExporter exporter(
+      this->directory_ + "/missing/metrics.prom", &this->registry_
+  );
+  ASSERT_THROW(exporter.write(), std::runtime_error);
+}
+
+TEST_F(UnixExportersTest, TextFileBackgroundWrites) {
+  std::string path = this->directory_ + "/metrics.prom";
+  TextFileExporter exporter(path, &this->registry_);
+  exporter.start(std::chrono::milliseconds(1));
+  ASSERT_EQ(this->expected(2), this->readFile(path));
+
+  this->counter_->inc();
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    if (this->readFile(path) == this->expected(3)) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  exporter.stop();
+  ASSERT_EQ(this->expected(3), this->readFile(path));
+}
@@ -0,0 +1,112 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "promclient/func.h"
+#include "promclient/metric.h"
+
+
+using promclient::CounterFunc;
+using promclient::GaugeFunc;
+using promclient::LabelledCounterFunc;
+using promclient::LabelledGaugeFunc;
+using promclient::LabelledValues;
+
+using promclient::DescriptorRef;
+using promclient::DescriptorsList;
+using promclient::MetricsList;
+using promclient::Sample;
+
+
+TEST(CounterFunc, Describe) {
+  CounterFunc counter("test", "Test counter", []() { return 0; });
+  DescriptorsList descriptors = counter.describe();
+  ASSERT_EQ(1u, descriptors.size());
+  ASSERT_EQ("test", descriptors[0]->name());
+  ASSERT_EQ("counter", descriptors[0]->type());
+}
+
+TEST(CounterFunc, CollectCallsFunc) {
+  int calls = 0;
+  CounterFunc counter("test", "Test counter", [&calls]() {
+    calls += 1;
+    return calls * 10;
+  });
+  ASSERT_EQ(0, calls);
+
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(1, calls);
+  ASSERT_EQ(10, metrics[0].samples()[0].value());
+  metrics = counter.collect();
+  ASSERT_EQ(20, metrics[0].samples()[0].value());
+}
+
+TEST(GaugeFunc, Collect) {
+  double depth = 4;
+  GaugeFunc gauge("test", "Test gauge", [&depth]() { return depth; });
+  depth = 2;
+  MetricsList metrics = gauge.collect();
+  ASSERT_EQ("gauge", metrics[0].descriptor()->type());
+  ASSERT_EQ(2, metrics[0].samples()[0].value());
+}
+
+
+TEST(LabelledGaugeFunc, Describe) {
+  LabelledGaugeFunc gauge("test", "Test gauge", {"pool"}, []() {
+    return LabelledValues();
+  });
+  DescriptorsList descriptors = gauge.describe();
+  std::set<std::string> labels = {"pool"};
+  ASSERT_EQ(2u, descriptors.size());
+  ASSERT_EQ("gauge", descriptors[0]->type());
+  ASSERT_EQ(labels, descriptors[0]->labels());
+}
+
+TEST(LabelledGaugeFunc, CollectEnumeratesChildren) {
+  LabelledValues values = {
+    {{{"pool", "db"}}, 3},
+    {{{"pool", "http"}}, 7}
+  };
+  LabelledGaugeFunc gauge("test", "Test gauge", {"pool"}, [&values]() {
+    return values;
+  });
+
+  MetricsList metrics = gauge.collect();
+  ASSERT_EQ(2u, metrics.size());
+  ASSERT_EQ(2u, metrics[0].samples().size());
+  ASSERT_EQ("db", metrics[0].samples()[0].labels().at("pool"));
+  ASSERT_EQ(3, metrics[0].samples()[0].value());
+  ASSERT_EQ("http", metrics[0].samples()[1].labels().at("pool"));
+  ASSERT_EQ(7, metrics[0].samples()[1].value());
+
+  values.erase({{"pool", "db"}});
+  metrics = gauge.collect();
+  ASSERT_EQ(1u, metrics[0].samples().size());
+}
+
+TEST(LabelledCounterFunc, CollectDropsInvalidLabels) {
+  LabelledValues values = {
+    {{{"other", "a"}}, 1},
+    {{{"lb", "a"}, {"other", "a"}}, 2},
+    {{{"lb", "\xc3\x28"}}, 3},
+    {{{"lb", "caf\xc3\xa9"}}, 4}
+  };
+  LabelledCounterFunc counter("test", "Test", {"lb"}, [&values]() {
+    return values;
+  });
+
+  MetricsList metrics = counter.collect();
+  ASSERT_EQ(2u, metrics.size());
+  ASSERT_EQ(1u, metrics[0].samples().size());
+  ASSERT_EQ("caf\xc3\xa9", metrics[0].samples()[0].labels().at("lb"));
+  ASSERT_EQ(4, metrics[0].samples()[0].value());
+
+  ASSERT_EQ(
+      "promclient_invalid_label_sets_total", metrics[1].descriptor()->name()
+  );
+  ASSERT_EQ("test", metrics[1].samples()[0].labels().at("metric"));
+  ASSERT_EQ(3, metrics[1].samples()[0].value());
+}
@@ -1,7 +1,12 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <thread>
+#include <utility>
+
 #include "promclient/gauge.h"
+#include "promclient/timer.h"
 
 
 using promclient::Gauge;
@@ -14,6 +19,9 @@ using promclient::Metric;
 using promclient::MetricsList;
 using promclient::Sample;
 
+using promclient::Clock;
+using promclient::Timer;
+
 
 class GaugeTest : public ::testing::Test {
  public:
@@ -95,6 +103,55 @@ TEST_F(GaugeTest, OverridesValue) {
   ASSERT_EQ(33, this->collect());
 }
 
+TEST_F(GaugeTest, SetToCurrentTime) {
+  this->gauge_.setToCurrentTime();
+  MetricsList metrics = this->gauge_.collect();
+  ASSERT_NEAR(Clock::WallTime(), metrics[0].samples()[0].value(), 1);
+}
+
+TEST_F(GaugeTest, TimeOnDestruction) {
+  {
+    Timer<Gauge> timer = this->gauge_.time();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  MetricsList metrics = this->gauge_.collect();
+  double value = metrics[0].samples()[0].value();
+  ASSERT_LE(0.005, value);
+  ASSERT_GT(1.0, value);
+}
+
+TEST_F(GaugeTest, TimeRecordsOnce) {
+  Timer<Gauge> timer = this->gauge_.time();
+  double elapsed = timer.stop();
+  this->gauge_.set(42);
+  ASSERT_EQ(0, timer.stop());
+
+  MetricsList metrics = this->gauge_.collect();
+  ASSERT_LE(0, elapsed);
+  ASSERT_EQ(42, metrics[0].samples()[0].value());
+}
+
+TEST_F(GaugeTest, TrackInProgress) {
+  {
+    Gauge::InProgress first = this->gauge_.trackInProgress();
+    Gauge::InProgress second = this->gauge_.trackInProgress();
+    ASSERT_EQ(2, this->collect());
+  }
+  ASSERT_EQ(0, this->collect());
+}
+
+TEST_F(GaugeTest, TrackInProgressMoved) {
+  {
+    Gauge::InProgress moved = this->gauge_.trackInProgress();
+    {
+      Gauge::InProgress guard(std::move(moved));
+      ASSERT_EQ(1, this->collect());
+    }
+    ASSERT_EQ(0, this->collect());
+  }
+  ASSERT_EQ(0, this->collect());
+}
+
 
 class LabelledGaugeTest : public ::testing::Test {
  public:
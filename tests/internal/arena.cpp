@@ -0,0 +1,62 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "promclient/internal/arena.h"
+
+
+using promclient::internal::Arena;
+using promclient::internal::ArenaAllocator;
+
+
+TEST(Arena, AllocationsAreAligned) {
+  Arena arena(128);
+  arena.allocate(1, 1);
+  void* ptr = arena.allocate(8, 8);
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(ptr) % 8);
+}
+
+TEST(Arena, AllocationsDoNotOverlap) {
+  Arena arena(128);
+  char* first = static_cast<char*>(arena.allocate(16, 1));
+  char* second = static_cast<char*>(arena.allocate(16, 1));
+  ASSERT_TRUE(second >= first + 16 || first >= second + 16);
+}
+
+TEST(Arena, LargeAllocations) {
+  Arena arena(16);
+  char* data = static_cast<char*>(arena.allocate(1024, 8));
+  data[0] = 'a';
+  data[1023] = 'z';
+  ASSERT_EQ('z', data[1023]);
+}
+
+TEST(Arena, ResetReusesFirstBlock) {
+  Arena arena(128);
+  void* first = arena.allocate(16, 8);
+  arena.allocate(1024, 8);
+  arena.reset();
+  ASSERT_EQ(first, arena.allocate(16, 8));
+}
+
+TEST(ArenaAllocator, WorksWithContainers) {
+  Arena arena(256);
+  ArenaAllocator<int> allocator(&arena);
+  std::vector<int, ArenaAllocator<int>> values(allocator);
+  for (int idx = 0; idx < 100; idx++) {
+    values.push_back(idx);
+  }
+  ASSERT_EQ(100u, values.size());
+  ASSERT_EQ(99, values[99]);
+
+  typedef std::pair<const std::string, int> Pair;
+  std::map<std::string, int, std::less<std::string>, ArenaAllocator<Pair>>
+    names((ArenaAllocator<Pair>(&arena)));
+  names["b"] = 2;
+  names["a"] = 1;
+  ASSERT_EQ("a", names.begin()->first);
+}
@@ -0,0 +1,93 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "promclient/internal/atomic_double.h"
+
+
+using promclient::internal::AtomicDouble;
+
+
+TEST(AtomicDouble, StartsAtInitial) {
+  AtomicDouble value(4.5);
+  ASSERT_EQ(4.5, value.load());
+}
+
+TEST(AtomicDouble, AddWhole) {
+  AtomicDouble value;
+  value.add(40);
+  value.add(2);
+  ASSERT_EQ(42, value.load());
+}
+
+TEST(AtomicDouble, AddFraction) {
+  AtomicDouble value;
+  value.add(0.5);
+  value.add(0.25);
+  ASSERT_EQ(0.75, value.load());
+}
+
+TEST(AtomicDouble, AddMixed) {
+  AtomicDouble value(0.5);
+  value.add(2);
+  value.add(-0.25);
+  value.add(-3);
+  ASSERT_EQ(-0.75, value.load());
+}
+
+TEST(AtomicDouble, AddLarge) {
+  AtomicDouble value;
+  value.add(1e300);
+  value.add(1);
+  ASSERT_EQ(1e300, value.load());
+}
+
+TEST(AtomicDouble, StoreReplacesValue) {
+  AtomicDouble value;
+  value.add(40);
+  value.add(0.5);
+  value.store(3.25);
+  ASSERT_EQ(3.25, value.load());
+  value.add(1);
+  ASSERT_EQ(4.25, value.load());
+}
+
+TEST(AtomicDouble, ConcurrentAdds) {
+  AtomicDouble value;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; thread++) {
+    threads.push_back(std::thread([&value]() {
+      for (int idx = 0; idx < 10000; idx++) {
+        value.add(1);
+        value.add(0.5);
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(60000, value.load());
+}
+
+TEST(AtomicDouble, StoresAreNeverMixed) {
+  AtomicDouble value(1);
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    for (int idx = 0; idx < 100000; idx++) {
+      value.add(1000);
+      value.add(0.5);
+      value.store(5);
+      value.store(1);
+    }
+    done = true;
+  });
+  while (!done) {
+    double seen = value.load();
+    ASSERT_TRUE(seen == 1 || seen == 1001 || seen == 1001.5 || seen == 5)
+      << seen;
+  }
+  writer.join();
+}
@@ -1,6 +1,7 @@
 // Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
 #include <gtest/gtest.h>
 
+#include <iterator>
 #include <set>
 #include <string>
 #include <vector>
@@ -39,7 +40,7 @@ using promclient::internal::SimpleLabelledBuilder;
 class TestRegistry : public CollectorRegistry {
  public:
   CollectorRef getCollector(int idx) {
-    return this->collectors_[idx];
+    return *std::next(this->collectors_.begin(), idx);
   }
 };
 
@@ -159,6 +160,19 @@ TEST(SimpleLabelledBuilder, Build) {
   ASSERT_EQ(expected_values, sample.labels());
 }
 
+TEST(SimpleLabelledBuilder, Cardinality) {
+  SimpleLabelledBuilder<LabelledCounter> builder;
+  LabelledCounterRef counters = builder.name("test_name").help(
+      "used for testing"
+  ).labels({"lb1"}).cardinality(1).build();
+
+  CounterRef counter1 = counters->labels({{"lb1", "val1"}});
+  CounterRef counter2 = counters->labels({{"lb1", "val2"}});
+  CounterRef counter3 = counters->labels({{"lb1", "val3"}});
+  ASSERT_NE(counter1, counter2);
+  ASSERT_EQ(counter2, counter3);
+}
+
 TEST(SimpleLabelledBuilder, Register) {
   TestRegistry registry;
   SimpleLabelledBuilder<LabelledCounter> builder;
@@ -0,0 +1,99 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/exceptions.h"
+#include "promclient/func.h"
+#include "promclient/internal/builder_func.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::DescriptorsList;
+using promclient::MetricsList;
+
+using promclient::CounterFuncBuilder;
+using promclient::CounterFuncRef;
+using promclient::GaugeFuncBuilder;
+using promclient::GaugeFuncRef;
+using promclient::LabelledGaugeFuncRef;
+using promclient::LabelledValues;
+
+using promclient::HelplessCollector;
+using promclient::MissingCollectorFunc;
+using promclient::MissingCollectorLabels;
+using promclient::NamelessCollector;
+
+
+TEST(FuncBuilder, Build) {
+  CounterFuncRef counter = CounterFuncBuilder().name("test_name").help(
+      "used for testing"
+  ).func([]() { return 42; }).build();
+  MetricsList metrics = counter->collect();
+  ASSERT_EQ("test_name", metrics[0].descriptor()->name());
+  ASSERT_EQ("counter", metrics[0].descriptor()->type());
+  ASSERT_EQ(42, metrics[0].samples()[0].value());
+}
+
+TEST(FuncBuilder, FuncMustBeSet) {
+  ASSERT_THROW(
+      GaugeFuncBuilder().name("test_name").help("").build(),
+      MissingCollectorFunc
+  );
+}
+
+TEST(FuncBuilder, HelpMustBeSet) {
+  ASSERT_THROW(
+      GaugeFuncBuilder().name("test_name").func([]() { return 1; }).build(),
+      HelplessCollector
+  );
+}
+
+TEST(FuncBuilder, NameMustBeSet) {
+  ASSERT_THROW(
+      GaugeFuncBuilder().help("").func([]() { return 1; }).build(),
+      NamelessCollector
+  );
+}
+
+TEST(FuncBuilder, Register) {
+  CollectorRegistry registry;
+  GaugeFuncRef gauge = GaugeFuncBuilder().name("test_name").help(
+      "used for testing"
+  ).func([]() { return 1; }).registr(&registry);
+  MetricsList metrics = registry.collect();
+  ASSERT_EQ(1u, metrics.size());
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+}
+
+
+TEST(FuncLabelledBuilder, Build) {
+  std::set<std::string> labels = {"pool"};
+  LabelledGaugeFuncRef gauge = GaugeFuncBuilder().name("test_name").help(
+      "used for testing"
+  ).labels({"pool"}).func([]() {
+    return LabelledValues({{{{"pool", "db"}}, 3}});
+  }).build();
+
+  DescriptorsList descriptors = gauge->describe();
+  ASSERT_EQ(labels, descriptors[0]->labels());
+  MetricsList metrics = gauge->collect();
+  ASSERT_EQ(3, metrics[0].samples()[0].value());
+}
+
+TEST(FuncLabelledBuilder, FuncMustBeSet) {
+  ASSERT_THROW(
+      GaugeFuncBuilder().name("test_name").help("").labels({"lb"}).build(),
+      MissingCollectorFunc
+  );
+}
+
+TEST(FuncLabelledBuilder, LabelsMustBeSet) {
+  ASSERT_THROW(
+      GaugeFuncBuilder().name("test_name").help("").labels({}),
+      MissingCollectorLabels
+  );
+}
@@ -0,0 +1,67 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "promclient/internal/clock.h"
+
+using promclient::internal::Clock;
+
+
+class ClockTest : public ::testing::Test {
+ public:
+  ~ClockTest() {
+    Clock::Configure(Clock::Source::STEADY);
+  }
+
+  //! Checks a source is monotonic and measures a 20ms sleep.
+  void assertMeasures() {
+    std::uint64_t start = Clock::Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::uint64_t end = Clock::Now();
+    ASSERT_LE(start, end);
+
+    // Coarse clocks can be up to a tick (10ms) behind.
+    double elapsed = Clock::Elapsed(start, end);
+    ASSERT_LE(0.009, elapsed);
+    ASSERT_GT(1.0, elapsed);
+  }
+};
+
+TEST_F(ClockTest, DefaultsToSteady) {
+  ASSERT_EQ(Clock::Source::STEADY, Clock::Current());
+}
+
+TEST_F(ClockTest, ElapsedCanBeNegative) {
+  ASSERT_EQ(-1, Clock::Elapsed(1000000000, 0));
+}
+
+TEST_F(ClockTest, ConfigureReturnsSelectedSource) {
+  Clock::Source coarse = Clock::Configure(Clock::Source::COARSE);
+  ASSERT_EQ(coarse, Clock::Current());
+  Clock::Source tsc = Clock::Configure(Clock::Source::TSC);
+  ASSERT_EQ(tsc, Clock::Current());
+}
+
+TEST_F(ClockTest, MeasuresCoarse) {
+  Clock::Configure(Clock::Source::COARSE);
+  this->assertMeasures();
+}
+
+TEST_F(ClockTest, MeasuresSteady) {
+  Clock::Configure(Clock::Source::STEADY);
+  this->assertMeasures();
+}
+
+TEST_F(ClockTest, MeasuresTsc) {
+  Clock::Configure(Clock::Source::TSC);
+  this->assertMeasures();
+}
+
+TEST_F(ClockTest, WallTime) {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  double expected = std::chrono::duration<double>(now).count();
+  ASSERT_NEAR(expected, Clock::WallTime(), 1);
+}
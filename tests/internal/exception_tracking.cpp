@@ -0,0 +1,89 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "promclient/internal/exception_tracking.h"
+
+using promclient::internal::CatchExceptions;
+using promclient::internal::CurrentExceptionType;
+using promclient::internal::TypeName;
+using promclient::internal::UncaughtExceptions;
+
+
+//! Records the uncaught exceptions count when destroyed.
+class UnwindProbe {
+ public:
+  explicit UnwindProbe(int* count) : count_(count) {
+    // Noop.
+  }
+
+  ~UnwindProbe() {
+    *this->count_ = UncaughtExceptions();
+  }
+
+ protected:
+  int* count_;
+};
+
+
+TEST(CatchExceptions, CallsHandlerForMatchingType) {
+  int handled = 0;
+  auto handler = [&handled]() { handled += 1; };
+  auto fail = []() -> int { throw std::invalid_argument("test"); };
+
+  ASSERT_THROW(
+      CatchExceptions<std::logic_error>::Call(fail, handler),
+      std::invalid_argument
+  );
+  ASSERT_EQ(1, handled);
+  ASSERT_THROW(
+      CatchExceptions<std::runtime_error>::Call(fail, handler),
+      std::invalid_argument
+  );
+  ASSERT_EQ(1, handled);
+}
+
+TEST(CatchExceptions, VoidHandlesAnyType) {
+  int handled = 0;
+  auto handler = [&handled]() { handled += 1; };
+  ASSERT_THROW(
+      CatchExceptions<void>::Call([]() { throw 42; }, handler), int
+  );
+  ASSERT_EQ(1, handled);
+}
+
+TEST(CatchExceptions, ReturnsResult) {
+  int handled = 0;
+  auto handler = [&handled]() { handled += 1; };
+  ASSERT_EQ(42, CatchExceptions<void>::Call([]() { return 42; }, handler));
+  ASSERT_EQ(0, handled);
+}
+
+TEST(CurrentExceptionType, OfHandledException) {
+  ASSERT_EQ(nullptr, CurrentExceptionType());
+  try {
+    throw std::runtime_error("test");
+  } catch (...) {
+    ASSERT_NE(nullptr, CurrentExceptionType());
+    ASSERT_EQ("std::runtime_error", TypeName(*CurrentExceptionType()));
+  }
+}
+
+TEST(TypeName, Demangles) {
+  ASSERT_EQ("std::invalid_argument", TypeName(typeid(std::invalid_argument)));
+  ASSERT_EQ("int", TypeName(typeid(int)));
+}
+
+TEST(UncaughtExceptions, CountsUnwinding) {
+  int count = -1;
+  ASSERT_EQ(0, UncaughtExceptions());
+  try {
+    UnwindProbe probe(&count);
+    throw std::runtime_error("test");
+  } catch (...) {
+    ASSERT_EQ(0, UncaughtExceptions());
+  }
+  ASSERT_EQ(1, count);
+}
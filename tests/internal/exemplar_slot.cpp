@@ -0,0 +1,86 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+#include "promclient/internal/exemplar_slot.h"
+
+
+using promclient::ExemplarRef;
+using promclient::InvalidExemplar;
+using promclient::internal::ExemplarSlot;
+
+
+TEST(ExemplarSlot, StartsEmpty) {
+  ExemplarSlot slot;
+  ASSERT_EQ(nullptr, slot.load());
+}
+
+TEST(ExemplarSlot, StoreAndLoad) {
+  ExemplarSlot slot;
+  std::map<std::string, std::string> labels = {
+    {"span_id", "b7ad6b7169203331"},
+    {"trace_id", "0af7651916cd43dd8448eb211c80319c"}
+  };
+  ASSERT_TRUE(slot.store(labels, 2.5, 1520879607.789));
+
+  ExemplarRef exemplar = slot.load();
+  ASSERT_NE(nullptr, exemplar);
+  ASSERT_EQ(labels, exemplar->labels());
+  ASSERT_EQ(2.5, exemplar->value());
+  ASSERT_EQ(1520879607.789, exemplar->timestamp());
+}
+
+TEST(ExemplarSlot, LatestWins) {
+  ExemplarSlot slot;
+  slot.store({{"trace_id", "a"}}, 1, 1);
+  slot.store({{"trace_id", "b"}}, 2, 2);
+  ExemplarRef exemplar = slot.load();
+  ASSERT_EQ("b", exemplar->labels().at("trace_id"));
+  ASSERT_EQ(2, exemplar->value());
+}
+
+TEST(ExemplarSlot, EmptyLabels) {
+  ExemplarSlot slot;
+  slot.store({}, 1, 1);
+  ASSERT_EQ(static_cast<std::size_t>(0), slot.load()->labels().size());
+}
+
+TEST(ExemplarSlot, LongLabelsFail) {
+  ExemplarSlot slot;
+  std::string value(ExemplarSlot::MAX_LABELS_LENGTH, 'a');
+  ASSERT_THROW(slot.store({{"trace_id", value}}, 1, 1), InvalidExemplar);
+  ASSERT_EQ(nullptr, slot.load());
+}
+
+TEST(ExemplarSlot, LoadsAreConsistent) {
+  ExemplarSlot slot;
+  std::atomic<bool> stop(false);
+  std::thread writer([&slot, &stop]() {
+    double count = 0;
+    while (!stop.load()) {
+      count += 1;
+      std::string id = std::to_string(static_cast<long>(count));
+      slot.store({{"id", id}, {"padding", std::string(60, 'x')}}, count, 0);
+    }
+  });
+
+  // Stop the writer before asserting so it is always joined.
+  bool consistent = true;
+  for (int idx = 0; idx < 10000 && consistent; idx++) {
+    ExemplarRef exemplar = slot.load();
+    if (exemplar) {
+      std::string id = std::to_string(static_cast<long>(exemplar->value()));
+      consistent = exemplar->labels().at("id") == id;
+    }
+  }
+
+  stop = true;
+  writer.join();
+  ASSERT_TRUE(consistent);
+}
@@ -0,0 +1,165 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <string>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/metric.h"
+#include "promclient/internal/builder_counter.h"
+#include "promclient/internal/line_formatter.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::CounterRef;
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::Sample;
+
+using promclient::internal::LineFormatBridge;
+using promclient::internal::LineFormatter;
+
+
+class LineFormatterTest : public ::testing::Test {
+ public:
+  LineFormatterTest()
+    : counter(new Descriptor("requests_total", "counter", "", {"code"})),
+      gauge(new Descriptor("temperature", "gauge", "", {"room"})),
+      graphite(LineFormatter::Protocol::GRAPHITE),
+      influx(LineFormatter::Protocol::INFLUX),
+      statsd(LineFormatter::Protocol::STATSD) {
+    // Noop.
+  }
+
+ protected:
+  DescriptorRef counter;
+  DescriptorRef gauge;
+  LineFormatter graphite;
+  LineFormatter influx;
+  LineFormatter statsd;
+};
+
+
+TEST_F(LineFormatterTest, GraphiteTags) {
+  Sample sample("", 21.5, {{"room", "living room;1"}, {"zone", ""}});
+  ASSERT_EQ(
+      "temperature;room=living_room_1 21.5 1500000000\n",
+      this->graphite.line(this->gauge, sample, 1500000000123)
+  );
+}
+
+TEST_F(LineFormatterTest, GraphiteRole) {
+  Sample sample("count", 3, {});
+  ASSERT_EQ(
+      "temperature_count 3 1500000000\n",
+      this->graphite.line(this->gauge, sample, 1500000000000)
+  );
+}
+
+TEST_F(LineFormatterTest, InfluxEscapes) {
+  Sample sample("", 0.1, {{"room", "a,b=c d"}});
+  ASSERT_EQ(
+      "temperature,room=a\\,b\\=c\\ d value=0.1 1500000000123000000\n",
+      this->influx.line(this->gauge, sample, 1500000000123)
+  );
+}
+
+TEST_F(LineFormatterTest, NonFiniteValuesAreSkipped) {
+  Sample sample("", std::numeric_limits<double>::quiet_NaN(), {});
+  ASSERT_EQ("", this->graphite.line(this->gauge, sample, 0));
+  ASSERT_EQ("", this->influx.line(this->gauge, sample, 0));
+  ASSERT_EQ("", this->statsd.line(this->gauge, sample, 0));
+}
+
+TEST_F(LineFormatterTest, StatsdCounterIncrements) {
+  Sample first("", 5, {{"code", "200"}});
+  Sample second("", 7, {{"code", "200"}});
+  Sample other("", 1, {{"code", "500"}});
+  Sample reset("", 2, {{"code", "200"}});
+  ASSERT_EQ(
+      "requests_total:5|c|#code:200\n",
+      this->statsd.line(this->counter, first, 0)
+  );
+  ASSERT_EQ(
+      "requests_total:1|c|#code:500\n",
+      this->statsd.line(this->counter, other, 0)
+  );
+  this->statsd.commit();
+  ASSERT_EQ(
+      "requests_total:2|c|#code:200\n",
+      this->statsd.line(this->counter, second, 0)
+  );
+  this->statsd.commit();
+  ASSERT_EQ(
+      "requests_total:2|c|#code:200\n",
+      this->statsd.line(this->counter, reset, 0)
+  );
+}
+
+TEST_F(LineFormatterTest, StatsdIncrementsNeedCommit) {
+  Sample first("", 5, {});
+  Sample second("", 7, {});
+  this->statsd.line(this->counter, first, 0);
+  this->statsd.discard();
+  ASSERT_EQ(
+      "requests_total:7|c\n", this->statsd.line(this->counter, second, 0)
+  );
+  this->statsd.commit();
+
+  // Series missing from a commit start again from zero.
+  this->statsd.commit();
+  ASSERT_EQ(
+      "requests_total:7|c\n", this->statsd.line(this->counter, second, 0)
+  );
+}
+
+TEST_F(LineFormatterTest, StatsdGauges) {
+  Sample positive("", 21.5, {{"room", "a|b"}});
+  Sample negative("", -3, {});
+  ASSERT_EQ(
+      "temperature:21.5|g|#room:a_b\n",
+      this->statsd.line(this->gauge, positive, 0)
+  );
+  ASSERT_EQ(
+      "temperature:0|g\ntemperature:-3|g\n",
+      this->statsd.line(this->gauge, negative, 0)
+  );
+}
+
+
+class TestLineBridge : public LineFormatBridge {
+ public:
+  TestLineBridge(CollectorRegistry* registry)
+    : LineFormatBridge(registry, LineFormatter::Protocol::STATSD) {
+    // Noop.
+  }
+
+  std::string buffer;
+
+ protected:
+  void write(const std::string& line) {
+    this->buffer += line;
+  }
+};
+
+TEST(LineFormatBridge, WritesRegistry) {
+  CollectorRegistry registry;
+  CounterRef counter = promclient::CounterBuilder()
+    .name("test_metric")
+    .help("used for tests")
+    .registr(&registry);
+  counter->inc(3);
+
+  TestLineBridge bridge(&registry);
+  bridge.collect();
+  ASSERT_EQ("test_metric:3|c\n", bridge.buffer);
+  counter->inc(2);
+  bridge.collect();
+  bridge.commit();
+  counter->inc(1);
+  bridge.collect();
+  ASSERT_EQ(
+      "test_metric:3|c\ntest_metric:5|c\ntest_metric:1|c\n", bridge.buffer
+  );
+}
@@ -0,0 +1,51 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "promclient/internal/phaser.h"
+
+
+using promclient::internal::Phaser;
+
+
+TEST(Phaser, StartsInEvenPhase) {
+  Phaser phaser;
+  std::int64_t token = phaser.enter();
+  ASSERT_EQ(0, Phaser::Phase(token));
+  phaser.exit(token);
+}
+
+TEST(Phaser, FlipAlternatesPhases) {
+  Phaser phaser;
+  ASSERT_EQ(0, phaser.flip());
+
+  std::int64_t token = phaser.enter();
+  ASSERT_EQ(1, Phaser::Phase(token));
+  phaser.exit(token);
+
+  ASSERT_EQ(1, phaser.flip());
+  token = phaser.enter();
+  ASSERT_EQ(0, Phaser::Phase(token));
+  phaser.exit(token);
+}
+
+TEST(Phaser, FlipWaitsForWriters) {
+  Phaser phaser;
+  std::atomic<bool> flipped(false);
+  std::int64_t token = phaser.enter();
+
+  std::thread reader([&phaser, &flipped]() {
+    phaser.flip();
+    flipped = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(flipped.load());
+
+  phaser.exit(token);
+  reader.join();
+  ASSERT_TRUE(flipped.load());
+}
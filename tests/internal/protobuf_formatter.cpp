@@ -0,0 +1,285 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_formatter.h"
+
+
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::Exemplar;
+using promclient::ExemplarRef;
+using promclient::Metric;
+using promclient::NativeBuckets;
+using promclient::NativeBucketsRef;
+using promclient::Sample;
+
+using promclient::internal::ProtobufFormatter;
+
+
+//! Decodes the fields of a protobuf message for assertions.
+class Fields {
+ public:
+  explicit Fields(const std::string& message) {
+    std::size_t offset = 0;
+    while (offset < message.size()) {
+      std::uint64_t key = Fields::Varint(message, &offset);
+      int field = static_cast<int>(key >> 3);
+      switch (key & 7) {
+        case 0:
+          this->ints_[field].push_back(Fields::Varint(message, &offset));
+          break;
+        case 1: {
+          double value;
+          std::memcpy(&value, message.data() + offset, 8);
+          this->doubles_[field].push_back(value);
+          offset += 8;
+          break;
+        }
+        case 2: {
+          std::size_t size = Fields::Varint(message, &offset);
+          this->bytes_[field].push_back(message.substr(offset, size));
+          offset += size;
+          break;
+        }
+        default:
+          throw std::runtime_error("Unexpected wire type");
+      }
+    }
+  }
+
+  static std::uint64_t Varint(const std::string& data, std::size_t* offset) {
+    std::uint64_t value = 0;
+    int shift = 0;
+    std::uint8_t byte;
+    do {
+      byte = static_cast<std::uint8_t>(data[(*offset)++]);
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return value;
+  }
+
+  static std::int64_t Sint(std::uint64_t value) {
+    std::int64_t sign = -static_cast<std::int64_t>(value & 1);
+    return static_cast<std::int64_t>(value >> 1) ^ sign;
+  }
+
+  std::vector<std::string> bytes(int field) {
+    return this->bytes_[field];
+  }
+
+  std::vector<double> doubles(int field) {
+    return this->doubles_[field];
+  }
+
+  std::vector<std::uint64_t> ints(int field) {
+    return this->ints_[field];
+  }
+
+  Fields message(int field, std::size_t index = 0) {
+    return Fields(this->bytes_[field].at(index));
+  }
+
+ protected:
+  std::map<int, std::vector<std::string>> bytes_;
+  std::map<int, std::vector<double>> doubles_;
+  std::map<int, std::vector<std::uint64_t>> ints_;
+};
+
+
+class ProtobufFormatterTest : public ::testing::Test {
+ public:
+  //! Formats a metric and strips the length prefix.
+  Fields family(
+      std::string name, std::string type, std::vector<Sample> samples
+  ) {
+    DescriptorRef descriptor(new Descriptor(name, type, "help", {}));
+    Metric metric(descriptor, samples);
+    std::string delimited = this->formatter.family(metric);
+
+    std::size_t offset = 0;
+    std::size_t size = Fields::Varint(delimited, &offset);
+    EXPECT_EQ(delimited.size(), offset + size);
+    return Fields(delimited.substr(offset));
+  }
+
+ protected:
+  ProtobufFormatter formatter;
+};
+
+
+TEST(ProtobufFormatter, AcceptsPrometheusNativeHistograms) {
+  ASSERT_TRUE(ProtobufFormatter::Accepts(
+      "application/vnd.google.protobuf;"
+      "proto=io.prometheus.client.MetricFamily;encoding=delimited,"
+      "application/openmetrics-text;version=1.0.0;q=0.8,"
+      "text/plain;version=0.0.4;q=0.5,*/*;q=0.1"
+  ));
+}
+
+TEST(ProtobufFormatter, AcceptsNeedsDelimitedFamilies) {
+  ASSERT_FALSE(ProtobufFormatter::Accepts(
+      "application/vnd.google.protobuf;"
+      "proto=io.prometheus.client.MetricFamily;encoding=text"
+  ));
+  ASSERT_FALSE(ProtobufFormatter::Accepts(
+      "application/vnd.google.protobuf;encoding=delimited"
+  ));
+}
+
+TEST(ProtobufFormatter, AcceptsPreferredText) {
+  ASSERT_FALSE(ProtobufFormatter::Accepts(""));
+  ASSERT_FALSE(ProtobufFormatter::Accepts("text/plain"));
+  ASSERT_FALSE(ProtobufFormatter::Accepts(
+      "application/vnd.google.protobuf;"
+      "proto=io.prometheus.client.MetricFamily;encoding=delimited;q=0.5,"
+      "text/plain"
+  ));
+}
+
+TEST_F(ProtobufFormatterTest, Counter) {
+  ExemplarRef exemplar(new Exemplar({{"trace_id", "abc"}}, 2, 10.5));
+  Fields family = this->family("requests_total", "counter", {
+    Sample("", 3, {{"method", "get"}}, exemplar)
+  });
+  ASSERT_EQ("requests_total", family.bytes(1)[0]);
+  ASSERT_EQ("help", family.bytes(2)[0]);
+  ASSERT_EQ(0u, family.ints(3)[0]);
+  ASSERT_EQ(1u, family.bytes(4).size());
+
+  Fields metric = family.message(4);
+  Fields label = metric.message(1);
+  ASSERT_EQ("method", label.bytes(1)[0]);
+  ASSERT_EQ("get", label.bytes(2)[0]);
+
+  Fields counter = metric.message(3);
+  ASSERT_EQ(3, counter.doubles(1)[0]);
+  Fields encoded = counter.message(2);
+  ASSERT_EQ(2, encoded.doubles(2)[0]);
+  Fields timestamp = encoded.message(3);
+  ASSERT_EQ(10u, timestamp.ints(1)[0]);
+  ASSERT_EQ(500000000u, timestamp.ints(2)[0]);
+}
+
+TEST_F(ProtobufFormatterTest, Gauge) {
+  Fields family = this->family("temperature", "gauge", {
+    Sample("", 1, {{"room", "a"}}),
+    Sample("", -2, {{"room", "b"}})
+  });
+  ASSERT_EQ(1u, family.ints(3)[0]);
+  ASSERT_EQ(2u, family.bytes(4).size());
+  ASSERT_EQ(-2, family.message(4, 1).message(2).doubles(1)[0]);
+}
+
+TEST_F(ProtobufFormatterTest, HistogramBucketsInOrder) {
+  Fields family = this->family("latency", "histogram", {
+    Sample("bucket", 3, {{"le", "+Inf"}}),
+    Sample("bucket", 1, {{"le", "0.5"}}),
+    Sample("bucket", 2, {{"le", "10"}}),
+    Sample("count", 3, {}),
+    Sample("sum", 12.5, {})
+  });
+  ASSERT_EQ(4u, family.ints(3)[0]);
+  ASSERT_EQ(1u, family.bytes(4).size());
+
+  Fields histogram = family.message(4).message(7);
+  ASSERT_EQ(3u, histogram.ints(1)[0]);
+  ASSERT_EQ(12.5, histogram.doubles(2)[0]);
+  ASSERT_EQ(3u, histogram.bytes(3).size());
+  ASSERT_EQ(0.5, histogram.message(3, 0).doubles(2)[0]);
+  ASSERT_EQ(10, histogram.message(3, 1).doubles(2)[0]);
+  ASSERT_EQ(3u, histogram.message(3, 2).ints(1)[0]);
+  ASSERT_EQ(0u, histogram.ints(5).size());
+}
+
+TEST_F(ProtobufFormatterTest, HistogramNativeBuckets) {
+  NativeBucketsRef native(new NativeBuckets(
+      3, 0.001, 2, {{-2, 1}, {0, 4}, {1, 2}, {5, 1}}, {{0, 1}}
+  ));
+  Fields family = this->family("latency", "histogram", {
+    Sample("bucket", 11, {{"le", "+Inf"}}),
+    Sample("count", 11, {}, nullptr, native),
+    Sample("sum", 12.5, {})
+  });
+
+  Fields histogram = family.message(4).message(7);
+  ASSERT_EQ(3, Fields::Sint(histogram.ints(5)[0]));
+  ASSERT_EQ(0.001, histogram.doubles(6)[0]);
+  ASSERT_EQ(2u, histogram.ints(7)[0]);
+
+  // Spans: [-2, -2], [0, 1], [5, 5].
+  ASSERT_EQ(3u, histogram.bytes(12).size());
+  std::vector<std::int64_t> offsets;
+  std::vector<std::uint64_t> lengths;
+  for (std::size_t idx = 0; idx < 3; idx++) {
+    Fields span = histogram.message(12, idx);
+    offsets.push_back(Fields::Sint(span.ints(1)[0]));
+    lengths.push_back(span.ints(2)[0]);
+  }
+  ASSERT_EQ(std::vector<std::int64_t>({-2, 1, 3}), offsets);
+  ASSERT_EQ(std::vector<std::uint64_t>({1, 2, 1}), lengths);
+
+  std::vector<std::int64_t> deltas;
+  for (std::uint64_t delta : histogram.ints(13)) {
+    deltas.push_back(Fields::Sint(delta));
+  }
+  ASSERT_EQ(std::vector<std::int64_t>({1, 3, -2, -1}), deltas);
+
+  ASSERT_EQ(1u, histogram.bytes(9).size());
+  ASSERT_EQ(1u, histogram.ints(10).size());
+}
+
+TEST_F(ProtobufFormatterTest, HistogramNativeEmpty) {
+  NativeBucketsRef native(new NativeBuckets(3, 0, 0, {}, {}));
+  Fields family = this->family("latency", "histogram", {
+    Sample("count", 0, {}, nullptr, native),
+    Sample("sum", 0, {})
+  });
+
+  // An empty span marks the histogram as native.
+  Fields histogram = family.message(4).message(7);
+  ASSERT_EQ(1u, histogram.bytes(12).size());
+  ASSERT_EQ(0u, histogram.message(12).ints(2)[0]);
+}
+
+TEST_F(ProtobufFormatterTest, HistogramGroupsByLabels) {
+  Fields family = this->family("latency", "histogram", {
+    Sample("bucket", 1, {{"le", "+Inf"}, {"path", "/a"}}),
+    Sample("bucket", 2, {{"le", "+Inf"}, {"path", "/b"}}),
+    Sample("count", 1, {{"path", "/a"}}),
+    Sample("count", 2, {{"path", "/b"}})
+  });
+  ASSERT_EQ(2u, family.bytes(4).size());
+  Fields metric = family.message(4, 1);
+  ASSERT_EQ("/b", metric.message(1).bytes(2)[0]);
+  ASSERT_EQ(2u, metric.message(7).ints(1)[0]);
+}
+
+TEST_F(ProtobufFormatterTest, Summary) {
+  Fields family = this->family("latency", "summary", {
+    Sample("", 0.1, {{"quantile", "0.5"}}),
+    Sample("", 0.9, {{"quantile", "0.99"}}),
+    Sample("count", 7, {}),
+    Sample("sum", 3, {})
+  });
+  ASSERT_EQ(2u, family.ints(3)[0]);
+  Fields summary = family.message(4).message(4);
+  ASSERT_EQ(7u, summary.ints(1)[0]);
+  ASSERT_EQ(3, summary.doubles(2)[0]);
+  ASSERT_EQ(2u, summary.bytes(3).size());
+  ASSERT_EQ(0.99, summary.message(3, 1).doubles(1)[0]);
+}
+
+TEST_F(ProtobufFormatterTest, Untyped) {
+  Fields family = this->family("value", "untyped", {Sample("", 4, {})});
+  ASSERT_EQ(3u, family.ints(3)[0]);
+  ASSERT_EQ(4, family.message(4).message(5).doubles(1)[0]);
+}
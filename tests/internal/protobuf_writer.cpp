@@ -0,0 +1,62 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "promclient/internal/protobuf_writer.h"
+
+
+using promclient::internal::ProtobufWriter;
+
+
+TEST(ProtobufWriter, DoubleFieldIsLittleEndian) {
+  ProtobufWriter writer;
+  writer.doubleField(2, 1.0);
+  ASSERT_EQ(std::string("\x11\0\0\0\0\0\0\xF0\x3F", 9), writer.buffer());
+}
+
+TEST(ProtobufWriter, IntField) {
+  ProtobufWriter writer;
+  writer.intField(1, 150);
+  ASSERT_EQ(std::string("\x08\x96\x01"), writer.buffer());
+}
+
+TEST(ProtobufWriter, MessageField) {
+  ProtobufWriter inner;
+  inner.intField(1, 150);
+  ProtobufWriter writer;
+  writer.message(3, inner);
+  ASSERT_EQ(std::string("\x1A\x03\x08\x96\x01"), writer.buffer());
+}
+
+TEST(ProtobufWriter, NegativeIntsUseTenBytes) {
+  ProtobufWriter writer;
+  writer.varint(static_cast<std::uint64_t>(-1));
+  ASSERT_EQ(10u, writer.buffer().size());
+}
+
+TEST(ProtobufWriter, SintFieldIsZigZag) {
+  ProtobufWriter writer;
+  writer.sintField(1, -2);
+  ASSERT_EQ(std::string("\x08\x03"), writer.buffer());
+}
+
+TEST(ProtobufWriter, StringField) {
+  ProtobufWriter writer;
+  writer.stringField(2, "testing");
+  ASSERT_EQ(std::string("\x12\x07testing"), writer.buffer());
+}
+
+TEST(ProtobufWriter, Varint) {
+  ProtobufWriter writer;
+  writer.varint(1);
+  writer.varint(300);
+  ASSERT_EQ(std::string("\x01\xAC\x02"), writer.buffer());
+}
+
+TEST(ProtobufWriter, ZigZag) {
+  ASSERT_EQ(0u, ProtobufWriter::ZigZag(0));
+  ASSERT_EQ(1u, ProtobufWriter::ZigZag(-1));
+  ASSERT_EQ(2u, ProtobufWriter::ZigZag(1));
+  ASSERT_EQ(4294967295u, ProtobufWriter::ZigZag(-2147483648));
+}
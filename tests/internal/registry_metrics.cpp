@@ -0,0 +1,208 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/counter.h"
+#include "promclient/metric.h"
+#include "promclient/internal/registry_metrics.h"
+#include "promclient/internal/text_formatter.h"
+#include "promclient/internal/utils.h"
+
+
+using promclient::CollectorRegistry;
+using promclient::Counter;
+using promclient::DescriptorRef;
+using promclient::LabelledCounter;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::BufferTextBridge;
+using promclient::internal::ETag;
+using promclient::internal::RegistryMetrics;
+using promclient::internal::ScrapeTimer;
+using promclient::internal::TextFormatBridge;
+
+
+//! Text bridge that discards lines.
+class NullBridge : public TextFormatBridge {
+ public:
+  explicit NullBridge(CollectorRegistry* registry)
+    : TextFormatBridge(registry) {
+    // Noop.
+  }
+
+ protected:
+  void write(std::string line) {
+    // Noop.
+  }
+};
+
+
+//! Text bridge that skips per-scrape metrics, as HTTP ETags do.
+class SkippingBridge : public BufferTextBridge {
+ public:
+  SkippingBridge(CollectorRegistry* registry, std::string* body)
+    : BufferTextBridge(registry, body) {
+    // Noop.
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> skip;
+
+ protected:
+  void starting(const DescriptorRef& descriptor) {
+    if (this->skip.size() != 0 && this->skip.back().second == 0) {
+      this->skip.back().second = this->buffer_->size();
+    }
+    if (RegistryMetrics::PerScrape(descriptor->name())) {
+      this->skip.emplace_back(this->buffer_->size(), 0);
+    }
+  }
+};
+
+
+class RegistryMetricsTest : public ::testing::Test {
+ public:
+  RegistryMetricsTest() {
+    this->registry_.registr(std::make_shared<Counter>("requests", "Test"));
+    this->registry_.instrument();
+  }
+
+  //! Returns the samples of a collected metric.
+  std::vector<Sample> samples(const std::string& name) {
+    for (const Metric& metric : this->registry_.collect()) {
+      if (metric.descriptor()->name() == name) {
+        return metric.samples();
+      }
+    }
+    return std::vector<Sample>();
+  }
+
+  //! Returns the value of the sample with a label value.
+  double value(
+      const std::string& name, const std::string& label,
+      const std::string& value
+  ) {
+    for (const Sample& sample : this->samples(name)) {
+      if (sample.labels().at(label) == value) {
+        return sample.value();
+      }
+    }
+    return -1;
+  }
+
+ protected:
+  CollectorRegistry registry_;
+};
+
+TEST(RegistryMetrics, DisabledByDefault) {
+  CollectorRegistry registry;
+  ASSERT_EQ(nullptr, registry.instrumentation());
+  ASSERT_EQ(0u, registry.collect().size());
+
+  // Timers of registries without instrumentation do nothing.
+  ScrapeTimer timer(&registry, "text");
+  timer.collected();
+  timer.writing();
+  timer.written(10);
+  timer.done();
+}
+
+TEST_F(RegistryMetricsTest, InstrumentIsIdempotent) {
+  auto instrumentation = this->registry_.instrumentation();
+  ASSERT_NE(nullptr, instrumentation);
+  this->registry_.instrument();
+  ASSERT_EQ(instrumentation, this->registry_.instrumentation());
+}
+
+TEST_F(RegistryMetricsTest, CollectorDurations) {
+  this->registry_.collect();
+  ASSERT_LE(0, this->value(
+      "promclient_collector_duration_seconds", "collector", "requests"
+  ));
+}
+
+TEST_F(RegistryMetricsTest, CollectorDurationsFollowRegistrations) {
+  // Labelled collectors without children are named by their descriptor.
+  auto errors = std::make_shared<LabelledCounter>(
+      "errors", "Test", std::set<std::string>({"code"})
+  );
+  this->registry_.registr(errors);
+  this->registry_.collect();
+  ASSERT_LE(0, this->value(
+      "promclient_collector_duration_seconds", "collector", "errors"
+  ));
+
+  this->registry_.unregister(errors);
+  this->registry_.collect();
+  ASSERT_EQ(-1, this->value(
+      "promclient_collector_duration_seconds", "collector", "errors"
+  ));
+  ASSERT_LE(0, this->value(
+      "promclient_collector_duration_seconds", "collector", "requests"
+  ));
+}
+
+TEST_F(RegistryMetricsTest, LabelledCacheStats) {
+  auto counter = std::make_shared<LabelledCounter>(
+      "errors", "Test", std::set<std::string>({"kind"})
+  );
+  counter->labels({{"kind", "io"}});
+  counter->labels({{"kind", "io"}});
+  this->registry_.registr(counter);
+
+  ASSERT_EQ(1, this->value(
+      "promclient_labelled_children", "metric", "errors"
+  ));
+  std::vector<Sample> lookups = this->samples(
+      "promclient_labelled_lookups_total"
+  );
+  ASSERT_EQ(2u, lookups.size());
+  ASSERT_EQ("hit", lookups[0].labels().at("result"));
+  ASSERT_EQ(1, lookups[0].value());
+  ASSERT_EQ("miss", lookups[1].labels().at("result"));
+  ASSERT_EQ(1, lookups[1].value());
+}
+
+TEST_F(RegistryMetricsTest, ScrapeSeries) {
+  this->registry_.collect();
+  std::vector<Sample> series = this->samples("promclient_scrape_series");
+  ASSERT_EQ(1u, series.size());
+  ASSERT_LE(2, series[0].value());
+}
+
+TEST_F(RegistryMetricsTest, ScrapesByFormat) {
+  NullBridge bridge(&this->registry_);
+  bridge.collect();
+  bridge.collect();
+  ASSERT_EQ(2, this->value("promclient_scrapes_total", "format", "text"));
+  ASSERT_LT(0, this->samples("promclient_scrape_bytes")[0].value());
+
+  std::vector<Sample> phases = this->samples(
+      "promclient_scrape_duration_seconds"
+  );
+  ASSERT_EQ(3u, phases.size());
+  ASSERT_EQ("collect", phases[0].labels().at("phase"));
+  ASSERT_EQ("format", phases[1].labels().at("phase"));
+  ASSERT_EQ("write", phases[2].labels().at("phase"));
+}
+
+TEST_F(RegistryMetricsTest, PerScrapeMetricsCanBeSkipped) {
+  std::string tags[2];
+  std::string bodies[2];
+  for (int scrape = 0; scrape < 2; scrape++) {
+    SkippingBridge bridge(&this->registry_, &bodies[scrape]);
+    bridge.collect();
+    tags[scrape] = ETag(bodies[scrape], bridge.skip);
+  }
+  ASSERT_NE(bodies[0], bodies[1]);
+  ASSERT_EQ(tags[0], tags[1]);
+  ASSERT_FALSE(RegistryMetrics::PerScrape("promclient_labelled_children"));
+}
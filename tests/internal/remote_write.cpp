@@ -0,0 +1,69 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "promclient/metric.h"
+#include "promclient/internal/protobuf_writer.h"
+#include "promclient/internal/remote_write.h"
+
+
+using promclient::Descriptor;
+using promclient::DescriptorRef;
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::ProtobufWriter;
+using promclient::internal::RemoteSeries;
+using promclient::internal::RemoteSeriesList;
+
+using promclient::internal::EncodeWriteRequest;
+using promclient::internal::RemoteSeriesOf;
+
+
+TEST(RemoteSeriesOf, NamesAndSortsLabels) {
+  DescriptorRef descriptor(new Descriptor("test", "summary", "", {"Zone"}));
+  MetricsList metrics({Metric(descriptor, {
+    Sample("", 3, {{"Zone", "a"}}),
+    Sample("count", 2, {{"Zone", "a"}})
+  })});
+
+  RemoteSeriesList series = RemoteSeriesOf(metrics, 1000);
+  ASSERT_EQ(2u, series.size());
+  ASSERT_EQ(2u, series[0].labels.size());
+
+  // Uppercase names sort before `__name__`.
+  ASSERT_EQ("Zone", series[0].labels[0].first);
+  ASSERT_EQ("__name__", series[0].labels[1].first);
+  ASSERT_EQ("test", series[0].labels[1].second);
+  ASSERT_EQ("test_count", series[1].labels[1].second);
+  ASSERT_EQ(3, series[0].value);
+  ASSERT_EQ(1000, series[1].timestamp);
+}
+
+TEST(EncodeWriteRequest, Empty) {
+  ProtobufWriter request;
+  request.varint(1);
+  EncodeWriteRequest(RemoteSeriesList(), &request);
+  ASSERT_EQ("", request.buffer());
+}
+
+TEST(EncodeWriteRequest, Series) {
+  RemoteSeries series;
+  series.labels = {{"__name__", "up"}, {"job", "a"}};
+  series.value = 1;
+  series.timestamp = 1000;
+
+  ProtobufWriter request;
+  EncodeWriteRequest({series}, &request);
+  std::string expected(
+      "\x0a\x28"  // WriteRequest.timeseries
+      "\x0a\x0e" "\x0a\x08__name__" "\x12\x02up"  // TimeSeries.labels
+      "\x0a\x08" "\x0a\x03job" "\x12\x01" "a"
+      "\x12\x0c"  // TimeSeries.samples
+      "\x09\x00\x00\x00\x00\x00\x00\xf0\x3f" "\x10\xe8\x07",
+      42
+  );
+  ASSERT_EQ(expected, request.buffer());
+}
@@ -0,0 +1,42 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "promclient/internal/semaphore.h"
+
+using promclient::internal::Semaphore;
+
+
+TEST(Semaphore, NoPermitsNeverBlocks) {
+  Semaphore semaphore(0);
+  for (int idx = 0; idx < 10; idx++) {
+    ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+  }
+}
+
+TEST(Semaphore, AcquireUpToPermits) {
+  Semaphore semaphore(2);
+  ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+  ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+  ASSERT_FALSE(semaphore.acquire(std::chrono::milliseconds(1)));
+}
+
+TEST(Semaphore, ReleaseReturnsPermit) {
+  Semaphore semaphore(1);
+  ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+  semaphore.release();
+  ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+}
+
+TEST(Semaphore, AcquireWaitsForRelease) {
+  Semaphore semaphore(1);
+  ASSERT_TRUE(semaphore.acquire(std::chrono::milliseconds(0)));
+  std::thread releaser([&semaphore]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    semaphore.release();
+  });
+  ASSERT_TRUE(semaphore.acquire(std::chrono::seconds(5)));
+  releaser.join();
+}
@@ -0,0 +1,72 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "promclient/internal/snappy.h"
+
+using promclient::internal::SnappyCompress;
+using promclient::internal::SnappyUncompress;
+
+
+//! Compresses and decompresses a buffer, returning the compressed size.
+static std::size_t RoundTrip(const std::string& input) {
+  std::string compressed;
+  SnappyCompress(input, &compressed);
+  EXPECT_EQ(input, SnappyUncompress(compressed));
+  return compressed.size();
+}
+
+
+TEST(Snappy, Empty) {
+  std::string compressed;
+  SnappyCompress("", &compressed);
+  ASSERT_EQ(std::string(1, '\0'), compressed);
+  ASSERT_EQ("", SnappyUncompress(compressed));
+}
+
+TEST(Snappy, ShortLiteral) {
+  std::string compressed;
+  SnappyCompress("abc", &compressed);
+  ASSERT_EQ(std::string("\x03\x08" "abc"), compressed);
+}
+
+TEST(Snappy, RepeatedInputCompresses) {
+  std::string input;
+  for (int idx = 0; idx < 1000; idx++) {
+    input += "test_metric{handler=\"/api\"} 1\n";
+  }
+  ASSERT_LT(RoundTrip(input), input.size() / 10);
+}
+
+TEST(Snappy, LongLiteralAndBlocks) {
+  // Pseudo random bytes do not compress and span several blocks.
+  std::string input;
+  unsigned int state = 42;
+  for (int idx = 0; idx < 200000; idx++) {
+    state = state * 1103515245 + 12345;
+    input.push_back(static_cast<char>(state >> 16));
+  }
+  RoundTrip(input);
+  RoundTrip(input + input.substr(0, 100000));
+}
+
+TEST(Snappy, OverlappingCopy) {
+  RoundTrip(std::string(5000, 'a'));
+  RoundTrip("ab" + std::string(70, 'c') + "abababababababab");
+}
+
+TEST(Snappy, UncompressKnownBlock) {
+  // Literal "ab" then a 6 bytes copy at offset 2.
+  std::string block("\x08\x04" "ab" "\x09\x02", 6);
+  ASSERT_EQ("abababab", SnappyUncompress(block));
+}
+
+TEST(Snappy, UncompressInvalid) {
+  ASSERT_THROW(SnappyUncompress(""), std::runtime_error);
+  ASSERT_THROW(SnappyUncompress("\x05\x08" "ab"), std::runtime_error);
+  ASSERT_THROW(
+      SnappyUncompress(std::string("\x04\x09\x02", 3)), std::runtime_error
+  );
+}
@@ -0,0 +1,93 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "promclient/internal/sparse_buckets.h"
+
+
+using promclient::internal::SparseBuckets;
+
+
+TEST(SparseBuckets, AddCreatesAndIncrements) {
+  SparseBuckets buckets(8);
+  ASSERT_TRUE(buckets.add(3));
+  ASSERT_TRUE(buckets.add(3, 2));
+  ASSERT_TRUE(buckets.add(-7));
+  ASSERT_EQ(2u, buckets.size());
+
+  std::map<std::int64_t, std::uint64_t> counts;
+  buckets.copy(&counts);
+  std::map<std::int64_t, std::uint64_t> expected = {{-7, 1}, {3, 3}};
+  ASSERT_EQ(expected, counts);
+}
+
+TEST(SparseBuckets, CapacityIsPowerOfTwo) {
+  SparseBuckets buckets(100);
+  ASSERT_EQ(256u, buckets.capacity());
+}
+
+TEST(SparseBuckets, ClearEmptiesTable) {
+  SparseBuckets buckets(8);
+  buckets.add(1);
+  buckets.clear();
+  ASSERT_EQ(0u, buckets.size());
+
+  std::map<std::int64_t, std::uint64_t> counts;
+  buckets.copy(&counts);
+  ASSERT_EQ(0u, counts.size());
+}
+
+TEST(SparseBuckets, CopyAddsToCounts) {
+  SparseBuckets buckets(8);
+  buckets.add(1, 4);
+  std::map<std::int64_t, std::uint64_t> counts = {{1, 1}, {2, 2}};
+  buckets.copy(&counts);
+  std::map<std::int64_t, std::uint64_t> expected = {{1, 5}, {2, 2}};
+  ASSERT_EQ(expected, counts);
+}
+
+TEST(SparseBuckets, LimitOnlyBlocksNewBuckets) {
+  SparseBuckets buckets(8);
+  ASSERT_TRUE(buckets.add(1, 1, 2));
+  ASSERT_TRUE(buckets.add(2, 1, 2));
+  ASSERT_FALSE(buckets.add(3, 1, 2));
+  ASSERT_TRUE(buckets.add(1, 1, 2));
+  ASSERT_EQ(2u, buckets.size());
+}
+
+TEST(SparseBuckets, FullTableRejectsNewBuckets) {
+  SparseBuckets buckets(8);
+  std::int64_t capacity = buckets.capacity();
+  for (std::int64_t key = 0; key < capacity; key++) {
+    ASSERT_TRUE(buckets.add(key));
+  }
+  ASSERT_FALSE(buckets.add(capacity));
+  ASSERT_TRUE(buckets.add(0));
+}
+
+TEST(SparseBuckets, ConcurrentAdds) {
+  SparseBuckets buckets(64);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&buckets]() {
+      for (int idx = 0; idx < 10000; idx++) {
+        buckets.add(idx % 50);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::map<std::int64_t, std::uint64_t> counts;
+  buckets.copy(&counts);
+  ASSERT_EQ(50u, buckets.size());
+  ASSERT_EQ(50u, counts.size());
+  for (const auto& pair : counts) {
+    ASSERT_EQ(800u, pair.second);
+  }
+}
@@ -13,8 +13,11 @@ using promclient::CollectorRegistry;
 using promclient::CounterRef;
 using promclient::Descriptor;
 using promclient::DescriptorRef;
+using promclient::Exemplar;
+using promclient::ExemplarRef;
 using promclient::Sample;
 
+using promclient::internal::BufferTextBridge;
 using promclient::internal::TextFormatBridge;
 using promclient::internal::TextFormatter;
 
@@ -151,10 +154,109 @@ TEST_F(TextFormatterTest, WriteValueDecimal) {
   ASSERT_EQ(expected, line);
 }
 
+TEST_F(TextFormatterTest, WriteSampleIgnoresExemplar) {
+  ExemplarRef exemplar(new Exemplar({{"trace_id", "abc"}}, 1, 2));
+  Sample sample("", 5, {}, exemplar);
+  std::string expected = "metric_name 5.0000000000000000e+00\n";
+  std::string line = this->formatter.sample("metric_name", sample);
+  ASSERT_EQ(expected, line);
+}
+
+
+TEST(TextFormatterNegotiate, DefaultsToPrometheus) {
+  ASSERT_EQ(TextFormatter::PROMETHEUS, TextFormatter::Negotiate(""));
+  ASSERT_EQ(TextFormatter::PROMETHEUS, TextFormatter::Negotiate("*/*"));
+  ASSERT_EQ(
+      TextFormatter::PROMETHEUS,
+      TextFormatter::Negotiate("text/plain;version=0.0.4")
+  );
+}
+
+TEST(TextFormatterNegotiate, PrefersOpenMetrics) {
+  ASSERT_EQ(
+      TextFormatter::OPENMETRICS,
+      TextFormatter::Negotiate(
+        "application/openmetrics-text;version=1.0.0,"
+        "application/openmetrics-text;version=0.0.1;q=0.75,"
+        "text/plain;version=0.0.4;q=0.5,*/*;q=0.1"
+      )
+  );
+}
+
+TEST(TextFormatterNegotiate, HonoursQuality) {
+  ASSERT_EQ(
+      TextFormatter::PROMETHEUS,
+      TextFormatter::Negotiate(
+        "application/openmetrics-text; q=0.2, text/plain; q=0.5"
+      )
+  );
+  ASSERT_EQ(
+      TextFormatter::PROMETHEUS,
+      TextFormatter::Negotiate("application/openmetrics-text;q=0")
+  );
+}
+
+
+class OpenMetricsFormatterTest : public TextFormatterTest {
+ public:
+  OpenMetricsFormatterTest() : openmetrics(TextFormatter::OPENMETRICS) {
+    // Noop.
+  }
+
+ protected:
+  TextFormatter openmetrics;
+};
+
+TEST_F(OpenMetricsFormatterTest, CounterFamilyHasNoTotal) {
+  std::string expected = "";
+  expected += "# HELP metric for \\\"testing\\\"\n";
+  expected += "# TYPE metric counter\n";
+  DescriptorRef desc = this->descriptor(
+      "metric_total", "for \"testing\"", "counter"
+  );
+  ASSERT_EQ(expected, this->openmetrics.describe(desc));
+  ASSERT_EQ("metric_total", this->openmetrics.sampleName(desc));
+}
+
+TEST_F(OpenMetricsFormatterTest, CounterSamplesHaveTotal) {
+  DescriptorRef desc = this->descriptor("metric", "", "counter");
+  ASSERT_EQ("# TYPE metric counter\n", this->openmetrics.describe(desc));
+  ASSERT_EQ("metric_total", this->openmetrics.sampleName(desc));
+  ASSERT_EQ("metric", this->formatter.sampleName(desc));
+}
+
+TEST_F(OpenMetricsFormatterTest, UntypedIsUnknown) {
+  DescriptorRef desc = this->descriptor("metric", "", "untyped");
+  ASSERT_EQ("# TYPE metric unknown\n", this->openmetrics.describe(desc));
+}
+
+TEST_F(OpenMetricsFormatterTest, WriteSampleWithExemplar) {
+  ExemplarRef exemplar(new Exemplar({{"trace_id", "abc"}}, 1, 2));
+  Sample sample("", 5, {{"lb", "val"}}, exemplar);
+  std::string expected;
+  expected += "metric_total{lb=\"val\"} 5.0000000000000000e+00";
+  expected += " # {trace_id=\"abc\"} 1.0000000000000000e+00";
+  expected += " 2.0000000000000000e+00\n";
+  std::string line = this->openmetrics.sample("metric_total", sample);
+  ASSERT_EQ(expected, line);
+}
+
+TEST_F(OpenMetricsFormatterTest, ContentType) {
+  std::string expected =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  ASSERT_EQ(expected, this->openmetrics.contentType());
+  ASSERT_EQ(
+      std::string("text/plain; version=0.0.4"), this->formatter.contentType()
+  );
+}
+
 
 class TestBridge : public TextFormatBridge {
  public:
-  TestBridge(CollectorRegistry* registry) : TextFormatBridge(registry) {
+  TestBridge(
+      CollectorRegistry* registry,
+      TextFormatter::Format format = TextFormatter::PROMETHEUS
+  ) : TextFormatBridge(registry, format) {
     // Noop.
   }
 
@@ -204,3 +306,62 @@ TEST_F(TextFormatBridgeTest, WritesCounter) {
   expected += "test_metric 0.0000000000000000e+00\n";
   ASSERT_EQ(expected, actual);
 }
+
+
+TEST_F(TextFormatBridgeTest, WritesOpenMetrics) {
+  CounterRef counter = promclient::CounterBuilder()
+    .name("test_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+  counter->inc(1, {{"trace_id", "abc"}});
+
+  TestBridge bridge(&this->registry_, TextFormatter::OPENMETRICS);
+  bridge.collect();
+  std::string actual = bridge.buffer();
+  ASSERT_EQ(0u, actual.find(
+      "# HELP test_metric used for tests\n"
+      "# TYPE test_metric counter\n"
+      "test_metric_total 1.0000000000000000e+00 # {trace_id=\"abc\"} "
+      "1.0000000000000000e+00 "
+  ));
+  ASSERT_EQ(actual.size() - 7, actual.find("\n# EOF\n"));
+}
+
+TEST_F(TextFormatBridgeTest, WritesFilteredMetrics) {
+  promclient::CounterBuilder()
+    .name("test_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+  promclient::CounterBuilder()
+    .name("other_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+
+  this->bridge_.filter({"other_metric"});
+  std::string actual = this->collectBuffer();
+  std::string expected;
+  expected += "# HELP other_metric used for tests\n";
+  expected += "# TYPE other_metric counter\n";
+  expected += "other_metric 0.0000000000000000e+00\n";
+  ASSERT_EQ(expected, actual);
+}
+
+TEST_F(TextFormatBridgeTest, BufferBridgeAppends) {
+  promclient::CounterBuilder()
+    .name("test_metric")
+    .help("used for tests")
+    .registr(&this->registry_);
+
+  std::string buffer = "# Prefix\n";
+  BufferTextBridge bridge(&this->registry_, &buffer);
+  bridge.collect();
+  ASSERT_EQ(
+      std::string("text/plain; version=0.0.4"), bridge.contentType()
+  );
+  std::string expected;
+  expected += "# Prefix\n";
+  expected += "# HELP test_metric used for tests\n";
+  expected += "# TYPE test_metric counter\n";
+  expected += "test_metric 0.0000000000000000e+00\n";
+  ASSERT_EQ(expected, buffer);
+}
@@ -0,0 +1,88 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "promclient/internal/utils.h"
+
+using promclient::internal::ETag;
+using promclient::internal::MatchETag;
+using promclient::internal::PlanResponse;
+using promclient::internal::ResponsePlan;
+
+
+TEST(ETag, IsQuotedHash) {
+  std::string etag = ETag("metric 1\n");
+  ASSERT_EQ(18u, etag.size());
+  ASSERT_EQ('"', etag.front());
+  ASSERT_EQ('"', etag.back());
+  ASSERT_EQ(17u, etag.find_first_not_of("0123456789abcdef", 1));
+}
+
+TEST(ETag, ChangesWithBody) {
+  ASSERT_EQ(ETag("metric 1\n"), ETag("metric 1\n"));
+  ASSERT_NE(ETag("metric 1\n"), ETag("metric 2\n"));
+}
+
+TEST(ETag, SkipsRanges) {
+  std::vector<std::pair<std::size_t, std::size_t>> skip = {{2, 5}, {7, 8}};
+  ASSERT_EQ(ETag("a b \n"), ETag("a 123b 4\n", skip));
+  ASSERT_EQ(ETag("a 123b 4\n", skip), ETag("a 456b 5\n", skip));
+  ASSERT_NE(ETag("a 123b 4\n", skip), ETag("x 123b 4\n", skip));
+  ASSERT_EQ(ETag("metric 1\n"), ETag("metric 1\n", {}));
+}
+
+TEST(MatchETag, Exact) {
+  ASSERT_TRUE(MatchETag("\"abc\"", "\"abc\""));
+  ASSERT_FALSE(MatchETag("\"abd\"", "\"abc\""));
+  ASSERT_FALSE(MatchETag("", "\"abc\""));
+}
+
+TEST(MatchETag, List) {
+  ASSERT_TRUE(MatchETag("\"x\", \"abc\"", "\"abc\""));
+  ASSERT_FALSE(MatchETag("\"x\", \"y\"", "\"abc\""));
+}
+
+TEST(MatchETag, Weak) {
+  ASSERT_TRUE(MatchETag("W/\"abc\"", "\"abc\""));
+}
+
+TEST(MatchETag, Wildcard) {
+  ASSERT_TRUE(MatchETag("*", "\"abc\""));
+}
+
+
+TEST(PlanResponse, Get) {
+  ResponsePlan plan = PlanResponse(42, "\"abc\"", nullptr, false);
+  ASSERT_EQ(200, plan.code);
+  ASSERT_EQ(42u, plan.length);
+  ASSERT_TRUE(plan.send_body);
+}
+
+TEST(PlanResponse, Head) {
+  ResponsePlan plan = PlanResponse(42, "\"abc\"", nullptr, true);
+  ASSERT_EQ(200, plan.code);
+  ASSERT_EQ(42u, plan.length);
+  ASSERT_FALSE(plan.send_body);
+}
+
+TEST(PlanResponse, NotModified) {
+  // The length is the one of the body the client already has.
+  ResponsePlan plan = PlanResponse(42, "\"abc\"", "\"abc\"", false);
+  ASSERT_EQ(304, plan.code);
+  ASSERT_EQ(42u, plan.length);
+  ASSERT_FALSE(plan.send_body);
+
+  plan = PlanResponse(42, "\"abc\"", "W/\"abc\"", true);
+  ASSERT_EQ(304, plan.code);
+  ASSERT_EQ(42u, plan.length);
+  ASSERT_FALSE(plan.send_body);
+}
+
+TEST(PlanResponse, Modified) {
+  ResponsePlan plan = PlanResponse(42, "\"abc\"", "\"old\"", false);
+  ASSERT_EQ(200, plan.code);
+  ASSERT_TRUE(plan.send_body);
+}
@@ -0,0 +1,290 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "promclient/exceptions.h"
+#include "promclient/metric.h"
+#include "promclient/native_histogram.h"
+
+#include "promclient/internal/builder_native_histogram.h"
+
+
+using promclient::DescriptorsList;
+using promclient::ExemplarRef;
+using promclient::InvalidHistogram;
+using promclient::LabelledNativeHistogram;
+using promclient::LabelledNativeHistogramRef;
+using promclient::NativeBucketsRef;
+using promclient::NativeHistogram;
+using promclient::NativeHistogramBuilder;
+using promclient::NativeHistogramRef;
+
+using promclient::Metric;
+using promclient::MetricsList;
+using promclient::Sample;
+
+using promclient::internal::Timer;
+
+
+typedef std::map<int, std::uint64_t> Buckets;
+
+//! Returns the native buckets of a collected histogram.
+NativeBucketsRef CollectNative(NativeHistogram* histogram) {
+  MetricsList metrics = histogram->collect();
+  return metrics[0].samples()[1].native();
+}
+
+//! Returns the sum of all bucket counts, including the zero bucket.
+std::uint64_t CountBuckets(const NativeBucketsRef& native) {
+  std::uint64_t count = native->zeroCount();
+  for (const auto& bucket : native->positive()) {
+    count += bucket.second;
+  }
+  for (const auto& bucket : native->negative()) {
+    count += bucket.second;
+  }
+  return count;
+}
+
+
+TEST(NativeHistogram, BucketIndexNegativeSchema) {
+  ASSERT_EQ(0, NativeHistogram::BucketIndex(1, -1));
+  ASSERT_EQ(1, NativeHistogram::BucketIndex(4, -1));
+  ASSERT_EQ(2, NativeHistogram::BucketIndex(5, -1));
+  ASSERT_EQ(-1, NativeHistogram::BucketIndex(0.2, -1));
+}
+
+TEST(NativeHistogram, BucketIndexPositiveSchema) {
+  ASSERT_EQ(0, NativeHistogram::BucketIndex(1, 3));
+  ASSERT_EQ(2, NativeHistogram::BucketIndex(1.1, 3));
+  ASSERT_EQ(8, NativeHistogram::BucketIndex(2, 3));
+  ASSERT_EQ(-8, NativeHistogram::BucketIndex(0.5, 3));
+}
+
+TEST(NativeHistogram, BucketIndexSchemaZero) {
+  ASSERT_EQ(-1, NativeHistogram::BucketIndex(0.5, 0));
+  ASSERT_EQ(0, NativeHistogram::BucketIndex(1, 0));
+  ASSERT_EQ(1, NativeHistogram::BucketIndex(2, 0));
+  ASSERT_EQ(2, NativeHistogram::BucketIndex(3, 0));
+  ASSERT_EQ(2, NativeHistogram::BucketIndex(4, 0));
+}
+
+TEST(NativeHistogram, BucketIndexInfinityIsLastBucket) {
+  double max = std::numeric_limits<double>::max();
+  double inf = std::numeric_limits<double>::infinity();
+  ASSERT_EQ(
+      NativeHistogram::BucketIndex(max, 3),
+      NativeHistogram::BucketIndex(inf, 3)
+  );
+}
+
+TEST(NativeHistogram, Describe) {
+  NativeHistogram histogram("latency_seconds", "Request latency");
+  DescriptorsList descriptors = histogram.describe();
+  ASSERT_EQ(1u, descriptors.size());
+  ASSERT_EQ("latency_seconds", descriptors[0]->name());
+  ASSERT_EQ("histogram", descriptors[0]->type());
+}
+
+TEST(NativeHistogram, InvalidOptions) {
+  ASSERT_THROW(NativeHistogram("test", "test", 9), InvalidHistogram);
+  ASSERT_THROW(NativeHistogram("test", "test", -5), InvalidHistogram);
+  ASSERT_THROW(NativeHistogram("test", "test", 3, 0), InvalidHistogram);
+  ASSERT_THROW(NativeHistogram("test", "test", 3, 10, -1), InvalidHistogram);
+  ASSERT_THROW(
+      LabelledNativeHistogram("test", "test", {"label"}, 9),
+      InvalidHistogram
+  );
+}
+
+TEST(NativeHistogram, Observe) {
+  NativeHistogram histogram("test", "test", 0);
+  histogram.observe(1);
+  histogram.observe(2);
+  histogram.observe(2);
+  histogram.observe(8);
+
+  MetricsList metrics = histogram.collect();
+  ASSERT_EQ(1u, metrics.size());
+  const std::vector<Sample>& samples = metrics[0].samples();
+  ASSERT_EQ(3u, samples.size());
+
+  std::map<std::string, std::string> inf = {{"le", "+Inf"}};
+  ASSERT_EQ("bucket", samples[0].role());
+  ASSERT_EQ(inf, samples[0].labels());
+  ASSERT_EQ(4, samples[0].value());
+  ASSERT_EQ("count", samples[1].role());
+  ASSERT_EQ(4, samples[1].value());
+  ASSERT_EQ("sum", samples[2].role());
+  ASSERT_EQ(13, samples[2].value());
+
+  NativeBucketsRef native = samples[1].native();
+  ASSERT_NE(nullptr, native);
+  ASSERT_EQ(0, native->schema());
+  Buckets expected = {{0, 1}, {1, 2}, {3, 1}};
+  ASSERT_EQ(expected, native->positive());
+  ASSERT_EQ(0u, native->negative().size());
+}
+
+TEST(NativeHistogram, ObserveNaN) {
+  NativeHistogram histogram("test", "test");
+  histogram.observe(std::nan(""));
+  MetricsList metrics = histogram.collect();
+  ASSERT_EQ(1, metrics[0].samples()[1].value());
+  ASSERT_TRUE(std::isnan(metrics[0].samples()[2].value()));
+  ASSERT_EQ(0u, CountBuckets(metrics[0].samples()[1].native()));
+}
+
+TEST(NativeHistogram, ObserveNegative) {
+  NativeHistogram histogram("test", "test", 0);
+  histogram.observe(-1);
+  histogram.observe(-3);
+  NativeBucketsRef native = CollectNative(&histogram);
+  Buckets expected = {{0, 1}, {2, 1}};
+  ASSERT_EQ(expected, native->negative());
+  ASSERT_EQ(0u, native->positive().size());
+}
+
+TEST(NativeHistogram, ObserveWithExemplar) {
+  NativeHistogram histogram("test", "test");
+  histogram.observe(0.25, {{"trace_id", "abc"}});
+  MetricsList metrics = histogram.collect();
+  ExemplarRef exemplar = metrics[0].samples()[0].exemplar();
+  ASSERT_NE(nullptr, exemplar);
+  ASSERT_EQ(0.25, exemplar->value());
+  ASSERT_EQ(1, metrics[0].samples()[1].value());
+}
+
+TEST(NativeHistogram, ObserveZero) {
+  NativeHistogram histogram("test", "test", 3, 160, 0.001);
+  histogram.observe(0);
+  histogram.observe(-0.0005);
+  histogram.observe(0.001);
+  histogram.observe(0.002);
+  NativeBucketsRef native = CollectNative(&histogram);
+  ASSERT_EQ(0.001, native->zeroThreshold());
+  ASSERT_EQ(3u, native->zeroCount());
+  ASSERT_EQ(1u, native->positive().size());
+}
+
+TEST(NativeHistogram, Time) {
+  NativeHistogram histogram("test", "test");
+  {
+    Timer<NativeHistogram> timer = histogram.time();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  MetricsList metrics = histogram.collect();
+  ASSERT_EQ(1, metrics[0].samples()[1].value());
+  ASSERT_LE(0.005, metrics[0].samples()[2].value());
+  ASSERT_EQ(1u, CountBuckets(metrics[0].samples()[1].native()));
+}
+
+TEST(NativeHistogram, CollectIsCumulative) {
+  NativeHistogram histogram("test", "test", 0);
+  histogram.observe(1);
+  histogram.collect();
+  histogram.observe(1);
+  histogram.observe(4);
+
+  MetricsList metrics = histogram.collect();
+  ASSERT_EQ(3, metrics[0].samples()[1].value());
+  ASSERT_EQ(6, metrics[0].samples()[2].value());
+  Buckets expected = {{0, 2}, {2, 1}};
+  ASSERT_EQ(expected, metrics[0].samples()[1].native()->positive());
+}
+
+TEST(NativeHistogram, ReduceSchemaAtLimit) {
+  NativeHistogram histogram("test", "test", 3, 4);
+  for (int value = 1; value <= 16; value++) {
+    histogram.observe(value);
+  }
+  ASSERT_LT(histogram.schema(), 3);
+
+  MetricsList metrics = histogram.collect();
+  NativeBucketsRef native = metrics[0].samples()[1].native();
+  ASSERT_EQ(histogram.schema(), native->schema());
+  ASSERT_GE(4u, native->positive().size());
+  ASSERT_EQ(16u, CountBuckets(native));
+  ASSERT_EQ(136, metrics[0].samples()[2].value());
+}
+
+TEST(NativeHistogram, ReduceSchemaMergesBuckets) {
+  NativeHistogram histogram("test", "test", 1, 2);
+  histogram.observe(1);    // Schema 1 index 0, schema 0 index 0.
+  histogram.observe(1.2);  // Schema 1 index 1, schema 0 index 1.
+  histogram.observe(1.9);  // Schema 1 index 2, schema 0 index 1.
+  NativeBucketsRef native = CollectNative(&histogram);
+  ASSERT_EQ(0, native->schema());
+  Buckets expected = {{0, 1}, {1, 2}};
+  ASSERT_EQ(expected, native->positive());
+}
+
+TEST(NativeHistogram, ReduceSchemaStopsAtMinimum) {
+  NativeHistogram histogram("test", "test", NativeHistogram::MIN_SCHEMA, 1);
+  histogram.observe(1);
+  histogram.observe(1e10);
+  histogram.observe(1e-10);
+  NativeBucketsRef native = CollectNative(&histogram);
+  ASSERT_EQ(NativeHistogram::MIN_SCHEMA, native->schema());
+  ASSERT_EQ(3u, native->positive().size());
+}
+
+TEST(NativeHistogram, ConcurrentObserveAndCollect) {
+  NativeHistogram histogram("test", "test", 8, 10);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&histogram, thread]() {
+      for (int idx = 1; idx <= 5000; idx++) {
+        histogram.observe(idx * (thread + 1) * 0.37);
+      }
+    });
+  }
+  for (int idx = 0; idx < 20; idx++) {
+    histogram.collect();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  MetricsList metrics = histogram.collect();
+  NativeBucketsRef native = metrics[0].samples()[1].native();
+  ASSERT_EQ(20000, metrics[0].samples()[1].value());
+  ASSERT_EQ(20000u, CountBuckets(native));
+  ASSERT_GE(10u, native->positive().size());
+}
+
+TEST(NativeHistogram, Labelled) {
+  LabelledNativeHistogram histogram("test", "test", {"path"}, 0);
+  histogram.labels({{"path", "/a"}})->observe(2);
+  histogram.labels({{"path", "/b"}})->observe(4);
+
+  DescriptorsList descriptors = histogram.describe();
+  ASSERT_EQ("histogram", descriptors[0]->type());
+
+  MetricsList metrics = histogram.collect();
+  ASSERT_EQ(2u, metrics.size());
+  for (const Metric& metric : metrics) {
+    const Sample& count = metric.samples()[1];
+    ASSERT_EQ(1u, count.labels().size());
+    ASSERT_NE(nullptr, count.native());
+    ASSERT_EQ(0, count.native()->schema());
+  }
+}
+
+TEST(NativeHistogram, Builder) {
+  NativeHistogramRef histogram = NativeHistogramBuilder()
+    .name("test").help("test").build();
+  ASSERT_EQ(NativeHistogram::DEFAULT_SCHEMA, histogram->schema());
+
+  LabelledNativeHistogramRef labelled = NativeHistogramBuilder()
+    .name("test").help("test").labels({"label"}).build();
+  ASSERT_EQ(1u, labelled->describe().size());
+}
@@ -0,0 +1,114 @@
+// Copyright 2017 Stefano Pogliani <stefano@spogliani.net>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "promclient/collector_registry.h"
+#include "promclient/exceptions.h"
+#include "promclient/snapshot.h"
+
+using promclient::CollectorRegistry;
+using promclient::CounterDecrease;
+using promclient::DescriptorsList;
+using promclient::InvalidCollector;
+using promclient::MetricsList;
+
+using promclient::SnapshotCounterRef;
+using promclient::SnapshotGaugeRef;
+using promclient::SnapshotGroup;
+using promclient::SnapshotGroupRef;
+using promclient::SnapshotUpdate;
+
+
+TEST(SnapshotGroup, DescribesMetrics) {
+  SnapshotGroup group;
+  group.counter("requests_total", "Requests");
+  group.gauge("in_flight", "In flight requests");
+
+  DescriptorsList descriptors = group.describe();
+  ASSERT_EQ(static_cast<std::size_t>(2), descriptors.size());
+  ASSERT_EQ("requests_total", descriptors[0]->name());
+  ASSERT_EQ("counter", descriptors[0]->type());
+  ASSERT_EQ("in_flight", descriptors[1]->name());
+  ASSERT_EQ("gauge", descriptors[1]->type());
+}
+
+TEST(SnapshotGroup, DuplicateNamesFail) {
+  SnapshotGroup group;
+  group.counter("requests_total", "Requests");
+  ASSERT_THROW(group.gauge("requests_total", ""), InvalidCollector);
+}
+
+TEST(SnapshotGroup, CollectsTotals) {
+  SnapshotGroup group;
+  SnapshotCounterRef counter = group.counter("requests_total", "Requests");
+  SnapshotGaugeRef gauge = group.gauge("in_flight", "In flight requests");
+
+  counter->inc();
+  gauge->inc(3);
+  MetricsList metrics = group.collect();
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+  ASSERT_EQ(3, metrics[1].samples()[0].value());
+
+  counter->inc(2);
+  gauge->dec();
+  metrics = group.collect();
+  ASSERT_EQ(3, metrics[0].samples()[0].value());
+  ASSERT_EQ(2, metrics[1].samples()[0].value());
+
+  metrics = group.collect();
+  ASSERT_EQ(3, metrics[0].samples()[0].value());
+  ASSERT_EQ(2, metrics[1].samples()[0].value());
+}
+
+TEST(SnapshotGroup, CounterDecreaseFails) {
+  SnapshotGroup group;
+  SnapshotCounterRef counter = group.counter("requests_total", "Requests");
+  ASSERT_THROW(counter->inc(-1), CounterDecrease);
+}
+
+TEST(SnapshotGroup, UpdatesAreConsistent) {
+  SnapshotGroup group;
+  SnapshotCounterRef requests = group.counter("requests_total", "");
+  SnapshotCounterRef errors = group.counter("errors_total", "");
+  std::atomic<bool> stop(false);
+
+  std::vector<std::thread> writers;
+  for (int idx = 0; idx < 2; idx++) {
+    writers.push_back(std::thread([&]() {
+      while (!stop.load()) {
+        SnapshotUpdate update(group);
+        requests->inc(update);
+        errors->inc(update, 2);
+      }
+    }));
+  }
+
+  // Stop the writers before asserting so they are always joined.
+  bool consistent = true;
+  for (int idx = 0; idx < 200 && consistent; idx++) {
+    MetricsList metrics = group.collect();
+    double requests_total = metrics[0].samples()[0].value();
+    double errors_total = metrics[1].samples()[0].value();
+    consistent = requests_total * 2 == errors_total;
+  }
+
+  stop = true;
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  ASSERT_TRUE(consistent);
+}
+
+TEST(SnapshotGroup, RegistersInRegistry) {
+  CollectorRegistry registry;
+  SnapshotGroupRef group(new SnapshotGroup());
+  group->counter("requests_total", "Requests")->inc();
+  registry.registr(group);
+
+  MetricsList metrics = registry.collect();
+  ASSERT_EQ(static_cast<std::size_t>(1), metrics.size());
+  ASSERT_EQ(1, metrics[0].samples()[0].value());
+}